@@ -39,7 +39,9 @@
  * - LV_STDLIB_RTTHREAD:    RT-Thread implementation
  * - LV_STDLIB_CUSTOM:      Implement the functions externally
  */
-#define LV_USE_STDLIB_MALLOC    LV_STDLIB_CLIB
+#ifndef LV_USE_STDLIB_MALLOC
+    #define LV_USE_STDLIB_MALLOC    LV_STDLIB_CLIB  /**< Set by the build when LV_LINUX_HEAP is enabled */
+#endif
 
 /** Possible values
  * - LV_STDLIB_BUILTIN:     LVGL's built in implementation
@@ -106,7 +108,9 @@
  * - LV_OS_MQX
  * - LV_OS_SDL2
  * - LV_OS_CUSTOM */
-#define LV_USE_OS   LV_OS_NONE
+#ifndef LV_USE_OS
+    #define LV_USE_OS   LV_OS_NONE  /**< Set by the build when LV_LINUX_DRAW_THREADS is enabled */
+#endif
 
 #if LV_USE_OS == LV_OS_CUSTOM
     #define LV_OS_CUSTOM_INCLUDE <stdint.h>
@@ -153,7 +157,9 @@
 /** Stack size of drawing thread.
  * NOTE: If FreeType or ThorVG is enabled, it is recommended to set it to 32KB or more.
  */
-#define LV_DRAW_THREAD_STACK_SIZE    (8 * 1024)         /**< [bytes]*/
+#ifndef LV_DRAW_THREAD_STACK_SIZE
+    #define LV_DRAW_THREAD_STACK_SIZE    (8 * 1024)         /**< [bytes]*/
+#endif
 
 /** Thread priority of the drawing task.
  *  Higher values mean higher priority.
@@ -191,7 +197,9 @@
     /** Set number of draw units.
      *  - > 1 requires operating system to be enabled in `LV_USE_OS`.
      *  - > 1 means multiple threads will render the screen in parallel. */
-    #define LV_DRAW_SW_DRAW_UNIT_CNT    1
+    #ifndef LV_DRAW_SW_DRAW_UNIT_CNT
+        #define LV_DRAW_SW_DRAW_UNIT_CNT    1
+    #endif
 
     /** Use Arm-2D to accelerate software (sw) rendering. */
     #define LV_USE_DRAW_ARM2D_SYNC      0
@@ -217,10 +225,15 @@
         #define LV_DRAW_SW_CIRCLE_CACHE_SIZE 4
     #endif
 
-    #define  LV_USE_DRAW_SW_ASM     LV_DRAW_SW_ASM_NONE
+    /** Set by the LV_LINUX_DRAW_SW_ASM CMake option */
+    #ifndef LV_USE_DRAW_SW_ASM
+        #define  LV_USE_DRAW_SW_ASM     LV_DRAW_SW_ASM_NONE
+    #endif
 
     #if LV_USE_DRAW_SW_ASM == LV_DRAW_SW_ASM_CUSTOM
-        #define  LV_DRAW_SW_ASM_CUSTOM_INCLUDE ""
+        #ifndef LV_DRAW_SW_ASM_CUSTOM_INCLUDE
+            #define  LV_DRAW_SW_ASM_CUSTOM_INCLUDE ""
+        #endif
     #endif
 
     /** Enable drawing complex gradients in software: linear at an angle, radial or conical */
@@ -354,7 +367,9 @@
 #endif
 
 /** Draw using cached OpenGLES textures */
-#define LV_USE_DRAW_OPENGLES 0
+#ifndef LV_USE_DRAW_OPENGLES
+    #define LV_USE_DRAW_OPENGLES 0
+#endif
 
 /** Draw using espressif PPA accelerator */
 #define LV_USE_PPA  0
@@ -1012,7 +1027,7 @@
 /* Documentation for several of the below items can be found here: https://docs.lvgl.io/master/details/auxiliary-modules/index.html . */
 
 /** 1: Enable API to take snapshot for object */
-#define LV_USE_SNAPSHOT 0
+#define LV_USE_SNAPSHOT 1
 
 /** 1: Enable system monitor component */
 #define LV_USE_SYSMON   0
@@ -1040,10 +1055,17 @@
 #endif /*LV_USE_SYSMON*/
 
 /** 1: Enable runtime performance profiler */
-#define LV_USE_PROFILER 0
+#ifndef LV_USE_PROFILER
+    #define LV_USE_PROFILER 0
+#endif
 #if LV_USE_PROFILER
-    /** 1: Enable the built-in profiler */
-    #define LV_USE_PROFILER_BUILTIN 1
+    /** 1: Enable the built-in profiler, the trace-event profiler of the port
+     *  (src/lib/trace_profiler.h) is used with the LV_LINUX_PROFILER CMake option */
+    #ifdef LV_LINUX_TRACE_PROFILER
+        #define LV_USE_PROFILER_BUILTIN 0
+    #else
+        #define LV_USE_PROFILER_BUILTIN 1
+    #endif
     #if LV_USE_PROFILER_BUILTIN
         /** Default profiler trace buffer size */
         #define LV_PROFILER_BUILTIN_BUF_SIZE (16 * 1024)     /**< [bytes] */
@@ -1051,19 +1073,28 @@
     #endif
 
     /** Header to include for profiler */
-    #define LV_PROFILER_INCLUDE "lvgl/src/misc/lv_profiler_builtin.h"
+    #ifndef LV_PROFILER_INCLUDE
+        #define LV_PROFILER_INCLUDE "lvgl/src/misc/lv_profiler_builtin.h"
+    #endif
 
-    /** Profiler start point function */
-    #define LV_PROFILER_BEGIN    LV_PROFILER_BUILTIN_BEGIN
+    #ifdef LV_LINUX_TRACE_PROFILER
+        #define LV_PROFILER_BEGIN     TRACE_PROFILER_BEGIN
+        #define LV_PROFILER_END       TRACE_PROFILER_END
+        #define LV_PROFILER_BEGIN_TAG TRACE_PROFILER_BEGIN_TAG
+        #define LV_PROFILER_END_TAG   TRACE_PROFILER_END_TAG
+    #else
+        /** Profiler start point function */
+        #define LV_PROFILER_BEGIN    LV_PROFILER_BUILTIN_BEGIN
 
-    /** Profiler end point function */
-    #define LV_PROFILER_END      LV_PROFILER_BUILTIN_END
+        /** Profiler end point function */
+        #define LV_PROFILER_END      LV_PROFILER_BUILTIN_END
 
-    /** Profiler start point function with custom tag */
-    #define LV_PROFILER_BEGIN_TAG LV_PROFILER_BUILTIN_BEGIN_TAG
+        /** Profiler start point function with custom tag */
+        #define LV_PROFILER_BEGIN_TAG LV_PROFILER_BUILTIN_BEGIN_TAG
 
-    /** Profiler end point function with custom tag */
-    #define LV_PROFILER_END_TAG   LV_PROFILER_BUILTIN_END_TAG
+        /** Profiler end point function with custom tag */
+        #define LV_PROFILER_END_TAG   LV_PROFILER_BUILTIN_END_TAG
+    #endif
 
     /*Enable layout profiler*/
     #define LV_PROFILER_LAYOUT 1
@@ -0,0 +1,126 @@
+#!/bin/sh
+# Performance regression check, called by the perf tests of CMake
+#
+# Runs the benchmark scenes on the headless backend with one render mode,
+# the draw unit count is the one lvglsim was built with and only names the
+# configuration. Then compares the frame rate and the frame time
+# percentiles with the baseline of the configuration.
+#
+# Set LV_SIM_PERF_UPDATE=1 to replace the baseline of the configuration
+# with the results instead
+#
+# A scene without a baseline for the configuration fails the check,
+# nothing was compared for it. Set LV_SIM_PERF_ALLOW_MISSING=1 to exit
+# with 77 instead, reported as skipped by ctest
+
+if test $# -ne 8
+then
+    echo "usage: perf.sh lvglsim baseline.csv output_dir render_mode draw_units scenes seconds tolerance_pct"
+    exit 1
+fi
+
+LVGLSIM="$1"
+BASELINE="$2"
+OUTPUT_DIR="$3"
+RENDER_MODE="$4"
+DRAW_UNITS="$5"
+SCENES="$6"
+DURATION="$7"
+TOLERANCE="$8"
+
+CONFIG="$(echo "$RENDER_MODE" | tr 'A-Z' 'a-z')-$DRAW_UNITS"
+RESULTS="$OUTPUT_DIR/perf-$CONFIG.csv"
+
+mkdir -p "$OUTPUT_DIR" || exit 1
+
+# Fixed resolution and color format, so that the results only depend on
+# the code and the machine
+"$LVGLSIM" -b HEADLESS -W 800 -H 480 \
+    --color-format XRGB8888 \
+    --render-mode "$RENDER_MODE" \
+    --bench="$SCENES" --bench-time "$DURATION" \
+    --bench-output "$RESULTS" || exit 1
+
+if test "$LV_SIM_PERF_UPDATE" = "1"
+then
+    # Keep the baselines of the other configurations
+    TMP="$BASELINE.tmp.$$"
+    echo "config,scene,fps,render_p50_ms,render_p99_ms,frame_p99_ms" > "$TMP"
+    if test -f "$BASELINE"
+    then
+        grep -v "^config," "$BASELINE" | grep -v "^$CONFIG," >> "$TMP"
+    fi
+    # backend,scene,frames,fps,render_ms,flush_ms,render_p50_ms,render_p99_ms,frame_p50_ms,frame_p99_ms,cpu_pct
+    awk -F, -v config="$CONFIG" 'NR > 1 { printf "%s,%s,%s,%s,%s,%s\n", config, $2, $4, $7, $8, $10 }' \
+        "$RESULTS" >> "$TMP"
+    mv "$TMP" "$BASELINE"
+    echo "Updated the baseline of $CONFIG in $BASELINE"
+    exit 0
+fi
+
+if test "$LV_SIM_PERF_ALLOW_MISSING" = "1"
+then
+    MISSING_STATUS=77
+else
+    MISSING_STATUS=1
+fi
+
+if ! test -f "$BASELINE"
+then
+    echo "No baseline file $BASELINE, run the perf-baseline target first"
+    exit $MISSING_STATUS
+fi
+
+# The frame rate must not drop and the frame times must not grow by more
+# than the tolerance. A regression fails the test, otherwise a scene
+# without a baseline fails or skips it
+awk -F, -v config="$CONFIG" -v tol="$TOLERANCE" -v missing_status="$MISSING_STATUS" '
+function check(scene, name, value, base, higher_is_better,    limit, failed) {
+    if (higher_is_better) {
+        limit = base * (1 - tol / 100.0)
+        failed = value < limit
+    } else {
+        limit = base * (1 + tol / 100.0)
+        failed = value > limit
+    }
+    printf "%-10s %-14s %10.3f %10.3f %s\n", scene, name, base, value,
+           failed ? "REGRESSION" : "ok"
+    return failed
+}
+FNR == 1 { next }
+FILENAME != ARGV[ARGC - 1] {
+    if ($1 == config) {
+        base[$2] = 1
+        base_fps[$2] = $3
+        base_render_p50[$2] = $4
+        base_render_p99[$2] = $5
+        base_frame_p99[$2] = $6
+    }
+    next
+}
+{
+    scene = $2
+    if (!(scene in base)) {
+        printf "%-10s no baseline for %s\n", scene, config
+        missing++
+        next
+    }
+    regressions += check(scene, "fps", $4, base_fps[scene], 1)
+    regressions += check(scene, "render_p50_ms", $7, base_render_p50[scene], 0)
+    regressions += check(scene, "render_p99_ms", $8, base_render_p99[scene], 0)
+    regressions += check(scene, "frame_p99_ms", $10, base_frame_p99[scene], 0)
+}
+BEGIN {
+    printf "%s, tolerance %s%%\n", config, tol
+    printf "%-10s %-14s %10s %10s\n", "scene", "metric", "baseline", "result"
+}
+END {
+    if (regressions > 0) {
+        printf "%d regression(s)\n", regressions
+        exit 1
+    }
+    if (missing > 0) {
+        printf "%d scene(s) without baseline, run the perf-baseline target\n", missing
+        exit missing_status
+    }
+}' "$BASELINE" "$RESULTS"
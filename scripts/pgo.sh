@@ -0,0 +1,103 @@
+#!/bin/sh
+# Two-stage profile guided build of lvglsim
+#
+# Builds the instrumented lvglsim with the pgo-generate preset, runs the
+# benchmark scenes on the headless backend to record the profile, then
+# rebuilds lvglsim with the profile using the pgo-use preset.
+#
+# With --cross the cross presets are used and the training is left to do
+# on the target, run the script again with the use stage once the profile
+# has been copied back.
+#
+# The training workload is selected with LV_SIM_PGO_SCENES and
+# LV_SIM_PGO_TIME, the other LV_SIM_* variables are passed to lvglsim
+
+usage()
+{
+    echo "usage: pgo.sh [--cross] [all|generate|train|use]"
+    exit 1
+}
+
+SUFFIX=""
+STAGE="all"
+
+while test $# -gt 0
+do
+    case "$1" in
+    --cross)
+        SUFFIX="-cross"
+        ;;
+    all|generate|train|use)
+        STAGE="$1"
+        ;;
+    *)
+        usage
+        ;;
+    esac
+    shift
+done
+
+cd "$(dirname "$0")/.." || exit 1
+
+BUILD_DIR="build/pgo$SUFFIX"
+PROFILE_DIR="$BUILD_DIR/profile"
+SCENES="${LV_SIM_PGO_SCENES:-benchmark,widgets,music}"
+DURATION="${LV_SIM_PGO_TIME:-10}"
+
+generate()
+{
+    # Stale counters of a previous build don't match the new code
+    rm -rf "$PROFILE_DIR"
+    cmake --preset "pgo-generate$SUFFIX" || exit 1
+    cmake --build --preset "pgo-generate$SUFFIX" -j || exit 1
+}
+
+train()
+{
+    if test -n "$SUFFIX"
+    then
+        echo "Copy $BUILD_DIR/bin/lvglsim to the target and run the workload there."
+        echo "The profile is written to $(pwd)/$PROFILE_DIR, set GCOV_PREFIX on the"
+        echo "target to write it elsewhere. Copy it back to $PROFILE_DIR and run"
+        echo "  scripts/pgo.sh --cross use"
+        exit 0
+    fi
+
+    "$BUILD_DIR/bin/lvglsim" -b HEADLESS --bench="$SCENES" --bench-time "$DURATION" || exit 1
+
+    # Clang writes raw profiles, they are merged in the file read by -fprofile-use
+    if ls "$PROFILE_DIR"/*.profraw > /dev/null 2>&1
+    then
+        llvm-profdata merge -output="$PROFILE_DIR/default.profdata" "$PROFILE_DIR"/*.profraw || exit 1
+    fi
+}
+
+use()
+{
+    if ! test -d "$PROFILE_DIR"
+    then
+        echo "No profile in $PROFILE_DIR, run the generate and train stages first"
+        exit 1
+    fi
+
+    cmake --preset "pgo-use$SUFFIX" || exit 1
+    cmake --build --preset "pgo-use$SUFFIX" -j || exit 1
+    echo "Built $BUILD_DIR/bin/lvglsim with the profile of $PROFILE_DIR"
+}
+
+case "$STAGE" in
+all)
+    generate
+    train
+    use
+    ;;
+generate)
+    generate
+    ;;
+train)
+    train
+    ;;
+use)
+    use
+    ;;
+esac
@@ -0,0 +1,214 @@
+/**
+ * @file adaptive_refresh.c
+ *
+ * Adaptive refresh rate
+ *
+ * The idle time is checked each time the refresh timer runs, the period
+ * given when the display is added is restored once it is active again
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "lvgl/lvgl.h"
+
+#include "adaptive_refresh.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Maximum number of displays the policy is applied to */
+#define ADAPTIVE_REFRESH_MAX_DISPLAYS 4
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* The state of a display */
+typedef struct {
+    lv_display_t *disp;
+    lv_timer_t *refr_timer;
+    uint32_t active_period;     /* The period of the backend, restored once the display is active again */
+    uint32_t last_activity;     /* lv_tick_get() of the last invalidation or input */
+    bool idle;
+} adaptive_display_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static adaptive_display_t *find_display(lv_display_t *disp);
+static void display_event_cb(lv_event_t *e);
+static void enter_idle(adaptive_display_t *ad);
+static void leave_idle(adaptive_display_t *ad);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static adaptive_display_t displays[ADAPTIVE_REFRESH_MAX_DISPLAYS];
+static uint32_t display_count;
+
+static uint32_t timeout;
+static uint32_t period;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void adaptive_refresh_init(uint32_t idle_timeout, uint32_t idle_period)
+{
+    timeout = idle_timeout;
+    period = idle_period;
+
+    if (timeout != 0) {
+        LV_LOG_INFO("Adaptive refresh: idle after %u ms, period %u ms", timeout, period);
+    }
+}
+
+void adaptive_refresh_add_display(lv_display_t *disp, uint32_t active_period)
+{
+    lv_timer_t *refr_timer;
+    adaptive_display_t *ad;
+
+    if (timeout == 0) {
+        return;
+    }
+
+    refr_timer = lv_display_get_refr_timer(disp);
+
+    if (refr_timer == NULL) {
+        return;
+    }
+
+    if (display_count == ADAPTIVE_REFRESH_MAX_DISPLAYS) {
+        LV_LOG_WARN("Adaptive refresh applied to the first %d displays only",
+                    ADAPTIVE_REFRESH_MAX_DISPLAYS);
+        return;
+    }
+
+    ad = &displays[display_count++];
+    memset(ad, 0, sizeof(*ad));
+    ad->disp = disp;
+    ad->refr_timer = refr_timer;
+    ad->active_period = active_period;
+    ad->last_activity = lv_tick_get();
+
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_INVALIDATE_AREA, ad);
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_REFR_READY, ad);
+}
+
+void adaptive_refresh_wake(lv_display_t *disp)
+{
+    adaptive_display_t *ad = find_display(disp);
+
+    if (ad == NULL) {
+        return;
+    }
+
+    ad->last_activity = lv_tick_get();
+
+    if (ad->idle) {
+        leave_idle(ad);
+    }
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Find the state of a display
+ *
+ * @param disp the LVGL display
+ * @return the state, NULL if the policy is not applied to the display
+ */
+static adaptive_display_t *find_display(lv_display_t *disp)
+{
+    uint32_t i;
+
+    for (i = 0; i < display_count; i++) {
+        if (displays[i].disp == disp) {
+            return &displays[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Track the activity of a display
+ *
+ * @description the animations and the input devices show their effect by
+ * invalidating areas, the display becomes idle when the refresh timer
+ * runs without anything invalidated during the timeout
+ * @note called by LVGL
+ */
+static void display_event_cb(lv_event_t *e)
+{
+    adaptive_display_t *ad = lv_event_get_user_data(e);
+
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_INVALIDATE_AREA:
+        ad->last_activity = lv_tick_get();
+        if (ad->idle) {
+            leave_idle(ad);
+        }
+        break;
+    case LV_EVENT_REFR_READY:
+        if (!ad->idle && lv_tick_elaps(ad->last_activity) >= timeout) {
+            enter_idle(ad);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Slow down or stop the refresh timer
+ *
+ * @param ad the state of the display
+ */
+static void enter_idle(adaptive_display_t *ad)
+{
+    /* A period set by the backend is already as slow */
+    if (period != 0 && period <= ad->active_period) {
+        return;
+    }
+
+    if (period == 0) {
+        lv_timer_pause(ad->refr_timer);
+    } else {
+        lv_timer_set_period(ad->refr_timer, period);
+    }
+
+    ad->idle = true;
+    LV_LOG_TRACE("Display %p idle", (void *)ad->disp);
+}
+
+/**
+ * Restore the refresh rate and render the next frame right away
+ *
+ * @param ad the state of the display
+ */
+static void leave_idle(adaptive_display_t *ad)
+{
+    lv_timer_set_period(ad->refr_timer, ad->active_period);
+    lv_timer_resume(ad->refr_timer);
+    lv_timer_ready(ad->refr_timer);
+
+    ad->idle = false;
+    LV_LOG_TRACE("Display %p active", (void *)ad->disp);
+}
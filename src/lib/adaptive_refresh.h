@@ -0,0 +1,81 @@
+/**
+ * @file adaptive_refresh.h
+ *
+ * Adaptive refresh rate
+ *
+ * Slows down or stops the refresh timer of the displays once nothing
+ * has been invalidated for a while, the full rate is restored and a
+ * frame is rendered right away as soon as an area is invalidated or an
+ * input event is received
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef ADAPTIVE_REFRESH_H
+#define ADAPTIVE_REFRESH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Configure the policy
+ * @description must be called before the displays are added
+ *
+ * @param idle_timeout the time in ms without invalidated areas after which
+ * the display is idle, 0 disables the policy
+ * @param idle_period the refresh period in ms of an idle display,
+ * 0 stops the refresh timer
+ */
+void adaptive_refresh_init(uint32_t idle_timeout, uint32_t idle_period);
+
+/**
+ * @brief Apply the policy to a display
+ * @description only for the displays rendered by their refresh timer, the
+ * ones driven by other means (vblank events, render threads) must not be
+ * added. Does nothing if the policy is disabled
+ *
+ * @param disp the display
+ * @param active_period the refresh period in ms set by the backend or
+ * the command line, restored once the display is active again
+ */
+void adaptive_refresh_add_display(lv_display_t *disp, uint32_t active_period);
+
+/**
+ * @brief Report an input event
+ * @description restores the refresh rate of an idle display, does
+ * nothing if the policy is not applied to the display
+ *
+ * @param disp the display the input device is bound to
+ */
+void adaptive_refresh_wake(lv_display_t *disp);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*ADAPTIVE_REFRESH_H*/
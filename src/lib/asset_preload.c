@@ -0,0 +1,452 @@
+/**
+ * @file asset_preload.c
+ *
+ * Startup preloading of the assets
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "lvgl/lvgl.h"
+
+#include "simulator_util.h"
+#include "thread_sched.h"
+#include "asset_preload.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Maximum number of assets that can be preloaded */
+#define MAX_ASSETS 256
+
+/* Characters rasterized when a font doesn't specify them */
+#define DEFAULT_FONT_CHARS " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ" \
+                           "[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~"
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef enum {
+    ASSET_IMAGE,
+    ASSET_FONT
+} asset_type_t;
+
+/* An asset of the manifest */
+typedef struct {
+    asset_type_t type;
+    char *path;          /* The LVGL path i.e A:/path/to/image.png */
+    int32_t size;        /* The size of a font */
+    char *chars;         /* The UTF-8 characters of a font to rasterize */
+    lv_font_t *font;     /* The loaded font */
+} asset_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static int read_manifest(const char *path);
+static int read_directory(const char *path);
+static bool is_image_file(const char *name);
+static void add_asset(asset_type_t type, const char *path, int32_t size, const char *chars);
+static void load_assets(void);
+static void load_image(asset_t *asset);
+static void load_font(asset_t *asset);
+static uint32_t utf8_next(const char *txt, uint32_t *i);
+#if LV_USE_OS != LV_OS_NONE
+static void *preload_thread(void *arg);
+#endif
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static asset_t assets[MAX_ASSETS];
+static uint32_t asset_count;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void asset_preload_configure_caches(void)
+{
+    const char *image_cache = getenv("LV_SIM_IMAGE_CACHE_SIZE");
+    const char *header_cache = getenv("LV_SIM_IMAGE_HEADER_CACHE_CNT");
+
+    if (image_cache != NULL) {
+        lv_image_cache_resize(atoi(image_cache) * 1024, true);
+    }
+
+    if (header_cache != NULL) {
+        lv_image_header_cache_resize(atoi(header_cache), true);
+    }
+}
+
+int asset_preload_start(const char *path, bool background)
+{
+    struct stat st;
+#if LV_USE_OS != LV_OS_NONE
+    int ret;
+    pthread_t thread;
+    pthread_attr_t attr;
+#endif
+
+    if (stat(path, &st) == -1) {
+        LV_LOG_ERROR("Unable to read %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    if (S_ISDIR(st.st_mode) ? read_directory(path) == -1 : read_manifest(path) == -1) {
+        return -1;
+    }
+
+    if (background) {
+#if LV_USE_OS != LV_OS_NONE
+        thread_sched_init_helper_attr(&attr);
+        ret = pthread_create(&thread, &attr, preload_thread, NULL);
+        pthread_attr_destroy(&attr);
+
+        if (ret == 0) {
+            pthread_detach(thread);
+            return 0;
+        }
+
+        LV_LOG_WARN("Failed to create the preload thread: %s", strerror(ret));
+#else
+        LV_LOG_WARN("Preloading in the background requires LV_USE_OS");
+#endif
+    }
+
+    load_assets();
+    return 0;
+}
+
+lv_font_t *asset_preload_get_font(const char *path, int32_t size)
+{
+    uint32_t i;
+
+    for (i = 0; i < asset_count; i++) {
+        if (assets[i].type == ASSET_FONT && assets[i].size == size &&
+            strcmp(assets[i].path, path) == 0) {
+            return assets[i].font;
+        }
+    }
+
+    return NULL;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Read the assets of a manifest
+ *
+ * @description empty lines and lines starting with # are ignored
+ * @param path the path of the manifest
+ * @return 0 on success, -1 on error
+ */
+static int read_manifest(const char *path)
+{
+    FILE *fp;
+    int n;
+    int size;
+    int chars_pos;
+    uint32_t line_nr = 0;
+    char line[1024];
+    char type[16];
+    char asset_path[PATH_MAX];
+
+    fp = fopen(path, "r");
+
+    if (fp == NULL) {
+        LV_LOG_ERROR("Unable to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+
+        line_nr++;
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+
+        chars_pos = 0;
+        n = sscanf(line, "%15s %4095s %d %n", type, asset_path, &size, &chars_pos);
+
+        if (n >= 2 && strcmp(type, "image") == 0) {
+            add_asset(ASSET_IMAGE, asset_path, 0, NULL);
+        } else if (n == 3 && strcmp(type, "font") == 0 && size > 0) {
+            add_asset(ASSET_FONT, asset_path, size,
+                      chars_pos > 0 && line[chars_pos] != '\0' ? line + chars_pos : NULL);
+        } else {
+            LV_LOG_WARN("%s:%u: invalid asset '%s'", path, line_nr, line);
+        }
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * Read the images of a directory
+ *
+ * @description the directory is accessed through the STDIO driver of LVGL
+ * @param path the path of the directory
+ * @return 0 on success, -1 on error
+ */
+static int read_directory(const char *path)
+{
+#if LV_USE_FS_STDIO
+    DIR *dir;
+    struct dirent *entry;
+    char asset_path[PATH_MAX];
+
+    dir = opendir(path);
+
+    if (dir == NULL) {
+        LV_LOG_ERROR("Unable to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (is_image_file(entry->d_name)) {
+            snprintf(asset_path, sizeof(asset_path), "%c:%s/%s",
+                     LV_FS_STDIO_LETTER, path, entry->d_name);
+            add_asset(ASSET_IMAGE, asset_path, 0, NULL);
+        }
+    }
+
+    closedir(dir);
+    return 0;
+#else
+    LV_LOG_ERROR("Preloading a directory requires LV_USE_FS_STDIO");
+    LV_UNUSED(path);
+    return -1;
+#endif
+}
+
+/**
+ * Check if a file is an image
+ *
+ * @param name the name of the file
+ * @return true if the extension is one of a supported image format
+ */
+static bool is_image_file(const char *name)
+{
+    const char *ext = strrchr(name, '.');
+
+    if (ext == NULL) {
+        return false;
+    }
+
+    return strcasecmp(ext, ".png") == 0 || strcasecmp(ext, ".jpg") == 0 ||
+           strcasecmp(ext, ".jpeg") == 0 || strcasecmp(ext, ".bmp") == 0 ||
+           strcasecmp(ext, ".bin") == 0;
+}
+
+/**
+ * Add an asset to preload
+ *
+ * @param type the type of the asset
+ * @param path the LVGL path of the asset
+ * @param size the size of a font
+ * @param chars the characters of a font, NULL for the default ones
+ */
+static void add_asset(asset_type_t type, const char *path, int32_t size, const char *chars)
+{
+    asset_t *asset;
+
+    if (asset_count == MAX_ASSETS) {
+        LV_LOG_WARN("Too many assets, ignoring %s", path);
+        return;
+    }
+
+    asset = &assets[asset_count++];
+    asset->type = type;
+    asset->path = strdup(path);
+    asset->size = size;
+    asset->chars = strdup(chars != NULL ? chars : DEFAULT_FONT_CHARS);
+    asset->font = NULL;
+}
+
+/**
+ * Load all the assets
+ *
+ * @description takes the LVGL lock for each asset, so that
+ * the UI is not blocked when loading in the background
+ */
+static void load_assets(void)
+{
+    uint32_t i;
+    uint64_t start = get_time_us();
+
+    for (i = 0; i < asset_count; i++) {
+
+#if LV_USE_OS != LV_OS_NONE
+        lv_lock();
+#endif
+
+        if (assets[i].type == ASSET_IMAGE) {
+            load_image(&assets[i]);
+        } else {
+            load_font(&assets[i]);
+        }
+
+#if LV_USE_OS != LV_OS_NONE
+        lv_unlock();
+#endif
+    }
+
+    LV_LOG_USER("Preloaded %u assets in %u ms", asset_count,
+                (uint32_t)((get_time_us() - start) / 1000));
+}
+
+/**
+ * Decode an image into the image cache
+ *
+ * @description the decoded image stays in the cache once the
+ * decoder is closed, as long as the cache is large enough
+ * @param asset the image
+ */
+static void load_image(asset_t *asset)
+{
+    lv_image_decoder_dsc_t dsc;
+
+    if (lv_image_decoder_open(&dsc, asset->path, NULL) != LV_RESULT_OK) {
+        LV_LOG_WARN("Unable to decode %s", asset->path);
+        return;
+    }
+
+    lv_image_decoder_close(&dsc);
+}
+
+/**
+ * Load a TrueType font and rasterize its glyphs
+ *
+ * @description the glyph cache of the font is sized with
+ * LV_SIM_GLYPH_CACHE_CNT, the number of characters by default
+ * @param asset the font
+ */
+static void load_font(asset_t *asset)
+{
+#if LV_USE_TINY_TTF
+    uint32_t i = 0;
+    uint32_t letter;
+    uint32_t count = 0;
+    size_t cache_cnt;
+    lv_font_glyph_dsc_t g;
+    lv_draw_buf_t *buf;
+    const char *env_cache = getenv("LV_SIM_GLYPH_CACHE_CNT");
+
+    while (utf8_next(asset->chars, &i) != 0) {
+        count++;
+    }
+
+    cache_cnt = env_cache != NULL ? (size_t)atoi(env_cache) :
+                LV_MAX(count, LV_TINY_TTF_CACHE_GLYPH_CNT);
+
+    asset->font = lv_tiny_ttf_create_file_ex(asset->path, asset->size,
+                                             LV_FONT_KERNING_NORMAL, cache_cnt);
+
+    if (asset->font == NULL) {
+        LV_LOG_WARN("Unable to load the font %s", asset->path);
+        return;
+    }
+
+    i = 0;
+
+    while ((letter = utf8_next(asset->chars, &i)) != 0) {
+
+        if (!lv_font_get_glyph_dsc(asset->font, &g, letter, 0) || g.box_w == 0) {
+            continue;
+        }
+
+        buf = lv_draw_buf_create(g.box_w, g.box_h, LV_COLOR_FORMAT_A8, 0);
+
+        if (buf == NULL) {
+            break;
+        }
+
+        lv_font_get_glyph_bitmap(&g, buf);
+        lv_font_glyph_release_draw_data(&g);
+        lv_draw_buf_destroy(buf);
+    }
+#else
+    LV_LOG_WARN("Unable to load the font %s, LV_USE_TINY_TTF is disabled", asset->path);
+#endif
+}
+
+/**
+ * Decode the next character of an UTF-8 string
+ *
+ * @param txt the string
+ * @param i the index of the next byte, updated
+ * @return the code point, 0 at the end of the string
+ */
+static uint32_t utf8_next(const char *txt, uint32_t *i)
+{
+    uint32_t len;
+    uint32_t cp;
+    uint8_t c = txt[*i];
+
+    if (c == 0) {
+        return 0;
+    }
+
+    if (c < 0x80) {
+        len = 1;
+        cp = c;
+    } else if ((c & 0xE0) == 0xC0) {
+        len = 2;
+        cp = c & 0x1F;
+    } else if ((c & 0xF0) == 0xE0) {
+        len = 3;
+        cp = c & 0x0F;
+    } else {
+        len = 4;
+        cp = c & 0x07;
+    }
+
+    (*i)++;
+
+    while (--len > 0 && (txt[*i] & 0xC0) == 0x80) {
+        cp = (cp << 6) | (txt[*i] & 0x3F);
+        (*i)++;
+    }
+
+    return cp;
+}
+
+#if LV_USE_OS != LV_OS_NONE
+/**
+ * Load the assets in the background
+ */
+static void *preload_thread(void *arg)
+{
+    LV_UNUSED(arg);
+
+    load_assets();
+    return NULL;
+}
+#endif
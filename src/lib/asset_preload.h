@@ -0,0 +1,84 @@
+/**
+ * @file asset_preload.h
+ *
+ * Startup preloading of the assets
+ *
+ * Decodes the images into the image cache and rasterizes the glyphs of
+ * the TrueType fonts before the first screen is shown, so that the first
+ * visit of a screen doesn't stall the UI thread. The size of the caches
+ * is configured at runtime
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef ASSET_PRELOAD_H
+#define ASSET_PRELOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Resize the image caches
+ * @description must be called after lv_init, the sizes are read from
+ * LV_SIM_IMAGE_CACHE_SIZE (KB) and LV_SIM_IMAGE_HEADER_CACHE_CNT,
+ * the lv_conf.h defaults are kept if they are not set
+ */
+void asset_preload_configure_caches(void);
+
+/**
+ * @brief Preload the assets of a manifest or a directory
+ * @description a manifest contains one asset per line:
+ *
+ *   image A:/path/to/image.png
+ *   font A:/path/to/font.ttf 24 [characters to rasterize]
+ *
+ * By default the printable ASCII characters of the fonts are rasterized.
+ * All the images of a directory are decoded. In the background the
+ * assets are loaded by a thread holding the LVGL lock for each of them,
+ * which requires LV_USE_OS
+ *
+ * @param path the path of the manifest or of the directory
+ * @param background load the assets from a thread instead of waiting
+ * @return 0 on success, -1 if the manifest can't be read
+ */
+int asset_preload_start(const char *path, bool background);
+
+/**
+ * @brief Get a font loaded by the preload
+ * @param path the path of the font as specified in the manifest
+ * @param size the size of the font
+ * @return the font, NULL if not loaded
+ */
+lv_font_t *asset_preload_get_font(const char *path, int32_t size);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*ASSET_PRELOAD_H*/
@@ -32,10 +32,23 @@ typedef lv_display_t *(*display_init_t)(void);
 /* Prototype of the run loop */
 typedef void (*run_loop_t)(void);
 
+/* Prototype of the timer handler called by the shared run loop,
+ * returns the time until the next LVGL timer is due like lv_timer_handler */
+typedef uint32_t (*timer_handler_t)(void);
+
+/* Prototype of the hardware cursor initialization, returns 0 if the
+ * cursor of the pointer device is displayed by the backend */
+typedef int (*cursor_init_t)(lv_indev_t *indev, const lv_image_dsc_t *icon);
+
 /* Represents a display driver handle */
 typedef struct {
     display_init_t init_display; /* The display creation/initialization function */
-    run_loop_t run_loop;         /* The run loop of the driver handle */
+    run_loop_t run_loop;         /* The run loop of the driver handle, NULL to use the shared one */
+    timer_handler_t timer_handler; /* Called by the shared run loop for every selected backend instead of lv_timer_handler, can be NULL */
+    cursor_init_t init_cursor;   /* Displays the cursor on a hardware plane, NULL if unsupported */
+    bool main_thread;            /* Only refreshed by the thread that initialized it, i.e. it owns a GL context */
+    uint32_t refr_period;        /* Period of the refresh timer in ms, init_display updates it when it sets another one */
+    bool refr_paced;             /* The frames are requested by the backend or a render thread, not by the refresh timer */
     lv_display_t *display;       /* The LVGL display that was created */
 } display_backend_t;
 
@@ -80,6 +93,8 @@ int backend_init_sdl(backend_t *backend);
 int backend_init_glfw3(backend_t *backend);
 int backend_init_wayland(backend_t *backend);
 int backend_init_x11(backend_t *backend);
+int backend_init_headless(backend_t *backend);
+int backend_init_rfb(backend_t *backend);
 
 /* Input device driver backends */
 int backend_init_evdev(backend_t *backend);
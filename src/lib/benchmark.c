@@ -0,0 +1,553 @@
+/**
+ * @file benchmark.c
+ *
+ * Benchmark mode of the simulator
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "lvgl/lvgl.h"
+#include "lvgl/demos/lv_demos.h"
+
+#include "simulator_util.h"
+#include "frame_stats.h"
+#include "draw_sw_bench.h"
+#include "frame_capture.h"
+#include "benchmark.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Maximum number of scenes in the list */
+#define BENCHMARK_MAX_SCENES 16
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* The results of a scene */
+typedef struct {
+    char *name;
+    uint64_t frames;
+    uint64_t elapsed_us;    /* Wall clock duration of the scene */
+    uint64_t cpu_us;        /* User and system CPU time */
+    double render_us;       /* Average render time excluding the flushes */
+    double flush_us;        /* Average time spent flushing or waiting for the flush */
+    uint64_t render_p50_us;
+    uint64_t render_p99_us;
+    uint64_t interval_p50_us; /* Frame interval percentiles */
+    uint64_t interval_p99_us;
+} scene_result_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void scene_timer_cb(lv_timer_t *timer);
+static void capture_timer_cb(lv_timer_t *timer);
+static void start_scene(void);
+static void end_scene(void);
+static void snapshot_scene(void);
+static void teardown_scene(void);
+static bool is_snapshot_timer(lv_timer_t *timer);
+static bool is_driver_timer(lv_timer_t *timer);
+static double ratio(double num, uint64_t elapsed_us);
+static void write_json_string(FILE *fp, const char *str);
+static uint64_t get_cpu_time_us(void);
+static void write_results(void);
+static void write_json(FILE *fp);
+static void write_kernels_json(FILE *fp);
+static void write_csv(FILE *fp);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static scene_result_t results[BENCHMARK_MAX_SCENES];
+static uint32_t scene_count;
+static uint32_t cur_scene;
+
+static const char *output_path;
+static const char *backend;
+static lv_display_t *bench_disp;
+static uint32_t scene_duration_ms;
+
+/* Timestamps of the current scene */
+static uint64_t scene_start_us;
+static uint64_t scene_start_cpu_us;
+
+/* The timers and display events that existed before the scene was created */
+static lv_timer_t **snapshot_timers;
+static uint32_t snapshot_timer_count;
+static uint32_t snapshot_timer_size;
+static uint32_t snapshot_event_count;
+
+/* The blend kernels, measured before the first scene */
+static draw_sw_bench_result_t kernels[DRAW_SW_BENCH_MAX_KERNELS];
+static uint32_t kernel_count;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int benchmark_start(const char *scenes, uint32_t duration,
+        const char *output, const char *backend_name)
+{
+    char *list;
+    char *name;
+    char *saveptr;
+    lv_display_t *disp = lv_display_get_default();
+
+    if (disp == NULL) {
+        LV_LOG_ERROR("The display backend must be initialized first");
+        return -1;
+    }
+
+    list = strdup(scenes);
+    LV_ASSERT_NULL(list);
+
+    scene_count = 0;
+    for (name = strtok_r(list, ",", &saveptr); name != NULL;
+         name = strtok_r(NULL, ",", &saveptr)) {
+
+        if (scene_count == BENCHMARK_MAX_SCENES) {
+            LV_LOG_ERROR("Too many scenes, max: %d", BENCHMARK_MAX_SCENES);
+            free(list);
+            return -1;
+        }
+
+        results[scene_count++].name = strdup(name);
+    }
+
+    free(list);
+
+    if (scene_count == 0) {
+        LV_LOG_ERROR("No scene to run");
+        return -1;
+    }
+
+    output_path = output;
+    backend = backend_name;
+    bench_disp = disp;
+    scene_duration_ms = duration * 1000;
+
+    if (frame_stats_attach(disp, backend_name) == -1) {
+        return -1;
+    }
+
+    /* Nothing is rendered yet, the kernels don't compete with a frame */
+    kernel_count = draw_sw_bench_run(kernels);
+
+    lv_timer_create(scene_timer_cb, scene_duration_ms, NULL);
+
+    cur_scene = 0;
+    start_scene();
+
+    return 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Switch to the next scene
+ *
+ * @note called by LVGL once the duration of the scene elapsed
+ */
+static void scene_timer_cb(lv_timer_t *timer)
+{
+    end_scene();
+    cur_scene++;
+
+    if (cur_scene < scene_count) {
+        start_scene();
+        return;
+    }
+
+    lv_timer_delete(timer);
+    write_results();
+    exit(EXIT_SUCCESS);
+}
+
+/**
+ * Capture a frame of the current scene
+ *
+ * @note called by LVGL halfway through the scene
+ */
+static void capture_timer_cb(lv_timer_t *timer)
+{
+    frame_capture_request(lv_timer_get_user_data(timer));
+}
+
+/**
+ * Create the current scene on a new screen
+ *
+ * @description the previous scene is torn down and its screen deleted,
+ * the demos are expected to only create objects on the active screen
+ */
+static void start_scene(void)
+{
+    lv_obj_t *old_scr = lv_screen_active();
+    lv_obj_t *scr;
+    char *name = results[cur_scene].name;
+    lv_timer_t *timer;
+
+    if (cur_scene > 0) {
+        teardown_scene();
+    }
+
+    scr = lv_obj_create(NULL);
+    lv_screen_load(scr);
+    lv_obj_delete(old_scr);
+
+    snapshot_scene();
+
+    if (!lv_demos_create(&name, 1)) {
+        die("Unknown benchmark scene: %s\n", name);
+    }
+
+    LV_LOG_USER("Running scene: %s", name);
+
+    /* Capture the scene once its animations are running */
+    if (frame_capture_is_enabled()) {
+        timer = lv_timer_create(capture_timer_cb, scene_duration_ms / 2, name);
+        lv_timer_set_repeat_count(timer, 1);
+    }
+
+    frame_stats_reset(bench_disp);
+    scene_start_us = get_time_us();
+    scene_start_cpu_us = get_cpu_time_us();
+}
+
+/**
+ * Record the results of the current scene
+ */
+static void end_scene(void)
+{
+    scene_result_t *r = &results[cur_scene];
+
+    r->elapsed_us = get_time_us() - scene_start_us;
+    r->cpu_us = get_cpu_time_us() - scene_start_cpu_us;
+    r->frames = frame_stats_get_count(bench_disp, FRAME_STATS_RENDER);
+    r->render_us = frame_stats_get_avg(bench_disp, FRAME_STATS_RENDER);
+    r->flush_us = frame_stats_get_avg(bench_disp, FRAME_STATS_FLUSH);
+    r->render_p50_us = frame_stats_get_percentile(bench_disp, FRAME_STATS_RENDER, 50);
+    r->render_p99_us = frame_stats_get_percentile(bench_disp, FRAME_STATS_RENDER, 99);
+    r->interval_p50_us = frame_stats_get_percentile(bench_disp, FRAME_STATS_INTERVAL, 50);
+    r->interval_p99_us = frame_stats_get_percentile(bench_disp, FRAME_STATS_INTERVAL, 99);
+}
+
+/**
+ * Remember the timers and display events existing before a scene is created
+ */
+static void snapshot_scene(void)
+{
+    lv_timer_t *timer;
+
+    snapshot_timer_count = 0;
+
+    for (timer = lv_timer_get_next(NULL); timer != NULL;
+         timer = lv_timer_get_next(timer)) {
+
+        if (snapshot_timer_count == snapshot_timer_size) {
+            snapshot_timer_size = snapshot_timer_size ? snapshot_timer_size * 2 : 32;
+            snapshot_timers = realloc(snapshot_timers,
+                                      snapshot_timer_size * sizeof(*snapshot_timers));
+            LV_ASSERT_NULL(snapshot_timers);
+        }
+
+        snapshot_timers[snapshot_timer_count++] = timer;
+    }
+
+    snapshot_event_count = lv_display_get_event_count(bench_disp);
+}
+
+/**
+ * Stop what the demo of the current scene left running
+ *
+ * @description the demos create timers and animations that refer to the
+ * objects of their screen, they must not run once the screen is deleted.
+ * Every timer and display event created since the snapshot is deleted,
+ * except the timers of the drivers, and all the animations are stopped
+ */
+static void teardown_scene(void)
+{
+    lv_timer_t *timer;
+    lv_timer_t *next;
+    uint32_t i;
+
+#if LV_USE_DEMO_MUSIC
+    if (strcmp(results[cur_scene - 1].name, "music") == 0) {
+        lv_demo_music_close();
+    }
+#endif
+
+    for (timer = lv_timer_get_next(NULL); timer != NULL; timer = next) {
+        next = lv_timer_get_next(timer);
+
+        if (!is_snapshot_timer(timer) && !is_driver_timer(timer)) {
+            lv_timer_delete(timer);
+        }
+    }
+
+    for (i = lv_display_get_event_count(bench_disp); i > snapshot_event_count; i--) {
+        lv_display_delete_event(bench_disp, i - 1);
+    }
+
+    lv_anim_delete_all();
+}
+
+/**
+ * Check if a timer existed before the current scene was created
+ *
+ * @param timer the timer
+ * @return true if the timer is in the snapshot
+ */
+static bool is_snapshot_timer(lv_timer_t *timer)
+{
+    uint32_t i;
+
+    for (i = 0; i < snapshot_timer_count; i++) {
+        if (snapshot_timers[i] == timer) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Check if a timer belongs to a display or an input device
+ *
+ * @param timer the timer
+ * @return true if it's the refresh timer of a display or the read timer of an input device
+ */
+static bool is_driver_timer(lv_timer_t *timer)
+{
+    lv_display_t *disp;
+    lv_indev_t *indev;
+
+    for (disp = lv_display_get_next(NULL); disp != NULL; disp = lv_display_get_next(disp)) {
+        if (lv_display_get_refr_timer(disp) == timer) {
+            return true;
+        }
+    }
+
+    for (indev = lv_indev_get_next(NULL); indev != NULL; indev = lv_indev_get_next(indev)) {
+        if (lv_indev_get_read_timer(indev) == timer) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Get the CPU time used by the process
+ *
+ * @return the sum of the user and system time in microseconds
+ */
+static uint64_t get_cpu_time_us(void)
+{
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 +
+           ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+/**
+ * Divide a count by the duration of a scene
+ *
+ * @param num the count
+ * @param elapsed_us the duration in microseconds
+ * @return the count per second, 0 if the scene has no duration
+ */
+static double ratio(double num, uint64_t elapsed_us)
+{
+    if (elapsed_us == 0) {
+        return 0.0;
+    }
+
+    return num * 1e6 / elapsed_us;
+}
+
+/**
+ * Write a quoted JSON string
+ *
+ * @param fp the output file
+ * @param str the string to escape
+ */
+static void write_json_string(FILE *fp, const char *str)
+{
+    const unsigned char *c;
+
+    fputc('"', fp);
+
+    for (c = (const unsigned char *)str; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(fp, "\\%c", *c);
+        } else if (*c < 0x20) {
+            fprintf(fp, "\\u%04x", *c);
+        } else {
+            fputc(*c, fp);
+        }
+    }
+
+    fputc('"', fp);
+}
+
+/**
+ * Write the results in the format matching the output file name
+ */
+static void write_results(void)
+{
+    FILE *fp = stdout;
+    size_t len;
+    bool csv = false;
+
+    if (output_path != NULL) {
+
+        fp = fopen(output_path, "w");
+
+        if (fp == NULL) {
+            die("Failed to open %s: %s\n", output_path, strerror(errno));
+        }
+
+        len = strlen(output_path);
+        csv = len > 4 && strcmp(output_path + len - 4, ".csv") == 0;
+    }
+
+    if (csv) {
+        write_csv(fp);
+    } else {
+        write_json(fp);
+    }
+
+    if (fp != stdout) {
+        fclose(fp);
+    }
+}
+
+/**
+ * Write the results as a JSON document
+ *
+ * @param fp the output file
+ */
+static void write_json(FILE *fp)
+{
+    uint32_t i;
+    scene_result_t *r;
+
+    fprintf(fp, "{\n  \"backend\": ");
+    write_json_string(fp, backend);
+    fprintf(fp, ",\n  \"scenes\": [\n");
+
+    for (i = 0; i < scene_count; i++) {
+
+        r = &results[i];
+
+        fprintf(fp, "    {\"scene\": ");
+        write_json_string(fp, r->name);
+        fprintf(fp, ", \"frames\": %llu, \"fps\": %.2f, "
+                "\"render_ms\": %.3f, \"flush_ms\": %.3f, "
+                "\"render_p50_ms\": %.3f, \"render_p99_ms\": %.3f, "
+                "\"frame_p50_ms\": %.3f, \"frame_p99_ms\": %.3f, "
+                "\"cpu_pct\": %.1f}%s\n",
+                (unsigned long long)r->frames,
+                ratio(r->frames, r->elapsed_us),
+                r->render_us / 1000.0,
+                r->flush_us / 1000.0,
+                r->render_p50_us / 1000.0,
+                r->render_p99_us / 1000.0,
+                r->interval_p50_us / 1000.0,
+                r->interval_p99_us / 1000.0,
+                ratio(r->cpu_us, r->elapsed_us) / 1e4,
+                i + 1 < scene_count ? "," : "");
+    }
+
+    fprintf(fp, "  ]");
+
+    write_kernels_json(fp);
+
+    fprintf(fp, "\n}\n");
+}
+
+/**
+ * Write the times of the LVGL blend kernels
+ *
+ * @description the speedup and the output check are only written if the
+ * scalar code was measured, i.e. with the AVX2 kernels
+ * @param fp the output file
+ */
+static void write_kernels_json(FILE *fp)
+{
+    uint32_t i;
+    draw_sw_bench_result_t *k;
+
+    fprintf(fp, ",\n  \"simd\": \"%s\",\n  \"kernels\": [\n", draw_sw_bench_get_kernels());
+
+    for (i = 0; i < kernel_count; i++) {
+
+        k = &kernels[i];
+
+        fprintf(fp, "    {\"kernel\": \"%s\", \"ns_px\": %.3f", k->name, k->ns);
+
+        if (k->scalar_ns > 0 && k->ns > 0) {
+            fprintf(fp, ", \"scalar_ns_px\": %.3f, \"speedup\": %.2f, \"identical\": %s",
+                    k->scalar_ns, k->scalar_ns / k->ns, k->identical ? "true" : "false");
+        }
+
+        fprintf(fp, "}%s\n", i + 1 < kernel_count ? "," : "");
+    }
+
+    fprintf(fp, "  ]");
+}
+
+/**
+ * Write the results as CSV, one line per scene
+ *
+ * @param fp the output file
+ */
+static void write_csv(FILE *fp)
+{
+    uint32_t i;
+    scene_result_t *r;
+
+    fprintf(fp, "backend,scene,frames,fps,render_ms,flush_ms,"
+            "render_p50_ms,render_p99_ms,frame_p50_ms,frame_p99_ms,cpu_pct\n");
+
+    for (i = 0; i < scene_count; i++) {
+
+        r = &results[i];
+
+        fprintf(fp, "%s,%s,%llu,%.2f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f\n",
+                backend, r->name, (unsigned long long)r->frames,
+                ratio(r->frames, r->elapsed_us),
+                r->render_us / 1000.0,
+                r->flush_us / 1000.0,
+                r->render_p50_us / 1000.0,
+                r->render_p99_us / 1000.0,
+                r->interval_p50_us / 1000.0,
+                r->interval_p99_us / 1000.0,
+                ratio(r->cpu_us, r->elapsed_us) / 1e4);
+    }
+}
@@ -0,0 +1,71 @@
+/**
+ * @file benchmark.h
+ *
+ * Benchmark mode of the simulator
+ *
+ * Runs a list of demo scenes for a fixed duration each on the
+ * selected display backend, measures the frame rate, the time spent
+ * rendering and flushing, the CPU usage and writes the results
+ * as JSON or CSV
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* The scene list used when none is specified */
+#define BENCHMARK_DEFAULT_SCENES "benchmark"
+
+/* The duration of each scene in seconds when none is specified */
+#define BENCHMARK_DEFAULT_DURATION 10
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Start the benchmark
+ * @description creates the first scene, the next ones are created
+ * by a timer, once the last scene completes the results are written
+ * and the program exits. Must be called after the display backend
+ * is initialized and before entering the run loop. If the frames are
+ * captured, a frame of each scene is captured halfway through it
+ *
+ * @param scenes comma separated list of demo names i.e "widgets,music"
+ * @param duration the duration of each scene in seconds
+ * @param output the path of the result file, the format is CSV if
+ * the name ends with .csv JSON otherwise. NULL to print to stdout
+ * @param backend_name the name of the display backend, included in the results
+ * @return 0 on success, -1 on error
+ */
+int benchmark_start(const char *scenes, uint32_t duration,
+        const char *output, const char *backend_name);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*BENCHMARK_H*/
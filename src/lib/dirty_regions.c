@@ -0,0 +1,432 @@
+/**
+ * @file dirty_regions.c
+ *
+ * Analysis of the invalidated areas
+ *
+ * The areas are read from the display when the rendering of a frame
+ * starts, LVGL has joined them at this point. The overlay wraps the
+ * flush callback of the backend and tints the rendered pixels before
+ * they are flushed, a timer invalidates them again to remove the tint
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "lvgl/lvgl.h"
+#include "lvgl/src/display/lv_display_private.h"
+
+#include "simulator_util.h"
+#include "dirty_regions.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Maximum number of displays that can be analysed */
+#define DIRTY_REGIONS_MAX_DISPLAYS 4
+
+/* Maximum number of tinted areas removed separately, the next ones are joined */
+#define DIRTY_REGIONS_MAX_FLASHED 16
+
+/* Number of tint colors, consecutive frames use different ones */
+#define TINT_CNT 4
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* The analysis of a display */
+typedef struct {
+    lv_display_t *disp;
+    const char *name;
+    lv_display_flush_cb_t flush_cb;       /* The flush callback of the backend */
+
+    /* Overlay */
+    bool overlay;
+    lv_timer_t *flash_timer;
+    lv_area_t flashed[DIRTY_REGIONS_MAX_FLASHED];
+    uint32_t flashed_count;
+    bool flash_pending;                   /* The flash timer is running */
+    bool clearing;                        /* The tint is being removed */
+    bool frame_clearing;                  /* The frame being rendered removes the tint */
+    bool invalidating;                    /* The tinted areas are being invalidated */
+    uint32_t tint;
+
+    /* State of the next frame */
+    uint32_t invalidated;
+
+    /* Summary */
+    uint64_t frames;
+    uint64_t full_frames;
+    uint64_t invalidated_sum;
+    uint64_t rendered_sum;
+    double fraction_sum;
+    uint32_t max_area_px;
+    int32_t max_area_w;
+    int32_t max_area_h;
+} region_stats_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static region_stats_t *find_stats(lv_display_t *disp);
+static void display_event_cb(lv_event_t *e);
+static void record_frame(region_stats_t *rs);
+static void flush_overlay_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map);
+static void tint_area(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map, uint32_t tint);
+static void flash_timer_cb(lv_timer_t *timer);
+static void print_at_exit(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static region_stats_t stats[DIRTY_REGIONS_MAX_DISPLAYS];
+static uint32_t stats_count;
+
+static uint32_t flash_time;
+
+/* Red, green, blue and yellow in XRGB8888 */
+static const uint32_t tint_colors[TINT_CNT] = {
+    0xff0000, 0x00ff00, 0x0000ff, 0xffff00
+};
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int dirty_regions_attach(lv_display_t *disp, const char *name, bool overlay)
+{
+    region_stats_t *rs;
+
+    LV_ASSERT_NULL(disp);
+
+    if (find_stats(disp) != NULL) {
+        return 0;
+    }
+
+    if (stats_count == DIRTY_REGIONS_MAX_DISPLAYS) {
+        LV_LOG_ERROR("Too many analysed displays, max: %d", DIRTY_REGIONS_MAX_DISPLAYS);
+        return -1;
+    }
+
+    rs = &stats[stats_count];
+    memset(rs, 0, sizeof(*rs));
+    rs->disp = disp;
+    rs->name = name;
+
+    if (overlay) {
+        flash_time = atoi(getenv_default("LV_SIM_DIRTY_OVERLAY_TIME", "0"));
+
+        if (flash_time == 0) {
+            flash_time = DIRTY_REGIONS_FLASH_TIME;
+        }
+
+        rs->flash_timer = lv_timer_create(flash_timer_cb, flash_time, rs);
+        LV_ASSERT_NULL(rs->flash_timer);
+        lv_timer_pause(rs->flash_timer);
+
+        rs->overlay = true;
+        rs->flush_cb = disp->flush_cb;
+        lv_display_set_flush_cb(disp, flush_overlay_cb);
+    }
+
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_ALL, rs);
+
+    if (stats_count == 0) {
+        atexit(print_at_exit);
+    }
+
+    stats_count++;
+    return 0;
+}
+
+void dirty_regions_print(FILE *fp)
+{
+    uint32_t i;
+    region_stats_t *rs;
+    uint32_t px_size;
+    int32_t hor_res;
+
+    for (i = 0; i < stats_count; i++) {
+
+        rs = &stats[i];
+
+        if (rs->frames == 0) {
+            continue;
+        }
+
+        px_size = lv_color_format_get_size(lv_display_get_color_format(rs->disp));
+        hor_res = lv_display_get_horizontal_resolution(rs->disp);
+
+        fprintf(fp, "\nInvalidated areas of %s - %llu frames\n", rs->name,
+                (unsigned long long)rs->frames);
+        fprintf(fp, "  full screen redraws: %llu (%.1f%%)\n",
+                (unsigned long long)rs->full_frames, 100.0 * rs->full_frames / rs->frames);
+        fprintf(fp, "  areas per frame:     %.1f invalidated, %.1f rendered after joining\n",
+                (double)rs->invalidated_sum / rs->frames, (double)rs->rendered_sum / rs->frames);
+        fprintf(fp, "  screen redrawn:      %.1f%% on average\n", 100.0 * rs->fraction_sum / rs->frames);
+        fprintf(fp, "  largest area:        %dx%d (%u px)\n",
+                rs->max_area_w, rs->max_area_h, rs->max_area_px);
+
+        /* A PARTIAL buffer of the display width renders the largest area at once */
+        fprintf(fp, "  buffer for it:       %u bytes, %u lines\n",
+                rs->max_area_px * px_size, (rs->max_area_px + hor_res - 1) / hor_res);
+    }
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Find the analysis of a display
+ *
+ * @param disp the LVGL display
+ * @return the analysis, NULL if the display is not analysed
+ */
+static region_stats_t *find_stats(lv_display_t *disp)
+{
+    uint32_t i;
+
+    for (i = 0; i < stats_count; i++) {
+        if (stats[i].disp == disp) {
+            return &stats[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Count the invalidated areas and record the frames
+ *
+ * @description the areas invalidated to remove the tint are not counted,
+ * a frame removing it is only recorded if other areas were invalidated
+ * @note called by LVGL
+ */
+static void display_event_cb(lv_event_t *e)
+{
+    region_stats_t *rs = lv_event_get_user_data(e);
+
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_INVALIDATE_AREA:
+        if (!rs->invalidating) {
+            rs->invalidated++;
+        }
+        break;
+    case LV_EVENT_RENDER_START:
+        rs->frame_clearing = rs->clearing;
+        rs->clearing = false;
+
+        if (!rs->frame_clearing || rs->invalidated > 0) {
+            record_frame(rs);
+        }
+
+        rs->invalidated = 0;
+        break;
+    case LV_EVENT_RENDER_READY:
+        if (rs->overlay && !rs->frame_clearing) {
+            /* Remove the tint of this frame and the next ones once the flash time has elapsed */
+            if (!rs->flash_pending) {
+                lv_timer_reset(rs->flash_timer);
+                lv_timer_resume(rs->flash_timer);
+                rs->flash_pending = true;
+            }
+            rs->tint = (rs->tint + 1) % TINT_CNT;
+        }
+        rs->frame_clearing = false;
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Record the areas of the frame being rendered
+ *
+ * @description the areas flagged as joined are included in another one
+ * and are not rendered. In a frame removing the tint, the rendered areas
+ * include the tinted ones
+ * @param rs the analysis of the display
+ */
+static void record_frame(region_stats_t *rs)
+{
+    uint32_t i;
+    uint32_t px;
+    uint32_t rendered = 0;
+    uint64_t frame_px = 0;
+    bool full = false;
+    lv_display_t *disp = rs->disp;
+    uint32_t screen_px = (uint32_t)disp->hor_res * disp->ver_res;
+    double fraction;
+
+    for (i = 0; i < disp->inv_p; i++) {
+
+        if (disp->inv_area_joined[i]) {
+            continue;
+        }
+
+        px = lv_area_get_size(&disp->inv_areas[i]);
+        frame_px += px;
+        rendered++;
+
+        if (px >= screen_px) {
+            full = true;
+        }
+
+        if (px > rs->max_area_px) {
+            rs->max_area_px = px;
+            rs->max_area_w = lv_area_get_width(&disp->inv_areas[i]);
+            rs->max_area_h = lv_area_get_height(&disp->inv_areas[i]);
+        }
+    }
+
+    /* The rendered areas can overlap */
+    fraction = LV_MIN((double)frame_px / screen_px, 1.0);
+
+    rs->frames++;
+    rs->full_frames += full;
+    rs->invalidated_sum += rs->invalidated;
+    rs->rendered_sum += rendered;
+    rs->fraction_sum += fraction;
+
+    fprintf(stdout, "dirty %s frame %llu: %u invalidated, %u rendered after joining, "
+            "%llu px (%.1f%%)%s%s\n", rs->name, (unsigned long long)rs->frames,
+            rs->invalidated, rendered, (unsigned long long)frame_px,
+            100.0 * fraction, full ? " full screen" : "",
+            rs->frame_clearing ? " overlay cleared" : "");
+}
+
+/**
+ * Tint the area before flushing it
+ *
+ * @note called by LVGL
+ */
+static void flush_overlay_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    lv_area_t *a;
+    region_stats_t *rs = find_stats(disp);
+
+    if (!rs->frame_clearing) {
+
+        tint_area(disp, area, px_map, tint_colors[rs->tint]);
+
+        if (rs->flashed_count < DIRTY_REGIONS_MAX_FLASHED) {
+            rs->flashed[rs->flashed_count++] = *area;
+        } else {
+            a = &rs->flashed[DIRTY_REGIONS_MAX_FLASHED - 1];
+            lv_area_join(a, a, area);
+        }
+    }
+
+    rs->flush_cb(disp, area, px_map);
+}
+
+/**
+ * Blend a color with the rendered pixels of an area
+ *
+ * @description the pixels are averaged with the color
+ * @param disp the LVGL display
+ * @param area the flushed area
+ * @param px_map the draw buffer, of the area in PARTIAL mode, of the display otherwise
+ * @param tint the XRGB8888 color
+ */
+static void tint_area(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map, uint32_t tint)
+{
+    int32_t x;
+    int32_t y;
+    uint8_t *row;
+    uint16_t *px16;
+    uint32_t *px32;
+    uint32_t stride;
+    uint16_t tint16;
+    lv_color_format_t cf = lv_display_get_color_format(disp);
+    uint32_t px_size = lv_color_format_get_size(cf);
+    int32_t w = lv_area_get_width(area);
+    int32_t h = lv_area_get_height(area);
+
+    if (disp->render_mode == LV_DISPLAY_RENDER_MODE_PARTIAL) {
+        stride = lv_draw_buf_width_to_stride(w, cf);
+        row = px_map;
+    } else {
+        stride = lv_display_get_buf_active(disp)->header.stride;
+        row = px_map + area->y1 * stride + area->x1 * px_size;
+    }
+
+    tint16 = ((tint >> 8) & 0xf800) | ((tint >> 5) & 0x07e0) | ((tint >> 3) & 0x001f);
+
+    for (y = 0; y < h; y++, row += stride) {
+
+        switch (cf) {
+        case LV_COLOR_FORMAT_RGB565:
+            px16 = (uint16_t *)row;
+            for (x = 0; x < w; x++) {
+                px16[x] = ((px16[x] >> 1) & 0x7bef) + ((tint16 >> 1) & 0x7bef);
+            }
+            break;
+        case LV_COLOR_FORMAT_XRGB8888:
+        case LV_COLOR_FORMAT_ARGB8888:
+            px32 = (uint32_t *)row;
+            for (x = 0; x < w; x++) {
+                px32[x] = (px32[x] & 0xff000000) |
+                          (((px32[x] >> 1) & 0x7f7f7f) + ((tint >> 1) & 0x7f7f7f));
+            }
+            break;
+        case LV_COLOR_FORMAT_RGB888:
+            for (x = 0; x < w; x++) {
+                row[x * 3] = (row[x * 3] + (tint & 0xff)) / 2;
+                row[x * 3 + 1] = (row[x * 3 + 1] + ((tint >> 8) & 0xff)) / 2;
+                row[x * 3 + 2] = (row[x * 3 + 2] + ((tint >> 16) & 0xff)) / 2;
+            }
+            break;
+        default:
+            return;
+        }
+    }
+}
+
+/**
+ * Redraw the tinted areas
+ *
+ * @note called by LVGL
+ */
+static void flash_timer_cb(lv_timer_t *timer)
+{
+    uint32_t i;
+    region_stats_t *rs = lv_timer_get_user_data(timer);
+
+    lv_timer_pause(timer);
+
+    rs->invalidating = true;
+
+    for (i = 0; i < rs->flashed_count; i++) {
+        lv_inv_area(rs->disp, &rs->flashed[i]);
+    }
+
+    rs->invalidating = false;
+
+    rs->flashed_count = 0;
+    rs->flash_pending = false;
+    rs->clearing = true;
+}
+
+/**
+ * Print the summary when the program exits
+ */
+static void print_at_exit(void)
+{
+    dirty_regions_print(stdout);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file dirty_regions.h
+ *
+ * Analysis of the invalidated areas
+ *
+ * Logs the invalidated areas of each frame of a display: how many were
+ * invalidated, how many remain once LVGL has joined them, the number of
+ * redrawn pixels and the fraction of the screen they cover. A summary
+ * with the draw buffer size required to render the largest area at once
+ * is printed at exit. Optionally the redrawn areas are tinted on screen
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef DIRTY_REGIONS_H
+#define DIRTY_REGIONS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Default time in ms the redrawn areas stay tinted */
+#define DIRTY_REGIONS_FLASH_TIME 200
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Start analysing the invalidated areas of a display
+ * @description a line is written to stdout for each rendered frame,
+ * the summary is printed at exit. With the overlay the flushed areas are
+ * tinted for LV_SIM_DIRTY_OVERLAY_TIME ms (default DIRTY_REGIONS_FLASH_TIME),
+ * the frames redrawing them afterwards are not logged. Must be called once
+ * the flush callback of the display is set
+ *
+ * @param disp the LVGL display
+ * @param name the name displayed in the log, i.e the name of the backend
+ * @param overlay tint the redrawn areas
+ * @return 0 on success, -1 on error
+ */
+int dirty_regions_attach(lv_display_t *disp, const char *name, bool overlay);
+
+/**
+ * @brief Print the summary of all the displays
+ * @param fp the output file
+ */
+void dirty_regions_print(FILE *fp);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*DIRTY_REGIONS_H*/
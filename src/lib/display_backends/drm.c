@@ -16,29 +16,162 @@
 /*********************
  *      INCLUDES
  *********************/
+
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
 
 #include "lvgl/lvgl.h"
 #if LV_USE_LINUX_DRM
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
 #include "../simulator_util.h"
 #include "../simulator_settings.h"
+#include "../driver_backends.h"
+#include "../display_buffers.h"
+#include "../splash.h"
 #include "../backends.h"
 
 /*********************
  *      DEFINES
  *********************/
 
+/* Period of the refresh timer when rendering is paced by vblank events,
+ * the timer never expires: frames are only rendered from the vblank handler */
+#define DRM_VBLANK_REFR_PERIOD UINT32_MAX
+
+/* Size of the cursor plane buffer if the driver doesn't report it */
+#define DRM_CURSOR_DEFAULT_SIZE 64
+
+/* Number of dumb buffers LVGL renders into, one is scanned out while
+ * the other is rendered */
+#define DRM_BUF_COUNT 2
+
 /**********************
  *      TYPEDEFS
  **********************/
 
+/* Properties of a plane set by the atomic commits */
+typedef enum {
+    PLANE_PROP_FB_ID,
+    PLANE_PROP_CRTC_ID,
+    PLANE_PROP_CRTC_X,
+    PLANE_PROP_CRTC_Y,
+    PLANE_PROP_CRTC_W,
+    PLANE_PROP_CRTC_H,
+    PLANE_PROP_SRC_X,
+    PLANE_PROP_SRC_Y,
+    PLANE_PROP_SRC_W,
+    PLANE_PROP_SRC_H,
+    PLANE_PROP_COUNT
+} plane_prop_t;
+
+/* A dumb buffer LVGL renders into */
+typedef struct {
+    uint32_t handle;
+    uint32_t fb_id;
+    uint32_t pitch;
+    uint64_t size;
+    uint8_t *map;
+} drm_buffer_t;
+
+/* The display, the backend owns the file descriptor and all the commits
+ * so that the cursor plane and the splash can follow its page flips */
+typedef struct {
+    lv_display_t *disp;
+    int fd;                /* DRM master */
+    uint32_t conn_id;
+    uint32_t crtc_id;
+    uint32_t plane_id;     /* The primary plane */
+    uint32_t plane_props[PLANE_PROP_COUNT];
+    uint32_t conn_crtc_prop;
+    uint32_t crtc_mode_prop;
+    uint32_t crtc_active_prop;
+    uint32_t mode_blob;
+    drmModeModeInfo mode;
+    drm_buffer_t bufs[DRM_BUF_COUNT];
+    bool mode_set;         /* The mode was set by a first commit */
+    bool flip_pending;     /* A page flip was committed and not completed yet */
+} drm_dev_t;
+
+/* The state of the vblank paced rendering */
+typedef struct {
+    lv_display_t *disp;
+    int fd;              /* A second file descriptor opened on the card */
+    uint32_t pipe;       /* The index of the CRTC driving the display */
+    bool pending;        /* A vblank event has been requested */
+    bool dirty;          /* The display was invalidated since the last frame */
+} drm_vblank_t;
+
+/* The state of the cursor displayed on a hardware plane */
+typedef struct {
+    lv_indev_t *indev;     /* The pointer device, NULL if the plane is unused */
+    int fd;                /* The DRM master file descriptor of the display */
+    uint32_t crtc_id;
+    uint32_t plane_id;
+    uint32_t props[PLANE_PROP_COUNT];
+    uint32_t handle;       /* The handle of the dumb buffer holding the cursor image */
+    uint32_t fb_id;
+    uint32_t width;
+    uint32_t height;
+    lv_point_t pos;        /* The position of the last committed update */
+    bool enabled;          /* The framebuffer is attached to the plane */
+    bool pending;          /* The pointer moved since the last committed update */
+    lv_point_t next;       /* The position to commit */
+    uint32_t flips;        /* Number of page flips committed by the display */
+    uint32_t seen_flips;   /* Value of flips when the pointer was last read */
+    lv_indev_read_cb_t read_cb; /* The read callback of the pointer device */
+} drm_cursor_t;
+
+/**********************
+ *  EXTERNAL VARIABLES
+ **********************/
+extern simulator_settings_t settings;
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
-static void run_loop_drm(void);
 static lv_display_t *init_drm(void);
+static int open_display(const char *device);
+static void close_display(void);
+static int create_buffer(drm_buffer_t *buf);
+static void destroy_buffer(drm_buffer_t *buf);
+static uint32_t get_prop_id(int fd, uint32_t obj_id, uint32_t obj_type, const char *name);
+static uint64_t get_plane_type(int fd, uint32_t plane_id);
+static int get_plane_props(int fd, uint32_t plane_id, uint32_t *props);
+static int find_primary_plane(int fd, int crtc_idx);
+static int commit_frame(drm_buffer_t *buf);
+static void page_flip_handler(int fd, unsigned int sequence,
+        unsigned int tv_sec, unsigned int tv_usec, void *user_data);
+static void wait_page_flip(void);
+static void flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map);
+static void flush_wait_cb(lv_display_t *disp);
+static void render_start_cb(lv_event_t *e);
+static int init_vblank(lv_display_t *disp, const char *device);
+static int find_crtc_index(int fd, uint32_t *crtc_id);
+static int show_splash(void);
+static int find_connector(int fd, uint32_t *conn_id, drmModeModeInfo *mode);
+static void release_splash(void);
+static int request_vblank(void);
+static void vblank_handler(int fd, unsigned int sequence,
+        unsigned int tv_sec, unsigned int tv_usec, void *user_data);
+static void drm_fd_ready_cb(int fd, uint32_t events, void *user_data);
+static void invalidate_area_cb(lv_event_t *e);
+static int init_cursor_plane(lv_indev_t *indev, const lv_image_dsc_t *icon);
+static int find_cursor_plane(int fd, int crtc_idx);
+static int create_cursor_buffer(const lv_image_dsc_t *icon);
+static void destroy_cursor_buffer(void);
+static void add_cursor_props(drmModeAtomicReqPtr req, const lv_point_t *pos);
+static int commit_cursor(const lv_point_t *pos, uint32_t flags);
+static void cursor_read_cb(lv_indev_t *indev, lv_indev_data_t *data);
+static void cursor_indev_deleted_cb(lv_event_t *e);
 
 
 /**********************
@@ -46,6 +179,22 @@ static lv_display_t *init_drm(void);
  **********************/
 static char *backend_name = "DRM";
 
+static display_backend_t *display_backend;
+
+static drm_dev_t drm_dev = { .fd = -1 };
+
+static drm_vblank_t vblank = { .fd = -1 };
+
+static drm_cursor_t cursor = { .fd = -1 };
+
+/* The framebuffer displaying the cached first frame until LVGL takes over */
+static drm_buffer_t splash_buf;
+
+static const char *plane_prop_names[PLANE_PROP_COUNT] = {
+    "FB_ID", "CRTC_ID", "CRTC_X", "CRTC_Y", "CRTC_W", "CRTC_H",
+    "SRC_X", "SRC_Y", "SRC_W", "SRC_H"
+};
+
 /**********************
  *      MACROS
  **********************/
@@ -68,7 +217,11 @@ int backend_init_drm(backend_t *backend)
     LV_ASSERT_NULL(backend->handle->display);
 
     backend->handle->display->init_display = init_drm;
-    backend->handle->display->run_loop = run_loop_drm;
+    backend->handle->display->run_loop = NULL;
+    backend->handle->display->timer_handler = NULL;
+    backend->handle->display->init_cursor = init_cursor_plane;
+    backend->handle->display->main_thread = false;
+    display_backend = backend->handle->display;
     backend->name = backend_name;
     backend->type = BACKEND_DISPLAY;
 
@@ -82,36 +235,1247 @@ int backend_init_drm(backend_t *backend)
 /**
  * Initialize the DRM display driver
  *
+ * @description LVGL renders directly into two dumb buffers which are
+ * flipped with atomic commits of the backend
  * @return the LVGL display
  */
 static lv_display_t *init_drm(void)
 {
+    int i;
     const char *device = getenv_default("LV_LINUX_DRM_CARD", "/dev/dri/card0");
-    lv_display_t * disp = lv_linux_drm_create();
+    bool vsync = settings.vsync || atoi(getenv_default("LV_LINUX_DRM_VSYNC", "0"));
+    lv_display_t * disp;
+
+    display_buffers_warn_unsupported(backend_name);
+
+    if (open_display(device) == -1) {
+        return NULL;
+    }
+
+    disp = lv_display_create(drm_dev.mode.hdisplay, drm_dev.mode.vdisplay);
 
     if (disp == NULL) {
+        close_display();
         return NULL;
     }
 
-    lv_linux_drm_set_file(disp, device, -1);
+    drm_dev.disp = disp;
+
+    lv_display_set_color_format(disp, LV_COLOR_FORMAT_XRGB8888);
+    lv_display_set_buffers_with_stride(disp, drm_dev.bufs[0].map, drm_dev.bufs[1].map,
+            drm_dev.bufs[0].size, drm_dev.bufs[0].pitch, LV_DISPLAY_RENDER_MODE_DIRECT);
+    lv_display_set_flush_cb(disp, flush_cb);
+    lv_display_set_flush_wait_cb(disp, flush_wait_cb);
+    lv_display_add_event_cb(disp, render_start_cb, LV_EVENT_RENDER_START, NULL);
+
+    /* Complete the page flip of the last frame while the display is idle */
+    if (driver_backends_watch_fd(drm_dev.fd, EPOLLIN, drm_fd_ready_cb, NULL) == -1) {
+        lv_display_delete(disp);
+        close_display();
+        return NULL;
+    }
+
+    for (i = 0; i < DRM_BUF_COUNT; i++) {
+        memset(drm_dev.bufs[i].map, 0, drm_dev.bufs[i].size);
+    }
+
+    LV_LOG_INFO("Rendering into %s (%dx%d)", device,
+            drm_dev.mode.hdisplay, drm_dev.mode.vdisplay);
+
+    if (vsync && init_vblank(disp, device) == -1) {
+        LV_LOG_WARN("vblank pacing unavailable - using the refresh timer");
+    }
 
     return disp;
 }
 
+/**
+ * Open the card and create the buffers of the display
+ *
+ * @description uses the preferred mode of the first connected connector,
+ * the mode is set by the commit of the first frame. The splash is shown
+ * as soon as the mode is known
+ * @param device the path of the DRM card
+ * @return 0 on success, -1 on error
+ */
+static int open_display(const char *device)
+{
+    int i;
+    int crtc_idx;
+
+    /* Nonblocking, the page flip events are also read from the run loop */
+    drm_dev.fd = open(device, O_RDWR | O_CLOEXEC | O_NONBLOCK);
+
+    if (drm_dev.fd == -1) {
+        LV_LOG_ERROR("Failed to open %s: %s", device, strerror(errno));
+        return -1;
+    }
+
+    if (drmSetClientCap(drm_dev.fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) != 0 ||
+        drmSetClientCap(drm_dev.fd, DRM_CLIENT_CAP_ATOMIC, 1) != 0) {
+        LV_LOG_ERROR("Atomic modesetting unsupported by %s", device);
+        goto err;
+    }
+
+    crtc_idx = find_crtc_index(drm_dev.fd, &drm_dev.crtc_id);
+
+    if (crtc_idx == -1 || find_connector(drm_dev.fd, &drm_dev.conn_id, &drm_dev.mode) == -1 ||
+        find_primary_plane(drm_dev.fd, crtc_idx) == -1) {
+        goto err;
+    }
+
+    if (splash_available() && show_splash() == -1) {
+        release_splash();
+    }
+
+    drm_dev.conn_crtc_prop = get_prop_id(drm_dev.fd, drm_dev.conn_id,
+                                         DRM_MODE_OBJECT_CONNECTOR, "CRTC_ID");
+    drm_dev.crtc_mode_prop = get_prop_id(drm_dev.fd, drm_dev.crtc_id,
+                                         DRM_MODE_OBJECT_CRTC, "MODE_ID");
+    drm_dev.crtc_active_prop = get_prop_id(drm_dev.fd, drm_dev.crtc_id,
+                                           DRM_MODE_OBJECT_CRTC, "ACTIVE");
+
+    if (drm_dev.conn_crtc_prop == 0 || drm_dev.crtc_mode_prop == 0 ||
+        drm_dev.crtc_active_prop == 0) {
+        LV_LOG_ERROR("Missing connector or CRTC properties");
+        goto err;
+    }
+
+    if (drmModeCreatePropertyBlob(drm_dev.fd, &drm_dev.mode, sizeof(drm_dev.mode),
+                                  &drm_dev.mode_blob) != 0) {
+        LV_LOG_ERROR("Failed to create the mode blob: %s", strerror(errno));
+        goto err;
+    }
+
+    for (i = 0; i < DRM_BUF_COUNT; i++) {
+        if (create_buffer(&drm_dev.bufs[i]) == -1) {
+            goto err;
+        }
+    }
+
+    drm_dev.mode_set = false;
+    drm_dev.flip_pending = false;
+
+    return 0;
+
+err:
+    close_display();
+    return -1;
+}
+
+/**
+ * Release the buffers and close the card
+ *
+ * @description can be called when it was partially set up
+ */
+static void close_display(void)
+{
+    int i;
+
+    release_splash();
+
+    for (i = 0; i < DRM_BUF_COUNT; i++) {
+        destroy_buffer(&drm_dev.bufs[i]);
+    }
+
+    if (drm_dev.mode_blob != 0) {
+        drmModeDestroyPropertyBlob(drm_dev.fd, drm_dev.mode_blob);
+        drm_dev.mode_blob = 0;
+    }
+
+    if (drm_dev.fd != -1) {
+        close(drm_dev.fd);
+        drm_dev.fd = -1;
+    }
+}
+
+/**
+ * Create a mapped XRGB8888 dumb buffer of the size of the mode
+ *
+ * @param buf the buffer
+ * @return 0 on success, -1 on error
+ */
+static int create_buffer(drm_buffer_t *buf)
+{
+    uint32_t handles[4] = { 0 };
+    uint32_t pitches[4] = { 0 };
+    uint32_t offsets[4] = { 0 };
+    struct drm_mode_create_dumb creq;
+    struct drm_mode_map_dumb mreq;
+
+    memset(&creq, 0, sizeof(creq));
+    creq.width = drm_dev.mode.hdisplay;
+    creq.height = drm_dev.mode.vdisplay;
+    creq.bpp = 32;
+
+    if (drmIoctl(drm_dev.fd, DRM_IOCTL_MODE_CREATE_DUMB, &creq) != 0) {
+        LV_LOG_ERROR("Failed to create dumb buffer: %s", strerror(errno));
+        return -1;
+    }
+
+    buf->handle = creq.handle;
+    buf->pitch = creq.pitch;
+    buf->size = creq.size;
+
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.handle = creq.handle;
+
+    if (drmIoctl(drm_dev.fd, DRM_IOCTL_MODE_MAP_DUMB, &mreq) != 0) {
+        LV_LOG_ERROR("Failed to map dumb buffer: %s", strerror(errno));
+        return -1;
+    }
+
+    buf->map = mmap(NULL, creq.size, PROT_READ | PROT_WRITE, MAP_SHARED, drm_dev.fd, mreq.offset);
+
+    if (buf->map == MAP_FAILED) {
+        LV_LOG_ERROR("Failed to map dumb buffer: %s", strerror(errno));
+        buf->map = NULL;
+        return -1;
+    }
+
+    handles[0] = creq.handle;
+    pitches[0] = creq.pitch;
+
+    if (drmModeAddFB2(drm_dev.fd, creq.width, creq.height, DRM_FORMAT_XRGB8888,
+                      handles, pitches, offsets, &buf->fb_id, 0) != 0) {
+        LV_LOG_ERROR("Failed to add framebuffer: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Release a dumb buffer
+ *
+ * @description can be called when it was partially created
+ * @param buf the buffer
+ */
+static void destroy_buffer(drm_buffer_t *buf)
+{
+    struct drm_mode_destroy_dumb dreq;
+
+    if (buf->fb_id != 0) {
+        drmModeRmFB(drm_dev.fd, buf->fb_id);
+        buf->fb_id = 0;
+    }
+
+    if (buf->map != NULL) {
+        munmap(buf->map, buf->size);
+        buf->map = NULL;
+    }
+
+    if (buf->handle != 0) {
+        memset(&dreq, 0, sizeof(dreq));
+        dreq.handle = buf->handle;
+        drmIoctl(drm_dev.fd, DRM_IOCTL_MODE_DESTROY_DUMB, &dreq);
+        buf->handle = 0;
+    }
+}
+
+/**
+ * Find the id of a property of a DRM object
+ *
+ * @param fd the file descriptor of the DRM card
+ * @param obj_id the id of the object
+ * @param obj_type the type of the object i.e DRM_MODE_OBJECT_CRTC
+ * @param name the name of the property
+ * @return the id of the property, 0 if not found
+ */
+static uint32_t get_prop_id(int fd, uint32_t obj_id, uint32_t obj_type, const char *name)
+{
+    uint32_t i;
+    uint32_t id = 0;
+    drmModeObjectProperties *props;
+    drmModePropertyRes *prop;
+
+    props = drmModeObjectGetProperties(fd, obj_id, obj_type);
+
+    for (i = 0; props != NULL && id == 0 && i < props->count_props; i++) {
+        prop = drmModeGetProperty(fd, props->props[i]);
+        if (prop != NULL && strcmp(prop->name, name) == 0) {
+            id = prop->prop_id;
+        }
+        drmModeFreeProperty(prop);
+    }
+
+    drmModeFreeObjectProperties(props);
+
+    return id;
+}
+
+/**
+ * Get the type of a plane
+ *
+ * @param fd the file descriptor of the DRM card
+ * @param plane_id the id of the plane
+ * @return DRM_PLANE_TYPE_PRIMARY, DRM_PLANE_TYPE_CURSOR or DRM_PLANE_TYPE_OVERLAY
+ */
+static uint64_t get_plane_type(int fd, uint32_t plane_id)
+{
+    uint32_t i;
+    uint64_t type = DRM_PLANE_TYPE_OVERLAY;
+    drmModeObjectProperties *props;
+    drmModePropertyRes *prop;
+
+    props = drmModeObjectGetProperties(fd, plane_id, DRM_MODE_OBJECT_PLANE);
+
+    for (i = 0; props != NULL && i < props->count_props; i++) {
+        prop = drmModeGetProperty(fd, props->props[i]);
+        if (prop != NULL && strcmp(prop->name, "type") == 0) {
+            type = props->prop_values[i];
+        }
+        drmModeFreeProperty(prop);
+    }
+
+    drmModeFreeObjectProperties(props);
+
+    return type;
+}
+
+/**
+ * Look up the ids of the properties of a plane set by the commits
+ *
+ * @param fd the file descriptor of the DRM card
+ * @param plane_id the id of the plane
+ * @param props set to the ids, indexed by plane_prop_t
+ * @return 0 on success, -1 if a property is missing
+ */
+static int get_plane_props(int fd, uint32_t plane_id, uint32_t *props)
+{
+    int i;
+
+    for (i = 0; i < PLANE_PROP_COUNT; i++) {
+        props[i] = get_prop_id(fd, plane_id, DRM_MODE_OBJECT_PLANE, plane_prop_names[i]);
+
+        if (props[i] == 0) {
+            LV_LOG_WARN("Plane %u has no %s property", plane_id, plane_prop_names[i]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Find the primary plane of a CRTC
+ *
+ * @param fd the file descriptor of the DRM card
+ * @param crtc_idx the index of the CRTC
+ * @return 0 on success, -1 if not found
+ */
+static int find_primary_plane(int fd, int crtc_idx)
+{
+    uint32_t i;
+    drmModePlaneRes *planes;
+    drmModePlane *plane;
+
+    drm_dev.plane_id = 0;
+    planes = drmModeGetPlaneResources(fd);
+
+    if (planes == NULL) {
+        LV_LOG_ERROR("drmModeGetPlaneResources failed: %s", strerror(errno));
+        return -1;
+    }
+
+    for (i = 0; i < planes->count_planes && drm_dev.plane_id == 0; i++) {
+
+        plane = drmModeGetPlane(fd, planes->planes[i]);
+
+        if (plane != NULL && (plane->possible_crtcs & (1 << crtc_idx)) &&
+            get_plane_type(fd, plane->plane_id) == DRM_PLANE_TYPE_PRIMARY) {
+            drm_dev.plane_id = plane->plane_id;
+        }
+
+        drmModeFreePlane(plane);
+    }
+
+    drmModeFreePlaneResources(planes);
+
+    if (drm_dev.plane_id == 0) {
+        LV_LOG_ERROR("No primary plane found");
+        return -1;
+    }
+
+    return get_plane_props(fd, drm_dev.plane_id, drm_dev.plane_props);
+}
+
+/**
+ * Commit a page flip to a buffer
+ *
+ * @description the first commit sets the mode. The pending position of
+ * the cursor plane is added to the request, so that moving the cursor
+ * while the display refreshes never requires a second commit racing
+ * with the page flip. The cursor never makes the page flip fail
+ *
+ * @param buf the buffer to display
+ * @return 0 on success, -1 on error
+ */
+static int commit_frame(drm_buffer_t *buf)
+{
+    int ret;
+    int err;
+    int mark;
+    bool folded = false;
+    uint32_t *p = drm_dev.plane_props;
+    uint32_t flags = DRM_MODE_PAGE_FLIP_EVENT | DRM_MODE_ATOMIC_NONBLOCK;
+    drmModeAtomicReq *req = drmModeAtomicAlloc();
+
+    if (req == NULL) {
+        return -1;
+    }
+
+    drmModeAtomicAddProperty(req, drm_dev.plane_id, p[PLANE_PROP_FB_ID], buf->fb_id);
+
+    if (!drm_dev.mode_set) {
+        flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+        drmModeAtomicAddProperty(req, drm_dev.conn_id, drm_dev.conn_crtc_prop, drm_dev.crtc_id);
+        drmModeAtomicAddProperty(req, drm_dev.crtc_id, drm_dev.crtc_mode_prop, drm_dev.mode_blob);
+        drmModeAtomicAddProperty(req, drm_dev.crtc_id, drm_dev.crtc_active_prop, 1);
+        drmModeAtomicAddProperty(req, drm_dev.plane_id, p[PLANE_PROP_CRTC_ID], drm_dev.crtc_id);
+        drmModeAtomicAddProperty(req, drm_dev.plane_id, p[PLANE_PROP_CRTC_X], 0);
+        drmModeAtomicAddProperty(req, drm_dev.plane_id, p[PLANE_PROP_CRTC_Y], 0);
+        drmModeAtomicAddProperty(req, drm_dev.plane_id, p[PLANE_PROP_CRTC_W], drm_dev.mode.hdisplay);
+        drmModeAtomicAddProperty(req, drm_dev.plane_id, p[PLANE_PROP_CRTC_H], drm_dev.mode.vdisplay);
+        drmModeAtomicAddProperty(req, drm_dev.plane_id, p[PLANE_PROP_SRC_X], 0);
+        drmModeAtomicAddProperty(req, drm_dev.plane_id, p[PLANE_PROP_SRC_Y], 0);
+        /* The source rectangle is in 16.16 fixed point */
+        drmModeAtomicAddProperty(req, drm_dev.plane_id, p[PLANE_PROP_SRC_W],
+                                 (uint64_t)drm_dev.mode.hdisplay << 16);
+        drmModeAtomicAddProperty(req, drm_dev.plane_id, p[PLANE_PROP_SRC_H],
+                                 (uint64_t)drm_dev.mode.vdisplay << 16);
+    }
+
+    mark = drmModeAtomicGetCursor(req);
+
+    if (cursor.indev != NULL) {
+        cursor.flips++;
+
+        if (cursor.pending) {
+            add_cursor_props(req, &cursor.next);
+            folded = true;
+        }
+    }
+
+    ret = drmModeAtomicCommit(drm_dev.fd, req, flags, &drm_dev);
+
+    if (ret != 0 && folded) {
+        err = errno;
+        drmModeAtomicSetCursor(req, mark);
+        folded = false;
+        ret = drmModeAtomicCommit(drm_dev.fd, req, flags, &drm_dev);
+
+        if (ret == 0) {
+            LV_LOG_WARN("Cursor plane update rejected: %s", strerror(err));
+        }
+    }
+
+    drmModeAtomicFree(req);
+
+    if (ret != 0) {
+        LV_LOG_ERROR("Page flip failed: %s", strerror(errno));
+        return -1;
+    }
+
+    if (folded) {
+        cursor.enabled = true;
+        cursor.pos = cursor.next;
+        cursor.pending = false;
+    }
+
+    drm_dev.mode_set = true;
+    drm_dev.flip_pending = true;
+
+    return 0;
+}
+
+/**
+ * Complete a page flip
+ *
+ * @description the buffer that was displayed can be rendered into
+ * again. Once the first frame is on screen the splash is released
+ * @note called by drmHandleEvent
+ */
+static void page_flip_handler(int fd, unsigned int sequence,
+        unsigned int tv_sec, unsigned int tv_usec, void *user_data)
+{
+    drm_dev_t *dev = user_data;
+
+    LV_UNUSED(fd);
+    LV_UNUSED(sequence);
+    LV_UNUSED(tv_sec);
+    LV_UNUSED(tv_usec);
+
+    dev->flip_pending = false;
+    release_splash();
+    lv_display_flush_ready(dev->disp);
+}
+
+/**
+ * Wait for the completion of the pending page flip
+ */
+static void wait_page_flip(void)
+{
+    struct pollfd pfd;
+    drmEventContext evctx;
+
+    memset(&evctx, 0, sizeof(evctx));
+    evctx.version = 2;
+    evctx.page_flip_handler = page_flip_handler;
+
+    pfd.fd = drm_dev.fd;
+    pfd.events = POLLIN;
+
+    while (drm_dev.flip_pending) {
+
+        if (poll(&pfd, 1, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            LV_LOG_ERROR("Failed to wait for the page flip: %s", strerror(errno));
+            drm_dev.flip_pending = false;
+            break;
+        }
+
+        drmHandleEvent(drm_dev.fd, &evctx);
+    }
+}
+
+/**
+ * Flip to the rendered buffer
+ *
+ * @description in DIRECT mode the whole buffer is flipped once the
+ * last area is flushed, the flush completes with the page flip
+ * @note called by LVGL
+ */
+static void flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    int i;
+    drm_buffer_t *buf = NULL;
+
+    LV_UNUSED(area);
+
+    if (!lv_display_flush_is_last(disp)) {
+        lv_display_flush_ready(disp);
+        return;
+    }
+
+    for (i = 0; i < DRM_BUF_COUNT; i++) {
+        if (drm_dev.bufs[i].map == px_map) {
+            buf = &drm_dev.bufs[i];
+        }
+    }
+
+    if (buf == NULL || commit_frame(buf) == -1) {
+        lv_display_flush_ready(disp);
+    }
+}
+
+/**
+ * Wait for the page flip of the last flushed frame
+ *
+ * @note called by LVGL
+ */
+static void flush_wait_cb(lv_display_t *disp)
+{
+    LV_UNUSED(disp);
+
+    wait_page_flip();
+}
+
+/**
+ * Wait until the buffer about to be rendered into isn't scanned out
+ *
+ * @description LVGL swaps the buffers once the last area is flushed,
+ * the new one is displayed until the page flip completes
+ * @note called by LVGL before rendering a frame
+ */
+static void render_start_cb(lv_event_t *e)
+{
+    LV_UNUSED(e);
+
+    wait_page_flip();
+}
+
+/**
+ * Pace the rendering with the vblank events of the CRTC
+ *
+ * @description the page flip events of the display are waited for on its
+ * own file descriptor, so the vblank events are requested on a second one.
+ * A vblank event is only requested when the display has been invalidated,
+ * exactly one frame is rendered per vblank, nothing is rendered otherwise
+ *
+ * @param disp the LVGL display
+ * @param device the path of the DRM card
+ * @return 0 on success, -1 on error
+ */
+static int init_vblank(lv_display_t *disp, const char *device)
+{
+    int crtc_idx;
+
+    vblank.fd = open(device, O_RDWR | O_CLOEXEC);
+
+    if (vblank.fd == -1) {
+        LV_LOG_ERROR("Failed to open %s: %s", device, strerror(errno));
+        return -1;
+    }
+
+    crtc_idx = find_crtc_index(vblank.fd, NULL);
+
+    if (crtc_idx == -1) {
+        goto err;
+    }
+
+    vblank.disp = disp;
+    vblank.pipe = crtc_idx;
+    vblank.pending = false;
+    vblank.dirty = true;
+
+    /* Check that vblank events are supported, it also schedules the first frame */
+    if (request_vblank() == -1) {
+        goto err;
+    }
+
+    if (driver_backends_watch_fd(vblank.fd, EPOLLIN, drm_fd_ready_cb, NULL) == -1) {
+        goto err;
+    }
+
+    /* The refresh timer is kept as lv_refr_now() needs it, but it never expires */
+    lv_timer_set_period(lv_display_get_refr_timer(disp), DRM_VBLANK_REFR_PERIOD);
+    display_backend->refr_paced = true;
+    lv_display_add_event_cb(disp, invalidate_area_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+
+    LV_LOG_INFO("Rendering paced by vblank events of CRTC %d", crtc_idx);
+    return 0;
+
+err:
+    close(vblank.fd);
+    vblank.fd = -1;
+    return -1;
+}
+
+/**
+ * Find the CRTC index of the first connected connector
+ *
+ * @description the connector driven by the display
+ * @param fd the file descriptor of the DRM card
+ * @param crtc_id set to the id of the CRTC, can be NULL
+ * @return the index of the CRTC, -1 on error
+ */
+static int find_crtc_index(int fd, uint32_t *crtc_id)
+{
+    int i;
+    int crtc_idx = -1;
+    drmModeRes *res;
+    drmModeConnector *conn = NULL;
+    drmModeEncoder *enc = NULL;
+
+    res = drmModeGetResources(fd);
+
+    if (res == NULL) {
+        LV_LOG_ERROR("drmModeGetResources failed: %s", strerror(errno));
+        return -1;
+    }
+
+    for (i = 0; i < res->count_connectors; i++) {
+
+        conn = drmModeGetConnector(fd, res->connectors[i]);
+
+        if (conn != NULL && conn->connection == DRM_MODE_CONNECTED) {
+            break;
+        }
+
+        drmModeFreeConnector(conn);
+        conn = NULL;
+    }
+
+    if (conn != NULL && conn->encoder_id != 0) {
+        enc = drmModeGetEncoder(fd, conn->encoder_id);
+    }
+
+    if (enc != NULL) {
+        for (i = 0; i < res->count_crtcs; i++) {
+            if (res->crtcs[i] == enc->crtc_id) {
+                crtc_idx = i;
+                if (crtc_id != NULL) {
+                    *crtc_id = enc->crtc_id;
+                }
+                break;
+            }
+        }
+        drmModeFreeEncoder(enc);
+    }
+
+    if (crtc_idx == -1) {
+        LV_LOG_ERROR("Unable to find the CRTC of the connected display");
+    }
+
+    drmModeFreeConnector(conn);
+    drmModeFreeResources(res);
+
+    return crtc_idx;
+}
+
+/**
+ * Display the cached first frame
+ *
+ * @description the frame is copied to a dumb buffer of the display mode
+ * scanned out with a legacy mode set, before LVGL is set up. The first
+ * atomic commit of the display replaces it with the same mode, the
+ * buffer is released once its page flip has completed
+ *
+ * @return 0 on success, -1 on error
+ */
+static int show_splash(void)
+{
+    if (create_buffer(&splash_buf) == -1) {
+        return -1;
+    }
+
+    /* The display renders in XRGB8888 */
+    if (splash_show(splash_buf.map, drm_dev.mode.hdisplay, drm_dev.mode.vdisplay,
+                    splash_buf.pitch, LV_COLOR_FORMAT_XRGB8888) == -1) {
+        return -1;
+    }
+
+    if (drmModeSetCrtc(drm_dev.fd, drm_dev.crtc_id, splash_buf.fb_id, 0, 0,
+                       &drm_dev.conn_id, 1, &drm_dev.mode) != 0) {
+        LV_LOG_ERROR("Failed to display the splash: %s", strerror(errno));
+        return -1;
+    }
+
+    return 0;
+}
 
 /**
- * The run loop of the DRM driver
+ * Find the first connected connector and its preferred mode
+ *
+ * @description the mode of the display
+ * @param fd the file descriptor of the DRM card
+ * @param conn_id set to the id of the connector
+ * @param mode set to the preferred mode, the first one if none is preferred
+ * @return 0 on success, -1 on error
  */
-static void run_loop_drm(void)
+static int find_connector(int fd, uint32_t *conn_id, drmModeModeInfo *mode)
 {
-    uint32_t idle_time;
+    int i;
+    int ret = -1;
+    drmModeRes *res;
+    drmModeConnector *conn = NULL;
+
+    res = drmModeGetResources(fd);
+
+    if (res == NULL) {
+        LV_LOG_ERROR("drmModeGetResources failed: %s", strerror(errno));
+        return -1;
+    }
+
+    for (i = 0; i < res->count_connectors; i++) {
+
+        conn = drmModeGetConnector(fd, res->connectors[i]);
+
+        if (conn != NULL && conn->connection == DRM_MODE_CONNECTED && conn->count_modes > 0) {
+            break;
+        }
+
+        drmModeFreeConnector(conn);
+        conn = NULL;
+    }
+
+    if (conn != NULL) {
+        *conn_id = conn->connector_id;
+        *mode = conn->modes[0];
+
+        for (i = 0; i < conn->count_modes; i++) {
+            if (conn->modes[i].type & DRM_MODE_TYPE_PREFERRED) {
+                *mode = conn->modes[i];
+                break;
+            }
+        }
+
+        ret = 0;
+    }
+
+    drmModeFreeConnector(conn);
+    drmModeFreeResources(res);
+
+    return ret;
+}
+
+/**
+ * Release the framebuffer of the cached first frame
+ *
+ * @description can be called when it was partially set up or released
+ */
+static void release_splash(void)
+{
+    destroy_buffer(&splash_buf);
+}
+
+/**
+ * Request an event for the next vblank
+ *
+ * @return 0 on success, -1 on error
+ */
+static int request_vblank(void)
+{
+    drmVBlank vbl;
+
+    if (vblank.pending) {
+        return 0;
+    }
+
+    memset(&vbl, 0, sizeof(vbl));
+    vbl.request.type = DRM_VBLANK_RELATIVE | DRM_VBLANK_EVENT;
+
+    if (vblank.pipe == 1) {
+        vbl.request.type |= DRM_VBLANK_SECONDARY;
+    } else if (vblank.pipe > 1) {
+        vbl.request.type |= (vblank.pipe << DRM_VBLANK_HIGH_CRTC_SHIFT) &
+                            DRM_VBLANK_HIGH_CRTC_MASK;
+    }
+
+    vbl.request.sequence = 1;
+    vbl.request.signal = (unsigned long)&vblank;
+
+    if (drmWaitVBlank(vblank.fd, &vbl) != 0) {
+        LV_LOG_ERROR("drmWaitVBlank failed: %s", strerror(errno));
+        return -1;
+    }
+
+    vblank.pending = true;
+    return 0;
+}
+
+/**
+ * Render a frame if the display is dirty
+ *
+ * @note called by drmHandleEvent
+ */
+static void vblank_handler(int fd, unsigned int sequence,
+        unsigned int tv_sec, unsigned int tv_usec, void *user_data)
+{
+    drm_vblank_t *vb = user_data;
+
+    LV_UNUSED(fd);
+    LV_UNUSED(sequence);
+    LV_UNUSED(tv_sec);
+    LV_UNUSED(tv_usec);
+
+    vb->pending = false;
+
+    if (vb->dirty) {
+        vb->dirty = false;
+        lv_refr_now(vb->disp);
+    }
+}
+
+/**
+ * Dispatch the vblank and the page flip events
+ *
+ * @note called by the run loop
+ */
+static void drm_fd_ready_cb(int fd, uint32_t events, void *user_data)
+{
+    drmEventContext evctx;
+
+    LV_UNUSED(events);
+    LV_UNUSED(user_data);
+
+    memset(&evctx, 0, sizeof(evctx));
+    evctx.version = 2;
+    evctx.vblank_handler = vblank_handler;
+    evctx.page_flip_handler = page_flip_handler;
+
+    drmHandleEvent(fd, &evctx);
+}
+
+/**
+ * Schedule a frame on the next vblank
+ *
+ * @note called by LVGL when an area of the display is invalidated
+ */
+static void invalidate_area_cb(lv_event_t *e)
+{
+    LV_UNUSED(e);
+
+    vblank.dirty = true;
+    request_vblank();
+}
+
+/**
+ * Display the cursor of a pointer device on a hardware plane
+ *
+ * @description the cursor image is uploaded once to a plane of the CRTC,
+ * a cursor plane if the driver has one, otherwise a free overlay plane.
+ * Moving the pointer only updates the position of the plane, the primary
+ * plane is neither re-rendered nor flipped. While the display refreshes
+ * the position is committed with the page flips of the display,
+ * otherwise with a blocking commit of its own: a pending commit never
+ * makes a page flip fail with EBUSY. The position is read by wrapping
+ * the read callback of the pointer device
+ *
+ * @param indev the pointer device
+ * @param icon the cursor image
+ * @return 0 on success, -1 if no plane can display the cursor
+ */
+static int init_cursor_plane(lv_indev_t *indev, const lv_image_dsc_t *icon)
+{
+    int crtc_idx;
+    lv_point_t pos = { 0, 0 };
+
+    if (cursor.indev != NULL || drm_dev.fd == -1 ||
+        !atoi(getenv_default("LV_LINUX_DRM_CURSOR_PLANE", "1"))) {
+        return -1;
+    }
+
+    if (icon->header.cf != LV_COLOR_FORMAT_ARGB8888) {
+        LV_LOG_WARN("Cursor plane requires an ARGB8888 cursor image");
+        return -1;
+    }
+
+    cursor.fd = drm_dev.fd;
+    crtc_idx = find_crtc_index(cursor.fd, &cursor.crtc_id);
+
+    if (crtc_idx == -1 || find_cursor_plane(cursor.fd, crtc_idx) == -1) {
+        return -1;
+    }
+
+    if (create_cursor_buffer(icon) == -1) {
+        return -1;
+    }
 
-    /* Handle LVGL tasks */
-    while (true) {
-        /* Returns the time to the next timer execution */
-        idle_time = lv_timer_handler();
-        usleep(idle_time * 1000);
+    /* Check that the driver accepts the configuration of the plane */
+    if (commit_cursor(&pos, DRM_MODE_ATOMIC_TEST_ONLY) == -1 ||
+        commit_cursor(&pos, 0) == -1) {
+        destroy_cursor_buffer();
+        return -1;
     }
+
+    cursor.indev = indev;
+    cursor.pending = false;
+
+    /* Follow the pointer every time the input device is read */
+    cursor.read_cb = lv_indev_get_read_cb(indev);
+    lv_indev_set_read_cb(indev, cursor_read_cb);
+    lv_indev_add_event_cb(indev, cursor_indev_deleted_cb, LV_EVENT_DELETE, NULL);
+
+    LV_LOG_INFO("Cursor displayed on plane %u", cursor.plane_id);
+    return 0;
+}
+
+/**
+ * Find a plane able to display the cursor on a CRTC
+ *
+ * @description prefers a cursor plane, falls back on an unused
+ * overlay plane supporting ARGB8888. Looks up the ids of the
+ * properties of the plane
+ *
+ * @param fd the file descriptor of the DRM card
+ * @param crtc_idx the index of the CRTC
+ * @return 0 on success, -1 if no plane is available
+ */
+static int find_cursor_plane(int fd, int crtc_idx)
+{
+    uint32_t i;
+    uint32_t j;
+    uint64_t type;
+    uint32_t overlay_id = 0;
+    drmModePlaneRes *planes;
+    drmModePlane *plane;
+
+    cursor.plane_id = 0;
+    planes = drmModeGetPlaneResources(fd);
+
+    if (planes == NULL) {
+        LV_LOG_ERROR("drmModeGetPlaneResources failed: %s", strerror(errno));
+        return -1;
+    }
+
+    for (i = 0; i < planes->count_planes && cursor.plane_id == 0; i++) {
+
+        plane = drmModeGetPlane(fd, planes->planes[i]);
+
+        if (plane == NULL) {
+            continue;
+        }
+
+        if (!(plane->possible_crtcs & (1 << crtc_idx))) {
+            drmModeFreePlane(plane);
+            continue;
+        }
+
+        type = get_plane_type(fd, plane->plane_id);
+
+        if (type == DRM_PLANE_TYPE_CURSOR) {
+            cursor.plane_id = plane->plane_id;
+        } else if (type == DRM_PLANE_TYPE_OVERLAY && overlay_id == 0 &&
+                   plane->fb_id == 0) {
+            for (j = 0; j < plane->count_formats; j++) {
+                if (plane->formats[j] == DRM_FORMAT_ARGB8888) {
+                    overlay_id = plane->plane_id;
+                    break;
+                }
+            }
+        }
+
+        drmModeFreePlane(plane);
+    }
+
+    drmModeFreePlaneResources(planes);
+
+    if (cursor.plane_id == 0) {
+        cursor.plane_id = overlay_id;
+    }
+
+    if (cursor.plane_id == 0) {
+        LV_LOG_WARN("No cursor or overlay plane available");
+        return -1;
+    }
+
+    return get_plane_props(fd, cursor.plane_id, cursor.props);
+}
+
+/**
+ * Create the framebuffer holding the cursor image
+ *
+ * @description cursor planes usually only accept the size reported by
+ * the driver, the image is copied to the top left corner of a buffer of
+ * that size with premultiplied alpha, which is the default blending of planes
+ *
+ * @param icon the ARGB8888 cursor image
+ * @return 0 on success, -1 on error
+ */
+static int create_cursor_buffer(const lv_image_dsc_t *icon)
+{
+    uint64_t cap;
+    uint32_t x;
+    uint32_t y;
+    uint8_t *fb;
+    uint8_t *dst;
+    const uint8_t *src;
+    uint32_t handles[4] = { 0 };
+    uint32_t pitches[4] = { 0 };
+    uint32_t offsets[4] = { 0 };
+    struct drm_mode_create_dumb creq;
+    struct drm_mode_map_dumb mreq;
+
+    cursor.width = DRM_CURSOR_DEFAULT_SIZE;
+    cursor.height = DRM_CURSOR_DEFAULT_SIZE;
+
+    if (drmGetCap(cursor.fd, DRM_CAP_CURSOR_WIDTH, &cap) == 0) {
+        cursor.width = cap;
+    }
+
+    if (drmGetCap(cursor.fd, DRM_CAP_CURSOR_HEIGHT, &cap) == 0) {
+        cursor.height = cap;
+    }
+
+    if (icon->header.w > cursor.width || icon->header.h > cursor.height) {
+        LV_LOG_WARN("Cursor image larger than %ux%u", cursor.width, cursor.height);
+        return -1;
+    }
+
+    memset(&creq, 0, sizeof(creq));
+    creq.width = cursor.width;
+    creq.height = cursor.height;
+    creq.bpp = 32;
+
+    if (drmIoctl(cursor.fd, DRM_IOCTL_MODE_CREATE_DUMB, &creq) != 0) {
+        LV_LOG_ERROR("Failed to create cursor buffer: %s", strerror(errno));
+        return -1;
+    }
+
+    cursor.handle = creq.handle;
+
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.handle = creq.handle;
+
+    if (drmIoctl(cursor.fd, DRM_IOCTL_MODE_MAP_DUMB, &mreq) != 0) {
+        LV_LOG_ERROR("Failed to map cursor buffer: %s", strerror(errno));
+        goto err;
+    }
+
+    fb = mmap(NULL, creq.size, PROT_READ | PROT_WRITE, MAP_SHARED, cursor.fd, mreq.offset);
+
+    if (fb == MAP_FAILED) {
+        LV_LOG_ERROR("Failed to map cursor buffer: %s", strerror(errno));
+        goto err;
+    }
+
+    memset(fb, 0, creq.size);
+
+    /* LVGL and DRM ARGB8888 share the same memory layout: B, G, R, A */
+    for (y = 0; y < icon->header.h; y++) {
+        src = icon->data + y * icon->header.stride;
+        dst = fb + y * creq.pitch;
+
+        for (x = 0; x < icon->header.w; x++) {
+            dst[0] = src[0] * src[3] / 255;
+            dst[1] = src[1] * src[3] / 255;
+            dst[2] = src[2] * src[3] / 255;
+            dst[3] = src[3];
+            src += 4;
+            dst += 4;
+        }
+    }
+
+    munmap(fb, creq.size);
+
+    handles[0] = creq.handle;
+    pitches[0] = creq.pitch;
+
+    if (drmModeAddFB2(cursor.fd, cursor.width, cursor.height, DRM_FORMAT_ARGB8888,
+                      handles, pitches, offsets, &cursor.fb_id, 0) != 0) {
+        LV_LOG_ERROR("Failed to add cursor framebuffer: %s", strerror(errno));
+        goto err;
+    }
+
+    return 0;
+
+err:
+    destroy_cursor_buffer();
+    return -1;
+}
+
+/**
+ * Release the framebuffer holding the cursor image
+ */
+static void destroy_cursor_buffer(void)
+{
+    struct drm_mode_destroy_dumb dreq;
+
+    if (cursor.fb_id != 0) {
+        drmModeRmFB(cursor.fd, cursor.fb_id);
+        cursor.fb_id = 0;
+    }
+
+    if (cursor.handle != 0) {
+        memset(&dreq, 0, sizeof(dreq));
+        dreq.handle = cursor.handle;
+        drmIoctl(cursor.fd, DRM_IOCTL_MODE_DESTROY_DUMB, &dreq);
+        cursor.handle = 0;
+    }
+}
+
+/**
+ * Add the properties of the cursor plane to an atomic request
+ *
+ * @description the framebuffer is attached by the first commit,
+ * the following ones only update the position
+ *
+ * @param req the atomic request
+ * @param pos the position of the cursor on the display
+ */
+static void add_cursor_props(drmModeAtomicReqPtr req, const lv_point_t *pos)
+{
+    uint32_t *p = cursor.props;
+
+    if (!cursor.enabled) {
+        drmModeAtomicAddProperty(req, cursor.plane_id, p[PLANE_PROP_FB_ID], cursor.fb_id);
+        drmModeAtomicAddProperty(req, cursor.plane_id, p[PLANE_PROP_CRTC_ID], cursor.crtc_id);
+        drmModeAtomicAddProperty(req, cursor.plane_id, p[PLANE_PROP_CRTC_W], cursor.width);
+        drmModeAtomicAddProperty(req, cursor.plane_id, p[PLANE_PROP_CRTC_H], cursor.height);
+        drmModeAtomicAddProperty(req, cursor.plane_id, p[PLANE_PROP_SRC_X], 0);
+        drmModeAtomicAddProperty(req, cursor.plane_id, p[PLANE_PROP_SRC_Y], 0);
+        /* The source rectangle is in 16.16 fixed point */
+        drmModeAtomicAddProperty(req, cursor.plane_id, p[PLANE_PROP_SRC_W], cursor.width << 16);
+        drmModeAtomicAddProperty(req, cursor.plane_id, p[PLANE_PROP_SRC_H], cursor.height << 16);
+    }
+
+    drmModeAtomicAddProperty(req, cursor.plane_id, p[PLANE_PROP_CRTC_X], pos->x);
+    drmModeAtomicAddProperty(req, cursor.plane_id, p[PLANE_PROP_CRTC_Y], pos->y);
+}
+
+/**
+ * Move the cursor plane with a commit of its own
+ *
+ * @description blocking commits wait for a pending page flip instead of
+ * failing, and are complete when they return
+ *
+ * @param pos the position of the cursor on the display
+ * @param flags the flags of the commit i.e DRM_MODE_ATOMIC_TEST_ONLY
+ * @return 0 on success, -1 on error
+ */
+static int commit_cursor(const lv_point_t *pos, uint32_t flags)
+{
+    int ret;
+    drmModeAtomicReq *req = drmModeAtomicAlloc();
+
+    if (req == NULL) {
+        return -1;
+    }
+
+    add_cursor_props(req, pos);
+
+    ret = drmModeAtomicCommit(cursor.fd, req, flags, NULL);
+    drmModeAtomicFree(req);
+
+    if (ret != 0) {
+        LV_LOG_WARN("Cursor plane commit failed: %s", strerror(errno));
+        return -1;
+    }
+
+    if (!(flags & DRM_MODE_ATOMIC_TEST_ONLY)) {
+        cursor.enabled = true;
+        cursor.pos = *pos;
+    }
+
+    return 0;
+}
+
+/**
+ * Read the pointer device and move the cursor plane
+ *
+ * @description the position is folded into the next page flip if
+ * the display committed one since the previous read: it is
+ * refreshing. Otherwise the display is idle and the cursor is moved
+ * @note wraps the read callback of the indev
+ */
+static void cursor_read_cb(lv_indev_t *indev, lv_indev_data_t *data)
+{
+    bool idle;
+
+    cursor.read_cb(indev, data);
+
+    if (data->point.x != cursor.pos.x || data->point.y != cursor.pos.y) {
+        cursor.next = data->point;
+        cursor.pending = true;
+    }
+
+    idle = cursor.flips == cursor.seen_flips;
+    cursor.seen_flips = cursor.flips;
+
+    if (cursor.pending && idle && commit_cursor(&cursor.next, 0) == 0) {
+        cursor.pending = false;
+    }
+}
+
+/**
+ * Disable the cursor plane
+ *
+ * @note called by LVGL when the pointer device is removed
+ */
+static void cursor_indev_deleted_cb(lv_event_t *e)
+{
+    drmModeAtomicReq *req;
+
+    LV_UNUSED(e);
+
+    req = drmModeAtomicAlloc();
+
+    if (req != NULL) {
+        drmModeAtomicAddProperty(req, cursor.plane_id, cursor.props[PLANE_PROP_FB_ID], 0);
+        drmModeAtomicAddProperty(req, cursor.plane_id, cursor.props[PLANE_PROP_CRTC_ID], 0);
+        drmModeAtomicCommit(cursor.fd, req, 0, NULL);
+        drmModeAtomicFree(req);
+    }
+
+    destroy_cursor_buffer();
+    cursor.enabled = false;
+    cursor.pending = false;
+    cursor.indev = NULL;
 }
 
 #endif /*#if LV_USE_LINUX_DRM*/
@@ -18,10 +18,19 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/fb.h>
 
 #include "lvgl/lvgl.h"
 #if LV_USE_LINUX_FBDEV
 #include "../simulator_util.h"
+#include "../simulator_settings.h"
+#include "../display_buffers.h"
+#include "../splash.h"
 #include "../backends.h"
 
 /*********************
@@ -32,12 +41,44 @@
  *      TYPEDEFS
  **********************/
 
+/* The state of the framebuffer when it is not driven by lv_linux_fbdev
+ * In DIRECT mode the virtual resolution of the framebuffer is twice the
+ * visible one, LVGL renders directly into the hidden page which is then
+ * displayed by panning. Otherwise the rendered areas are copied to the
+ * visible page */
+typedef struct {
+    int fd;
+    uint8_t *fb;                      /* The mapping of the pages */
+    size_t fb_size;
+    bool double_buffered;             /* Two pages are flipped by panning */
+    bool wait_vsync;                  /* FBIO_WAITFORVSYNC is supported */
+    struct fb_var_screeninfo vinfo;
+    struct fb_fix_screeninfo finfo;
+    struct fb_var_screeninfo orig_vinfo;  /* Restored at exit */
+    bool vinfo_changed;               /* The virtual resolution was changed */
+} fbdev_t;
+
+/**********************
+ *  EXTERNAL VARIABLES
+ **********************/
+extern simulator_settings_t settings;
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 
 static lv_display_t *init_fbdev(void);
-static void run_loop_fbdev(void);
+static lv_display_t *init_fbdev_direct(const char *device);
+static lv_display_t *init_fbdev_copy(const char *device);
+static int open_fbdev(const char *device);
+static void close_fbdev(void);
+static void restore_vinfo(void);
+static void show_splash(const char *device);
+static lv_color_format_t get_color_format(void);
+static lv_display_t *create_display(lv_color_format_t cf);
+static void flush_direct_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map);
+static void flush_copy_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map);
+static uint32_t tick_get_cb(void);
 
 /**********************
  *  STATIC VARIABLES
@@ -45,6 +86,8 @@ static void run_loop_fbdev(void);
 
 static char *backend_name = "FBDEV";
 
+static fbdev_t fbdev = { .fd = -1 };
+
 /**********************
  *      MACROS
  **********************/
@@ -67,7 +110,10 @@ int backend_init_fbdev(backend_t *backend)
     LV_ASSERT_NULL(backend->handle->display);
 
     backend->handle->display->init_display = init_fbdev;
-    backend->handle->display->run_loop = run_loop_fbdev;
+    backend->handle->display->run_loop = NULL;
+    backend->handle->display->timer_handler = NULL;
+    backend->handle->display->init_cursor = NULL;
+    backend->handle->display->main_thread = false;
     backend->name = backend_name;
     backend->type = BACKEND_DISPLAY;
 
@@ -81,12 +127,37 @@ int backend_init_fbdev(backend_t *backend)
 /**
  * Initialize the fbdev driver
  *
+ * @description the LVGL fbdev driver is used unless DIRECT mode is
+ * requested or the draw buffers are configured by the settings, as its
+ * buffers are selected at compile time
  * @return the LVGL display
  */
 static lv_display_t *init_fbdev(void)
 {
     const char *device = getenv_default("LV_LINUX_FBDEV_DEVICE", "/dev/fb0");
-    lv_display_t *disp = lv_linux_fbdev_create();
+    lv_display_t *disp;
+
+    if (splash_available()) {
+        show_splash(device);
+    }
+
+    if (atoi(getenv_default("LV_LINUX_FBDEV_DIRECT", "0")) ||
+        settings.render_mode == LV_DISPLAY_RENDER_MODE_DIRECT) {
+
+        disp = init_fbdev_direct(device);
+
+        if (disp != NULL) {
+            return disp;
+        }
+
+        LV_LOG_WARN("Panning is not supported by %s - falling back to copying", device);
+    }
+
+    if (display_buffers_configured()) {
+        return init_fbdev_copy(device);
+    }
+
+    disp = lv_linux_fbdev_create();
 
     if (disp == NULL) {
         return NULL;
@@ -98,19 +169,379 @@ static lv_display_t *init_fbdev(void)
 }
 
 /**
- * The run loop of the fbdev driver
+ * Initialize the fbdev driver in DIRECT mode
+ *
+ * @description doubles the virtual height of the framebuffer, LVGL renders
+ * directly into the hidden half which is shown with FBIOPAN_DISPLAY once the
+ * frame is complete, there is no intermediate buffer to copy.
+ * With a single buffer LVGL renders into the visible page
+ * @param device the path of the framebuffer device
+ * @return the LVGL display, NULL if the driver doesn't support panning
  */
-static void run_loop_fbdev(void)
+static lv_display_t *init_fbdev_direct(const char *device)
 {
-    uint32_t idle_time;
+    lv_display_t *disp;
+    lv_color_format_t cf;
+    uint32_t page_size;
+    int zero = 0;
+
+    if (open_fbdev(device) == -1) {
+        return NULL;
+    }
+
+    fbdev.double_buffered = settings.buffer_count != 1;
+
+    if (fbdev.double_buffered) {
+        if (!fbdev.vinfo_changed) {
+            fbdev.vinfo_changed = true;
+            atexit(restore_vinfo);
+        }
+
+        fbdev.vinfo.xoffset = 0;
+        fbdev.vinfo.yoffset = 0;
+        fbdev.vinfo.yres_virtual = fbdev.vinfo.yres * 2;
 
-    /* Handle LVGL tasks */
-    while (true) {
+        /* The driver may adjust the values, read them back */
+        if (ioctl(fbdev.fd, FBIOPUT_VSCREENINFO, &fbdev.vinfo) == -1 ||
+            ioctl(fbdev.fd, FBIOGET_VSCREENINFO, &fbdev.vinfo) == -1 ||
+            ioctl(fbdev.fd, FBIOGET_FSCREENINFO, &fbdev.finfo) == -1) {
+            LV_LOG_WARN("Unable to set the virtual resolution: %s", strerror(errno));
+            goto err;
+        }
 
-        /* Returns the time to the next timer execution */
-        idle_time = lv_timer_handler();
-        usleep(idle_time * 1000);
+        if (fbdev.vinfo.yres_virtual < fbdev.vinfo.yres * 2 || fbdev.finfo.ypanstep == 0) {
+            goto err;
+        }
+
+        /* Check that panning actually works */
+        if (ioctl(fbdev.fd, FBIOPAN_DISPLAY, &fbdev.vinfo) == -1) {
+            goto err;
+        }
+    }
+
+    cf = get_color_format();
+
+    if (cf == LV_COLOR_FORMAT_UNKNOWN) {
+        goto err;
     }
+
+    fbdev.wait_vsync = ioctl(fbdev.fd, FBIO_WAITFORVSYNC, &zero) == 0;
+
+    if (!fbdev.wait_vsync) {
+        LV_LOG_WARN("FBIO_WAITFORVSYNC is not supported - tearing may occur");
+    }
+
+    page_size = fbdev.finfo.line_length * fbdev.vinfo.yres;
+    fbdev.fb_size = fbdev.double_buffered ? page_size * 2 : page_size;
+
+    if (fbdev.finfo.smem_len < fbdev.fb_size) {
+        LV_LOG_WARN("The framebuffer memory is too small: %u bytes", fbdev.finfo.smem_len);
+        goto err;
+    }
+
+    disp = create_display(cf);
+
+    if (disp == NULL) {
+        goto err;
+    }
+
+    lv_display_set_buffers_with_stride(disp, fbdev.fb,
+            fbdev.double_buffered ? fbdev.fb + page_size : NULL, page_size,
+            fbdev.finfo.line_length, LV_DISPLAY_RENDER_MODE_DIRECT);
+    lv_display_set_flush_cb(disp, flush_direct_cb);
+
+    LV_LOG_INFO("Rendering directly into %s (%dx%d)", device,
+            fbdev.vinfo.xres, fbdev.vinfo.yres);
+
+    return disp;
+
+err:
+    close_fbdev();
+    return NULL;
+}
+
+/**
+ * Initialize the fbdev driver with draw buffers configured by the settings
+ *
+ * @description the areas rendered into the draw buffers are copied
+ * to the visible page of the framebuffer
+ * @param device the path of the framebuffer device
+ * @return the LVGL display, NULL on error
+ */
+static lv_display_t *init_fbdev_copy(const char *device)
+{
+    lv_display_t *disp;
+    lv_color_format_t cf;
+
+    if (open_fbdev(device) == -1) {
+        return NULL;
+    }
+
+    fbdev.double_buffered = false;
+    fbdev.wait_vsync = false;
+    fbdev.fb_size = fbdev.finfo.smem_len;
+    cf = get_color_format();
+
+    if (cf == LV_COLOR_FORMAT_UNKNOWN) {
+        close_fbdev();
+        return NULL;
+    }
+
+    disp = create_display(cf);
+
+    if (disp == NULL) {
+        close_fbdev();
+        return NULL;
+    }
+
+    if (display_buffers_setup(disp, LV_DISPLAY_RENDER_MODE_PARTIAL) == -1) {
+        lv_display_delete(disp);
+        close_fbdev();
+        return NULL;
+    }
+
+    lv_display_set_flush_cb(disp, flush_copy_cb);
+
+    return disp;
+}
+
+/**
+ * Open the framebuffer device and get the screen info
+ *
+ * @description the framebuffer is mapped by create_display
+ * @param device the path of the framebuffer device
+ * @return 0 on success, -1 on error
+ */
+static int open_fbdev(const char *device)
+{
+    fbdev.fd = open(device, O_RDWR | O_CLOEXEC);
+
+    if (fbdev.fd == -1) {
+        LV_LOG_ERROR("Failed to open %s: %s", device, strerror(errno));
+        return -1;
+    }
+
+    if (ioctl(fbdev.fd, FBIOGET_VSCREENINFO, &fbdev.vinfo) == -1 ||
+        ioctl(fbdev.fd, FBIOGET_FSCREENINFO, &fbdev.finfo) == -1) {
+        LV_LOG_ERROR("Failed to get the screen info: %s", strerror(errno));
+        close_fbdev();
+        return -1;
+    }
+
+    fbdev.orig_vinfo = fbdev.vinfo;
+
+    return 0;
+}
+
+/**
+ * Close the framebuffer device
+ *
+ * @description the original screen info is restored first
+ */
+static void close_fbdev(void)
+{
+    restore_vinfo();
+    close(fbdev.fd);
+    fbdev.fd = -1;
+}
+
+/**
+ * Restore the virtual resolution and the panning of the framebuffer
+ *
+ * @description the console or the next program would otherwise be shown
+ * on a page they don't draw into
+ * @note called at exit
+ */
+static void restore_vinfo(void)
+{
+    if (fbdev.fd == -1 || !fbdev.vinfo_changed) {
+        return;
+    }
+
+    if (ioctl(fbdev.fd, FBIOPUT_VSCREENINFO, &fbdev.orig_vinfo) == -1) {
+        LV_LOG_WARN("Unable to restore the screen info: %s", strerror(errno));
+    }
+
+    fbdev.vinfo_changed = false;
+}
+
+/**
+ * Display the cached first frame
+ *
+ * @description the frame is copied to the visible page before LVGL is
+ * set up, it stays on screen until the first frame is flushed.
+ * The framebuffer is mapped again by the driver that is selected next
+ * @param device the path of the framebuffer device
+ */
+static void show_splash(const char *device)
+{
+    uint8_t *fb;
+    lv_color_format_t cf;
+
+    if (open_fbdev(device) == -1) {
+        return;
+    }
+
+    cf = get_color_format();
+    fb = mmap(NULL, fbdev.finfo.smem_len, PROT_READ | PROT_WRITE, MAP_SHARED, fbdev.fd, 0);
+
+    if (cf != LV_COLOR_FORMAT_UNKNOWN && fb != MAP_FAILED) {
+        splash_show(fb + fbdev.vinfo.yoffset * fbdev.finfo.line_length +
+                    fbdev.vinfo.xoffset * (fbdev.vinfo.bits_per_pixel / 8),
+                    fbdev.vinfo.xres, fbdev.vinfo.yres, fbdev.finfo.line_length, cf);
+    }
+
+    if (fb != MAP_FAILED) {
+        munmap(fb, fbdev.finfo.smem_len);
+    }
+
+    close_fbdev();
+}
+
+/**
+ * Get the color format matching the depth of the framebuffer
+ *
+ * @description the color format of the settings can't be
+ * applied, the framebuffer is not converted
+ * @return the color format, LV_COLOR_FORMAT_UNKNOWN if not supported
+ */
+static lv_color_format_t get_color_format(void)
+{
+    lv_color_format_t cf;
+
+    switch (fbdev.vinfo.bits_per_pixel) {
+    case 16:
+        cf = LV_COLOR_FORMAT_RGB565;
+        break;
+    case 24:
+        cf = LV_COLOR_FORMAT_RGB888;
+        break;
+    case 32:
+        cf = LV_COLOR_FORMAT_XRGB8888;
+        break;
+    default:
+        LV_LOG_WARN("Unsupported color depth: %d", fbdev.vinfo.bits_per_pixel);
+        return LV_COLOR_FORMAT_UNKNOWN;
+    }
+
+    if (settings.color_format != LV_COLOR_FORMAT_UNKNOWN && settings.color_format != cf) {
+        LV_LOG_WARN("The color format is set by the depth of the framebuffer: %d bpp",
+                    fbdev.vinfo.bits_per_pixel);
+    }
+
+    return cf;
+}
+
+/**
+ * Map the framebuffer and create the display
+ *
+ * @param cf the color format of the framebuffer
+ * @return the LVGL display, NULL on error
+ */
+static lv_display_t *create_display(lv_color_format_t cf)
+{
+    lv_display_t *disp;
+
+    fbdev.fb = mmap(NULL, fbdev.fb_size, PROT_READ | PROT_WRITE, MAP_SHARED, fbdev.fd, 0);
+
+    if (fbdev.fb == MAP_FAILED) {
+        LV_LOG_ERROR("Failed to map the framebuffer: %s", strerror(errno));
+        return NULL;
+    }
+
+    lv_tick_set_cb(tick_get_cb);
+
+    disp = lv_display_create(fbdev.vinfo.xres, fbdev.vinfo.yres);
+
+    if (disp == NULL) {
+        munmap(fbdev.fb, fbdev.fb_size);
+        return NULL;
+    }
+
+    lv_display_set_color_format(disp, cf);
+
+    return disp;
+}
+
+/**
+ * Display the rendered page
+ *
+ * @description once the last area of the frame is rendered, pan to the
+ * page containing it and wait for the vertical sync, LVGL then renders the
+ * next frame into the page that is not displayed anymore
+ * @note called by LVGL
+ */
+static void flush_direct_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    int zero = 0;
+    lv_draw_buf_t *buf;
+
+    LV_UNUSED(area);
+    LV_UNUSED(px_map);
+
+    if (lv_display_flush_is_last(disp)) {
+
+        if (fbdev.double_buffered) {
+            buf = lv_display_get_buf_active(disp);
+            fbdev.vinfo.yoffset = buf->data == fbdev.fb ? 0 : fbdev.vinfo.yres;
+
+            if (ioctl(fbdev.fd, FBIOPAN_DISPLAY, &fbdev.vinfo) == -1) {
+                LV_LOG_ERROR("FBIOPAN_DISPLAY failed: %s", strerror(errno));
+            }
+        }
+
+        if (fbdev.wait_vsync) {
+            ioctl(fbdev.fd, FBIO_WAITFORVSYNC, &zero);
+        }
+    }
+
+    lv_display_flush_ready(disp);
+}
+
+/**
+ * Copy a rendered area to the framebuffer
+ *
+ * @description in DIRECT mode px_map is the whole draw buffer,
+ * otherwise it only contains the area
+ * @note called by LVGL
+ */
+static void flush_copy_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    int32_t y;
+    uint32_t src_stride;
+    uint32_t px_size = fbdev.vinfo.bits_per_pixel / 8;
+    uint32_t len = lv_area_get_width(area) * px_size;
+    uint8_t *dst;
+
+    if (lv_display_get_render_mode(disp) == LV_DISPLAY_RENDER_MODE_DIRECT) {
+        src_stride = lv_display_get_buf_active(disp)->header.stride;
+        px_map += area->y1 * src_stride + area->x1 * px_size;
+    } else {
+        src_stride = lv_draw_buf_width_to_stride(lv_area_get_width(area),
+                                                 lv_display_get_color_format(disp));
+    }
+
+    dst = fbdev.fb + (area->y1 + fbdev.vinfo.yoffset) * fbdev.finfo.line_length +
+          (area->x1 + fbdev.vinfo.xoffset) * px_size;
+
+    for (y = area->y1; y <= area->y2; y++) {
+        memcpy(dst, px_map, len);
+        dst += fbdev.finfo.line_length;
+        px_map += src_stride;
+    }
+
+    lv_display_flush_ready(disp);
+}
+
+/**
+ * Get the current time
+ *
+ * @note lv_linux_fbdev_create is not used in DIRECT mode
+ * @return the time in ms of the monotonic clock
+ */
+static uint32_t tick_get_cb(void)
+{
+    return (uint32_t)(get_time_us() / 1000);
 }
 
 #endif /*LV_USE_LINUX_FBDEV*/
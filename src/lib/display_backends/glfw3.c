@@ -16,35 +16,61 @@
  *      INCLUDES
  *********************/
 
-#include <unistd.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "lvgl/lvgl.h"
 #if LV_USE_OPENGLES
+#include <GL/glew.h>
+
 #include "../simulator_util.h"
 #include "../simulator_settings.h"
+#include "../display_buffers.h"
 #include "../backends.h"
 
 /*********************
  *      DEFINES
  *********************/
 
+/* Maximum number of areas uploaded separately per frame, the next ones are joined */
+#define GLFW_PBO_MAX_AREAS 16
+
 /**********************
  *      TYPEDEFS
  **********************/
 
+/* The state of the PBO upload path
+ * The areas rendered by the software renderer are packed into a pixel
+ * buffer object and copied into the texture by the GPU, the storage of
+ * the buffer is orphaned at each upload so the upload doesn't block and
+ * overlaps with the rendering of the next frame */
+typedef struct {
+    GLuint texture;
+    GLuint buffer;
+    GLenum internal_format;
+    GLenum format;
+    GLenum type;
+    int32_t width;                        /* The size of the texture storage */
+    int32_t height;
+    lv_area_t areas[GLFW_PBO_MAX_AREAS];  /* The areas flushed in the current frame */
+    uint32_t area_count;
+} glfw_pbo_t;
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
-static void run_loop_glfw3(void);
 static lv_display_t *init_glfw3(void);
+static int init_pbo(lv_display_t *disp);
+static void flush_pbo_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
 static char *backend_name = "GLFW";
 
+static glfw_pbo_t pbo;
+
 /**********************
  *  EXTERNAL VARIABLES
  **********************/
@@ -73,7 +99,10 @@ int backend_init_glfw3(backend_t *backend)
     LV_ASSERT_NULL(backend->handle->display);
 
     backend->handle->display->init_display = init_glfw3;
-    backend->handle->display->run_loop = run_loop_glfw3;
+    backend->handle->display->run_loop = NULL;
+    backend->handle->display->timer_handler = NULL;
+    backend->handle->display->init_cursor = NULL;
+    backend->handle->display->main_thread = true;
     backend->name = backend_name;
     backend->type = BACKEND_DISPLAY;
 
@@ -99,6 +128,8 @@ static lv_display_t *init_glfw3(void)
     uint32_t disp_texture_id;
     lv_obj_t *cursor_obj;
 
+    display_buffers_warn_unsupported(backend_name);
+
     /* create a window and initialize OpenGL */
     lv_glfw_window_t * window = lv_glfw_window_create(
             settings.window_width, settings.window_height, true);
@@ -122,23 +153,173 @@ static lv_display_t *init_glfw3(void)
     lv_image_set_src(cursor_obj, &mouse_cursor_icon);
     lv_indev_set_cursor(mouse, cursor_obj);
 
+    /* The OpenGL ES draw unit renders into the texture, nothing is uploaded */
+    if (!LV_USE_DRAW_OPENGLES &&
+        atoi(getenv_default("LV_LINUX_GLFW_PBO", "1")) &&
+        init_pbo(disp_texture) == -1) {
+        LV_LOG_WARN("Pixel buffer objects unavailable - uploading the whole texture");
+    }
+
     return disp_texture;
 }
 
 /**
- * The run loop of the GLFW3 driver
+ * Upload the invalidated areas through pixel buffer objects
+ *
+ * @description the flush callback of the texture display is replaced
+ * @param disp the texture display
+ * @return 0 on success, -1 on error
  */
-void run_loop_glfw3(void)
+static int init_pbo(lv_display_t *disp)
 {
-    uint32_t idle_time;
+    if (!GLEW_VERSION_3_0 && !(GLEW_ARB_pixel_buffer_object && GLEW_ARB_map_buffer_range)) {
+        return -1;
+    }
 
-    /* Handle LVGL tasks */
-    while (true) {
+    memset(&pbo, 0, sizeof(pbo));
 
-        /* Returns the time to the next timer execution */
-        idle_time = lv_timer_handler();
-        usleep(idle_time * 1000);
+    switch (lv_display_get_color_format(disp)) {
+    case LV_COLOR_FORMAT_RGB565:
+        pbo.internal_format = GL_RGB;
+        pbo.format = GL_RGB;
+        pbo.type = GL_UNSIGNED_SHORT_5_6_5;
+        break;
+    case LV_COLOR_FORMAT_RGB888:
+        pbo.internal_format = GL_RGB;
+        pbo.format = GL_BGR;
+        pbo.type = GL_UNSIGNED_BYTE;
+        break;
+    case LV_COLOR_FORMAT_XRGB8888:
+    case LV_COLOR_FORMAT_ARGB8888:
+        pbo.internal_format = GL_RGBA;
+        pbo.format = GL_BGRA;
+        pbo.type = GL_UNSIGNED_BYTE;
+        break;
+    default:
+        return -1;
     }
+
+    pbo.texture = lv_opengles_texture_get_texture_id(disp);
+    glGenBuffers(1, &pbo.buffer);
+
+    lv_display_set_flush_cb(disp, flush_pbo_cb);
+
+    LV_LOG_INFO("Uploading the texture through a pixel buffer object");
+    return 0;
+}
+
+/**
+ * Upload the areas of the frame into the texture
+ *
+ * @description the areas are packed into the pixel buffer object once
+ * the last one is rendered, the texture is then updated from the buffer
+ * object by the GPU. The whole texture is allocated again when the size of
+ * the display changes. The texture display renders in direct mode, the areas
+ * are copied from the active buffer
+ * @note called by LVGL
+ */
+static void flush_pbo_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    uint32_t i;
+    int32_t y;
+    int32_t w;
+    int32_t h;
+    lv_area_t *a;
+    uint8_t *dst;
+    size_t size;
+    size_t offset;
+    uint32_t row_size;
+    lv_draw_buf_t *buf = lv_display_get_buf_active(disp);
+    uint32_t px_size = lv_color_format_get_size(lv_display_get_color_format(disp));
+    int32_t hor_res = lv_display_get_horizontal_resolution(disp);
+    int32_t ver_res = lv_display_get_vertical_resolution(disp);
+    bool resized = pbo.width != hor_res || pbo.height != ver_res;
+
+    LV_UNUSED(px_map);
+
+    if (pbo.area_count < GLFW_PBO_MAX_AREAS) {
+        pbo.areas[pbo.area_count++] = *area;
+    } else {
+        a = &pbo.areas[GLFW_PBO_MAX_AREAS - 1];
+        lv_area_join(a, a, area);
+    }
+
+    if (!lv_display_flush_is_last(disp)) {
+        lv_display_flush_ready(disp);
+        return;
+    }
+
+    if (resized) {
+        /* Upload the whole frame into a new storage */
+        lv_area_set(&pbo.areas[0], 0, 0, hor_res - 1, ver_res - 1);
+        pbo.area_count = 1;
+    }
+
+    size = 0;
+
+    for (i = 0; i < pbo.area_count; i++) {
+        size += lv_area_get_size(&pbo.areas[i]) * px_size;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo.buffer);
+
+    /* Orphan the previous storage, the GPU may still be reading it */
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                           GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+    if (dst == NULL) {
+        LV_LOG_ERROR("Failed to map the pixel buffer object");
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        pbo.area_count = 0;
+        lv_display_flush_ready(disp);
+        return;
+    }
+
+    /* The rows of each area are packed one after the other */
+    offset = 0;
+
+    for (i = 0; i < pbo.area_count; i++) {
+        a = &pbo.areas[i];
+        row_size = lv_area_get_width(a) * px_size;
+
+        for (y = a->y1; y <= a->y2; y++) {
+            memcpy(dst + offset, buf->data + y * buf->header.stride + a->x1 * px_size, row_size);
+            offset += row_size;
+        }
+    }
+
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glBindTexture(GL_TEXTURE_2D, pbo.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    if (resized) {
+        glTexImage2D(GL_TEXTURE_2D, 0, pbo.internal_format, hor_res, ver_res, 0,
+                     pbo.format, pbo.type, NULL);
+        pbo.width = hor_res;
+        pbo.height = ver_res;
+    } else {
+        offset = 0;
+
+        for (i = 0; i < pbo.area_count; i++) {
+            a = &pbo.areas[i];
+            w = lv_area_get_width(a);
+            h = lv_area_get_height(a);
+
+            /* The offset into the bound buffer object replaces the pointer */
+            glTexSubImage2D(GL_TEXTURE_2D, 0, a->x1, a->y1, w, h,
+                            pbo.format, pbo.type, (const void *)offset);
+            offset += (size_t)w * h * px_size;
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    pbo.area_count = 0;
+    lv_display_flush_ready(disp);
 }
 
 #endif /*#if LV_USE_OPENGLES*/
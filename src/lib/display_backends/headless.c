@@ -0,0 +1,279 @@
+/**
+ * @file headless.c
+ *
+ * The headless backend
+ *
+ * Renders into an in-memory draw buffer without any display hardware,
+ * the frames can optionally be dumped to a directory.
+ * Useful to measure the rendering performance on build servers
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+
+#include "lvgl/lvgl.h"
+#include "../simulator_util.h"
+#include "../simulator_settings.h"
+#include "../driver_backends.h"
+#include "../display_buffers.h"
+#include "../backends.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  EXTERNAL VARIABLES
+ **********************/
+extern simulator_settings_t settings;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static lv_display_t *init_headless(void);
+static void run_loop_headless(void);
+static void flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map);
+static uint32_t tick_get_cb(void);
+static void dump_frame(lv_display_t *disp, const uint8_t *px_map);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static char *backend_name = "HEADLESS";
+
+static display_backend_t *display_backend;
+
+/* Milliseconds added to the virtual clock at each iteration, 0 to use the real clock */
+static uint32_t tick_step;
+static uint32_t virtual_time;
+
+/* The directory in which the frames are dumped, NULL to disable */
+static const char *dump_dir;
+static uint32_t frame_count;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Register the backend
+ *
+ * @param backend the backend descriptor
+ * @description configures the descriptor
+ */
+int backend_init_headless(backend_t *backend)
+{
+    LV_ASSERT_NULL(backend);
+
+    backend->handle->display = malloc(sizeof(display_backend_t));
+    LV_ASSERT_NULL(backend->handle->display);
+
+    backend->handle->display->init_display = init_headless;
+    backend->handle->display->run_loop = run_loop_headless;
+    backend->handle->display->timer_handler = NULL;
+    backend->handle->display->init_cursor = NULL;
+    backend->handle->display->main_thread = false;
+    display_backend = backend->handle->display;
+    backend->name = backend_name;
+    backend->type = BACKEND_DISPLAY;
+
+    return 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Initialize the headless display
+ *
+ * @description by default the frame is rendered in DIRECT mode into a
+ * single buffer the size of the display, so that the buffer always
+ * contains the complete frame
+ * @return the LVGL display
+ */
+static lv_display_t *init_headless(void)
+{
+    lv_display_t *disp;
+    lv_color_format_t cf = settings.color_format;
+    const char *cf_name = getenv("LV_SIM_HEADLESS_COLOR_FORMAT");
+
+    tick_step = atoi(getenv_default("LV_SIM_HEADLESS_TICK", "0"));
+    dump_dir = getenv("LV_SIM_HEADLESS_DUMP_DIR");
+
+    lv_tick_set_cb(tick_get_cb);
+
+    disp = lv_display_create(settings.window_width, settings.window_height);
+
+    if (disp == NULL) {
+        return NULL;
+    }
+
+    if (cf == LV_COLOR_FORMAT_UNKNOWN && cf_name != NULL) {
+        cf = display_buffers_parse_color_format(cf_name);
+
+        if (cf == LV_COLOR_FORMAT_UNKNOWN) {
+            die("Unsupported color format: %s\n", cf_name);
+        }
+    }
+
+    if (cf != LV_COLOR_FORMAT_UNKNOWN) {
+        lv_display_set_color_format(disp, cf);
+    }
+
+    if (display_buffers_setup(disp, LV_DISPLAY_RENDER_MODE_DIRECT) == -1) {
+        lv_display_delete(disp);
+        return NULL;
+    }
+
+    if (dump_dir != NULL &&
+        lv_display_get_render_mode(disp) == LV_DISPLAY_RENDER_MODE_PARTIAL) {
+        LV_LOG_WARN("The frames can't be dumped in PARTIAL mode");
+        dump_dir = NULL;
+    }
+
+    lv_display_set_flush_cb(disp, flush_cb);
+
+    if (tick_step == 0) {
+        /* No display to wait for - refresh as soon as something is invalidated */
+        lv_timer_set_period(lv_display_get_refr_timer(disp), 0);
+        display_backend->refr_period = 0;
+    }
+
+    return disp;
+}
+
+/**
+ * The run loop of the headless driver
+ *
+ * @description never sleeps, with the virtual clock each iteration
+ * advances the time by LV_SIM_HEADLESS_TICK milliseconds so that the same
+ * frames are rendered regardless of the speed of the machine
+ */
+static void run_loop_headless(void)
+{
+    /* Handle LVGL tasks */
+    while (true) {
+
+        lv_timer_handler();
+        virtual_time += tick_step;
+
+        /* Serve the watched file descriptors without blocking */
+        driver_backends_dispatch_events();
+    }
+}
+
+/**
+ * Complete the flush of a frame
+ *
+ * @note called by LVGL
+ */
+static void flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    LV_UNUSED(area);
+    LV_UNUSED(px_map);
+
+    if (lv_display_flush_is_last(disp)) {
+
+        if (dump_dir != NULL) {
+            dump_frame(disp, lv_display_get_buf_active(disp)->data);
+        }
+
+        frame_count++;
+    }
+
+    lv_display_flush_ready(disp);
+}
+
+/**
+ * Get the current time
+ *
+ * @return the time in ms of either the virtual or the monotonic clock
+ */
+static uint32_t tick_get_cb(void)
+{
+    struct timespec ts;
+
+    if (tick_step != 0) {
+        return virtual_time;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+/**
+ * Write the frame to a PPM file
+ *
+ * @param disp the LVGL display
+ * @param px_map the pixels of the complete frame
+ */
+static void dump_frame(lv_display_t *disp, const uint8_t *px_map)
+{
+    FILE *fp;
+    int32_t x;
+    int32_t y;
+    uint16_t c16;
+    uint8_t rgb[3];
+    const uint8_t *px;
+    char path[PATH_MAX];
+    lv_color_format_t cf = lv_display_get_color_format(disp);
+    int32_t w = lv_display_get_horizontal_resolution(disp);
+    int32_t h = lv_display_get_vertical_resolution(disp);
+    uint32_t px_size = lv_color_format_get_size(cf);
+    uint32_t stride = lv_draw_buf_width_to_stride(w, cf);
+
+    snprintf(path, sizeof(path), "%s/frame_%06u.ppm", dump_dir, frame_count);
+    fp = fopen(path, "wb");
+
+    if (fp == NULL) {
+        LV_LOG_ERROR("Failed to open %s: %s", path, strerror(errno));
+        dump_dir = NULL;
+        return;
+    }
+
+    fprintf(fp, "P6\n%d %d\n255\n", (int)w, (int)h);
+
+    for (y = 0; y < h; y++) {
+
+        px = px_map + y * stride;
+
+        for (x = 0; x < w; x++, px += px_size) {
+
+            if (cf == LV_COLOR_FORMAT_RGB565) {
+                c16 = px[0] | (px[1] << 8);
+                rgb[0] = (c16 >> 8) & 0xF8;
+                rgb[1] = (c16 >> 3) & 0xFC;
+                rgb[2] = (c16 << 3) & 0xF8;
+            } else {
+                /* The 24 and 32 bit formats are stored as BGR(A) */
+                rgb[0] = px[2];
+                rgb[1] = px[1];
+                rgb[2] = px[0];
+            }
+
+            fwrite(rgb, 1, sizeof(rgb), fp);
+        }
+    }
+
+    fclose(fp);
+}
@@ -0,0 +1,1260 @@
+/**
+ * @file rfb.c
+ *
+ * The RFB (VNC) backend
+ *
+ * Serves the frames to a VNC viewer over the remote framebuffer protocol
+ * (RFC 6143). The flushed areas are copied into a shadow framebuffer and
+ * queued as dirty rectangles, a dedicated encoder thread encodes them with
+ * the tile based Hextile encoding and sends them, so that the LVGL thread
+ * never waits for the network. Without a client, flushing copies nothing
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "lvgl/lvgl.h"
+#include "../simulator_util.h"
+#include "../simulator_settings.h"
+#include "../driver_backends.h"
+#include "../display_buffers.h"
+#include "../backends.h"
+#include "../thread_sched.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define RFB_DEFAULT_ADDRESS "127.0.0.1"
+#define RFB_DEFAULT_PORT "5900"
+#define RFB_DESKTOP_NAME "lvglsim"
+
+/* Timeout of the handshake of a client in seconds */
+#define RFB_HANDSHAKE_TIMEOUT 5
+
+/* Maximum number of dirty rectangles queued, the next ones are joined */
+#define RFB_MAX_DIRTY 32
+
+#define RFB_TILE_SIZE 16
+
+/* Security types */
+#define RFB_SECURITY_NONE 1
+
+/* Encodings */
+#define RFB_ENCODING_RAW 0
+#define RFB_ENCODING_HEXTILE 5
+
+/* Sub-encodings of the Hextile tiles */
+#define HEXTILE_RAW 0x01
+#define HEXTILE_BACKGROUND_SPECIFIED 0x02
+#define HEXTILE_FOREGROUND_SPECIFIED 0x04
+#define HEXTILE_ANY_SUBRECTS 0x08
+#define HEXTILE_SUBRECTS_COLOURED 0x10
+
+/* Client to server messages */
+#define RFB_SET_PIXEL_FORMAT 0
+#define RFB_SET_ENCODINGS 2
+#define RFB_FRAMEBUFFER_UPDATE_REQUEST 3
+#define RFB_KEY_EVENT 4
+#define RFB_POINTER_EVENT 5
+#define RFB_CLIENT_CUT_TEXT 6
+
+/* Server to client messages */
+#define RFB_FRAMEBUFFER_UPDATE 0
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* The pixel format of a client */
+typedef struct {
+    uint8_t bits_per_pixel;
+    uint8_t depth;
+    uint8_t big_endian;
+    uint8_t true_colour;
+    uint16_t red_max;
+    uint16_t green_max;
+    uint16_t blue_max;
+    uint8_t red_shift;
+    uint8_t green_shift;
+    uint8_t blue_shift;
+} rfb_pixel_format_t;
+
+/* The message being encoded */
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t size;
+} rfb_buffer_t;
+
+/* A subrectangle of a Hextile tile */
+typedef struct {
+    uint32_t color;
+    uint8_t xy;
+    uint8_t wh;
+} hextile_subrect_t;
+
+/* The state of the server */
+typedef struct {
+    lv_display_t *disp;
+    lv_indev_t *indev;
+    int32_t width;
+    int32_t height;
+
+    pthread_t thread;
+    int listen_fd;
+    int client_fd;          /* -1 without client, only used by the encoder thread */
+    int encoder_wake_fd;    /* eventfd waking up the encoder thread on flush */
+    int lvgl_wake_fd;       /* eventfd waking up the LVGL thread on connect and input */
+
+    /* Shared between the LVGL and the encoder threads */
+    pthread_mutex_t lock;
+    uint32_t *shadow;       /* XRGB8888 copy of the frames, written on flush */
+    lv_area_t dirty[RFB_MAX_DIRTY];
+    uint32_t dirty_cnt;
+    bool connected;
+    bool refresh;           /* A client connected, the whole display must be redrawn */
+    int32_t pointer_x;
+    int32_t pointer_y;
+    bool pressed;
+
+    /* Only used by the encoder thread */
+    uint32_t *fb;           /* The frame being encoded */
+    lv_area_t client_dirty[RFB_MAX_DIRTY];
+    uint32_t client_dirty_cnt;
+    bool update_requested;
+    bool hextile;
+    rfb_pixel_format_t pf;
+    uint32_t bytes_per_pixel;
+    rfb_buffer_t out;
+    bool bg_valid;
+    uint32_t bg;
+} rfb_server_t;
+
+/**********************
+ *  EXTERNAL VARIABLES
+ **********************/
+extern simulator_settings_t settings;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static lv_display_t *init_rfb(void);
+static int open_listen_socket(void);
+static void flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map);
+static void copy_to_shadow(lv_display_t *disp, const lv_area_t *area, const uint8_t *px_map);
+static void lvgl_wake_cb(int fd, uint32_t events, void *user_data);
+static void pointer_read_cb(lv_indev_t *indev, lv_indev_data_t *data);
+static void *encoder_thread(void *arg);
+static int handshake(void);
+static int handle_message(void);
+static void disconnect(void);
+static void take_dirty(void);
+static int send_update(void);
+static void encode_raw(const lv_area_t *area);
+static void encode_hextile(const lv_area_t *area);
+static void encode_tile(int32_t x, int32_t y, int32_t w, int32_t h);
+static void add_dirty(lv_area_t *list, uint32_t *cnt, const lv_area_t *area);
+static void put_u8(uint8_t value);
+static void put_u16(uint16_t value);
+static void put_u32(uint32_t value);
+static void put_pixel(uint32_t xrgb);
+static int read_full(int fd, void *buf, size_t len);
+static int write_full(int fd, const void *buf, size_t len);
+static void notify(int fd);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static char *backend_name = "RFB";
+
+static rfb_server_t server = {
+    .listen_fd = -1,
+    .client_fd = -1,
+    .encoder_wake_fd = -1,
+    .lvgl_wake_fd = -1,
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+/* The pixel format of the server, XRGB8888 little endian */
+static const rfb_pixel_format_t server_pf = {
+    .bits_per_pixel = 32,
+    .depth = 24,
+    .big_endian = 0,
+    .true_colour = 1,
+    .red_max = 255,
+    .green_max = 255,
+    .blue_max = 255,
+    .red_shift = 16,
+    .green_shift = 8,
+    .blue_shift = 0
+};
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+/**
+ * Register the backend
+ *
+ * @param backend the backend descriptor
+ * @description configures the descriptor
+ */
+int backend_init_rfb(backend_t *backend)
+{
+    LV_ASSERT_NULL(backend);
+
+    backend->handle->display = malloc(sizeof(display_backend_t));
+    LV_ASSERT_NULL(backend->handle->display);
+
+    backend->handle->display->init_display = init_rfb;
+    backend->handle->display->run_loop = NULL;
+    backend->handle->display->timer_handler = NULL;
+    backend->handle->display->init_cursor = NULL;
+    backend->handle->display->main_thread = false;
+    backend->name = backend_name;
+    backend->type = BACKEND_DISPLAY;
+
+    return 0;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Initialize the RFB display
+ *
+ * @description the frames are rendered in DIRECT mode by default, the
+ * pointer events of the client are read by a pointer input device
+ * @return the LVGL display
+ */
+static lv_display_t *init_rfb(void)
+{
+    int ret;
+    lv_display_t *disp;
+    size_t fb_size;
+    pthread_attr_t attr;
+
+    server.width = settings.window_width;
+    server.height = settings.window_height;
+
+    disp = lv_display_create(server.width, server.height);
+
+    if (disp == NULL) {
+        return NULL;
+    }
+
+    if (settings.color_format != LV_COLOR_FORMAT_UNKNOWN) {
+        lv_display_set_color_format(disp, settings.color_format);
+    }
+
+    if (display_buffers_setup(disp, LV_DISPLAY_RENDER_MODE_DIRECT) == -1) {
+        lv_display_delete(disp);
+        return NULL;
+    }
+
+    lv_display_set_flush_cb(disp, flush_cb);
+    server.disp = disp;
+
+    fb_size = (size_t)server.width * server.height * sizeof(uint32_t);
+    server.shadow = calloc(1, fb_size);
+    LV_ASSERT_NULL(server.shadow);
+    server.fb = calloc(1, fb_size);
+    LV_ASSERT_NULL(server.fb);
+
+    server.listen_fd = open_listen_socket();
+    server.encoder_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    server.lvgl_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (server.listen_fd == -1 || server.encoder_wake_fd == -1 || server.lvgl_wake_fd == -1) {
+        die("Failed to setup the RFB server\n");
+    }
+
+    if (driver_backends_watch_fd(server.lvgl_wake_fd, EPOLLIN, lvgl_wake_cb, NULL) == -1) {
+        die("Failed to watch the RFB server\n");
+    }
+
+    server.indev = lv_indev_create();
+    lv_indev_set_type(server.indev, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_read_cb(server.indev, pointer_read_cb);
+    lv_indev_set_display(server.indev, disp);
+
+    /* The encoder runs in the background, it doesn't take the policy
+     * and the CPUs of the main role */
+    thread_sched_init_helper_attr(&attr);
+    ret = pthread_create(&server.thread, &attr, encoder_thread, NULL);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0) {
+        die("Failed to create the RFB encoder thread: %s\n", strerror(ret));
+    }
+
+    return disp;
+}
+
+/**
+ * Open the socket the clients connect to
+ *
+ * @description LV_LINUX_RFB_ADDRESS and LV_LINUX_RFB_PORT, the server
+ * has no authentication so it only listens on the loopback by default
+ * @return the socket, -1 on error
+ */
+static int open_listen_socket(void)
+{
+    int fd;
+    int one = 1;
+    struct sockaddr_in addr;
+    const char *address = getenv_default("LV_LINUX_RFB_ADDRESS", RFB_DEFAULT_ADDRESS);
+    int port = atoi(getenv_default("LV_LINUX_RFB_PORT", RFB_DEFAULT_PORT));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+
+    if (inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+        LV_LOG_ERROR("Invalid RFB address: %s", address);
+        return -1;
+    }
+
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd == -1) {
+        LV_LOG_ERROR("socket failed: %s", strerror(errno));
+        return -1;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(fd, 1) == -1) {
+        LV_LOG_ERROR("Unable to listen on %s:%d: %s", address, port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    LV_LOG_USER("RFB server listening on %s:%d", address, port);
+    return fd;
+}
+
+/**
+ * Queue the flushed areas
+ *
+ * @description the area is converted into the shadow framebuffer and
+ * queued, the encoder thread is woken up once the frame is complete.
+ * Without a client nothing is copied
+ * @note called by LVGL
+ */
+static void flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    if (!__atomic_load_n(&server.connected, __ATOMIC_ACQUIRE)) {
+        lv_display_flush_ready(disp);
+        return;
+    }
+
+    pthread_mutex_lock(&server.lock);
+    copy_to_shadow(disp, area, px_map);
+    add_dirty(server.dirty, &server.dirty_cnt, area);
+    pthread_mutex_unlock(&server.lock);
+
+    if (lv_display_flush_is_last(disp)) {
+        notify(server.encoder_wake_fd);
+    }
+
+    lv_display_flush_ready(disp);
+}
+
+/**
+ * Convert a flushed area into the shadow framebuffer
+ *
+ * @param disp the LVGL display
+ * @param area the flushed area
+ * @param px_map the draw buffer, of the area in PARTIAL mode, of the display otherwise
+ */
+static void copy_to_shadow(lv_display_t *disp, const lv_area_t *area, const uint8_t *px_map)
+{
+    int32_t x;
+    int32_t y;
+    uint16_t c16;
+    uint32_t stride;
+    const uint8_t *row;
+    const uint8_t *px;
+    uint32_t *dst;
+    lv_color_format_t cf = lv_display_get_color_format(disp);
+    uint32_t px_size = lv_color_format_get_size(cf);
+    int32_t w = lv_area_get_width(area);
+    int32_t h = lv_area_get_height(area);
+
+    if (lv_display_get_render_mode(disp) == LV_DISPLAY_RENDER_MODE_PARTIAL) {
+        stride = lv_draw_buf_width_to_stride(w, cf);
+        row = px_map;
+    } else {
+        stride = lv_display_get_buf_active(disp)->header.stride;
+        row = px_map + area->y1 * stride + area->x1 * px_size;
+    }
+
+    for (y = 0; y < h; y++, row += stride) {
+
+        dst = server.shadow + (area->y1 + y) * server.width + area->x1;
+
+        switch (cf) {
+        case LV_COLOR_FORMAT_RGB565:
+            for (x = 0, px = row; x < w; x++, px += 2) {
+                c16 = px[0] | (px[1] << 8);
+                dst[x] = ((c16 & 0xf800) << 8) | ((c16 & 0x07e0) << 5) | ((c16 & 0x001f) << 3);
+            }
+            break;
+        case LV_COLOR_FORMAT_RGB888:
+            for (x = 0, px = row; x < w; x++, px += 3) {
+                dst[x] = (px[2] << 16) | (px[1] << 8) | px[0];
+            }
+            break;
+        default:
+            /* XRGB8888 and ARGB8888 */
+            memcpy(dst, row, w * sizeof(uint32_t));
+            break;
+        }
+    }
+}
+
+/**
+ * Handle the events of the encoder thread
+ *
+ * @description redraws the whole display when a client connects, so
+ * that the shadow framebuffer is complete, and reads the pointer
+ * @note called by the run loop
+ */
+static void lvgl_wake_cb(int fd, uint32_t events, void *user_data)
+{
+    uint64_t count;
+    lv_area_t area;
+
+    LV_UNUSED(events);
+    LV_UNUSED(user_data);
+
+    if (read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+        LV_LOG_WARN("Failed to read the RFB eventfd: %s", strerror(errno));
+    }
+
+    if (__atomic_exchange_n(&server.refresh, false, __ATOMIC_ACQ_REL)) {
+        lv_area_set(&area, 0, 0, server.width - 1, server.height - 1);
+        lv_inv_area(server.disp, &area);
+    }
+
+    lv_timer_ready(lv_indev_get_read_timer(server.indev));
+}
+
+/**
+ * Read the pointer of the client
+ *
+ * @note called by LVGL
+ */
+static void pointer_read_cb(lv_indev_t *indev, lv_indev_data_t *data)
+{
+    LV_UNUSED(indev);
+
+    pthread_mutex_lock(&server.lock);
+
+    data->point.x = server.pointer_x;
+    data->point.y = server.pointer_y;
+    data->state = server.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+
+    pthread_mutex_unlock(&server.lock);
+}
+
+/**
+ * The encoder thread
+ *
+ * @description serves one client at a time, waits for its messages and
+ * for the frames flushed by the LVGL thread. The frames are encoded and
+ * sent as soon as the client requested an update, the pending areas of
+ * the next frames are joined meanwhile. Doesn't use LVGL
+ */
+static void *encoder_thread(void *arg)
+{
+    int fd;
+    struct pollfd fds[2];
+    uint64_t count;
+
+    LV_UNUSED(arg);
+
+    while (1) {
+
+        if (server.client_fd == -1) {
+
+            fd = accept(server.listen_fd, NULL, NULL);
+
+            if (fd == -1) {
+                if (errno != EINTR) {
+                    LV_LOG_ERROR("RFB accept failed: %s", strerror(errno));
+                    break;
+                }
+                continue;
+            }
+
+            server.client_fd = fd;
+
+            if (handshake() == -1) {
+                disconnect();
+                continue;
+            }
+
+            LV_LOG_USER("RFB client connected");
+            continue;
+        }
+
+        fds[0].fd = server.client_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = server.encoder_wake_fd;
+        fds[1].events = POLLIN;
+
+        if (poll(fds, 2, -1) == -1) {
+            if (errno != EINTR) {
+                LV_LOG_ERROR("RFB poll failed: %s", strerror(errno));
+                break;
+            }
+            continue;
+        }
+
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            if (handle_message() == -1) {
+                disconnect();
+                continue;
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            if (read(server.encoder_wake_fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+                LV_LOG_WARN("Failed to read the RFB eventfd: %s", strerror(errno));
+            }
+            take_dirty();
+        }
+
+        if (server.update_requested && server.client_dirty_cnt > 0) {
+            if (send_update() == -1) {
+                disconnect();
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Negotiate the protocol version, the security and the initialization
+ *
+ * @description versions 3.3, 3.7 and 3.8 are supported, without
+ * authentication
+ * @return 0 on success, -1 on error
+ */
+static int handshake(void)
+{
+    int minor;
+    int one = 1;
+    uint8_t type;
+    uint8_t shared;
+    char version[13];
+    struct timeval timeout = { .tv_sec = RFB_HANDSHAKE_TIMEOUT, .tv_usec = 0 };
+    int fd = server.client_fd;
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    if (write_full(fd, "RFB 003.008\n", 12) == -1 || read_full(fd, version, 12) == -1) {
+        return -1;
+    }
+
+    version[12] = '\0';
+
+    if (sscanf(version, "RFB 003.%03d\n", &minor) != 1) {
+        LV_LOG_WARN("Unsupported RFB client version: %.11s", version);
+        return -1;
+    }
+
+    if (minor >= 7) {
+        /* The client picks one of the security types */
+        if (write_full(fd, "\x01\x01", 2) == -1 || read_full(fd, &type, 1) == -1 ||
+            type != RFB_SECURITY_NONE) {
+            return -1;
+        }
+    }
+
+    server.out.len = 0;
+
+    if (minor < 7) {
+        put_u32(RFB_SECURITY_NONE);
+    } else if (minor >= 8) {
+        /* SecurityResult OK */
+        put_u32(0);
+    }
+
+    if (write_full(fd, server.out.data, server.out.len) == -1 || read_full(fd, &shared, 1) == -1) {
+        return -1;
+    }
+
+    /* ServerInit */
+    server.pf = server_pf;
+    server.bytes_per_pixel = server_pf.bits_per_pixel / 8;
+    server.hextile = false;
+    server.update_requested = false;
+    server.out.len = 0;
+
+    put_u16(server.width);
+    put_u16(server.height);
+    put_u8(server_pf.bits_per_pixel);
+    put_u8(server_pf.depth);
+    put_u8(server_pf.big_endian);
+    put_u8(server_pf.true_colour);
+    put_u16(server_pf.red_max);
+    put_u16(server_pf.green_max);
+    put_u16(server_pf.blue_max);
+    put_u8(server_pf.red_shift);
+    put_u8(server_pf.green_shift);
+    put_u8(server_pf.blue_shift);
+    put_u8(0);
+    put_u8(0);
+    put_u8(0);
+    put_u32(strlen(RFB_DESKTOP_NAME));
+
+    if (write_full(fd, server.out.data, server.out.len) == -1 ||
+        write_full(fd, RFB_DESKTOP_NAME, strlen(RFB_DESKTOP_NAME)) == -1) {
+        return -1;
+    }
+
+    timeout.tv_sec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    /* The frames are copied from now on, the display is redrawn entirely */
+    pthread_mutex_lock(&server.lock);
+    server.dirty_cnt = 0;
+    __atomic_store_n(&server.connected, true, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&server.lock);
+
+    server.client_dirty_cnt = 0;
+    __atomic_store_n(&server.refresh, true, __ATOMIC_RELEASE);
+    notify(server.lvgl_wake_fd);
+
+    return 0;
+}
+
+/**
+ * Handle a message of the client
+ *
+ * @return 0 on success, -1 if the client must be disconnected
+ */
+static int handle_message(void)
+{
+    int i;
+    uint8_t type;
+    uint8_t msg[20];
+    uint16_t count;
+    int32_t encoding;
+    uint32_t len;
+    size_t n;
+    char discard[256];
+    lv_area_t area;
+    int fd = server.client_fd;
+
+    if (read_full(fd, &type, 1) == -1) {
+        return -1;
+    }
+
+    switch (type) {
+    case RFB_SET_PIXEL_FORMAT:
+        if (read_full(fd, msg, 19) == -1) {
+            return -1;
+        }
+
+        server.pf.bits_per_pixel = msg[3];
+        server.pf.depth = msg[4];
+        server.pf.big_endian = msg[5];
+        server.pf.true_colour = msg[6];
+        server.pf.red_max = (msg[7] << 8) | msg[8];
+        server.pf.green_max = (msg[9] << 8) | msg[10];
+        server.pf.blue_max = (msg[11] << 8) | msg[12];
+        server.pf.red_shift = msg[13];
+        server.pf.green_shift = msg[14];
+        server.pf.blue_shift = msg[15];
+        server.bytes_per_pixel = server.pf.bits_per_pixel / 8;
+
+        if (!server.pf.true_colour || (server.bytes_per_pixel != 1 &&
+            server.bytes_per_pixel != 2 && server.bytes_per_pixel != 4)) {
+            LV_LOG_WARN("Unsupported RFB pixel format, %d bpp", server.pf.bits_per_pixel);
+            return -1;
+        }
+        break;
+    case RFB_SET_ENCODINGS:
+        if (read_full(fd, msg, 3) == -1) {
+            return -1;
+        }
+
+        count = (msg[1] << 8) | msg[2];
+        server.hextile = false;
+
+        for (i = 0; i < count; i++) {
+            if (read_full(fd, msg, 4) == -1) {
+                return -1;
+            }
+
+            encoding = (int32_t)(((uint32_t)msg[0] << 24) | (msg[1] << 16) | (msg[2] << 8) | msg[3]);
+
+            if (encoding == RFB_ENCODING_HEXTILE) {
+                server.hextile = true;
+            }
+        }
+        break;
+    case RFB_FRAMEBUFFER_UPDATE_REQUEST:
+        if (read_full(fd, msg, 9) == -1) {
+            return -1;
+        }
+
+        area.x1 = (msg[1] << 8) | msg[2];
+        area.y1 = (msg[3] << 8) | msg[4];
+        area.x2 = LV_MIN(area.x1 + ((msg[5] << 8) | msg[6]), server.width) - 1;
+        area.y2 = LV_MIN(area.y1 + ((msg[7] << 8) | msg[8]), server.height) - 1;
+
+        /* Not incremental, the client wants the content of the area */
+        if (msg[0] == 0 && area.x2 >= area.x1 && area.y2 >= area.y1) {
+            add_dirty(server.client_dirty, &server.client_dirty_cnt, &area);
+        }
+
+        server.update_requested = true;
+        break;
+    case RFB_KEY_EVENT:
+        /* The keyboard is not handled */
+        if (read_full(fd, msg, 7) == -1) {
+            return -1;
+        }
+        break;
+    case RFB_POINTER_EVENT:
+        if (read_full(fd, msg, 5) == -1) {
+            return -1;
+        }
+
+        pthread_mutex_lock(&server.lock);
+        server.pressed = (msg[0] & 0x01) != 0;
+        server.pointer_x = LV_MIN((msg[1] << 8) | msg[2], server.width - 1);
+        server.pointer_y = LV_MIN((msg[3] << 8) | msg[4], server.height - 1);
+        pthread_mutex_unlock(&server.lock);
+
+        notify(server.lvgl_wake_fd);
+        break;
+    case RFB_CLIENT_CUT_TEXT:
+        if (read_full(fd, msg, 7) == -1) {
+            return -1;
+        }
+
+        len = ((uint32_t)msg[3] << 24) | (msg[4] << 16) | (msg[5] << 8) | msg[6];
+
+        while (len > 0) {
+            n = LV_MIN(len, sizeof(discard));
+
+            if (read_full(fd, discard, n) == -1) {
+                return -1;
+            }
+
+            len -= n;
+        }
+        break;
+    default:
+        LV_LOG_WARN("Unknown RFB message %d", type);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Disconnect the client
+ *
+ * @description the LVGL thread stops copying the frames
+ */
+static void disconnect(void)
+{
+    pthread_mutex_lock(&server.lock);
+    __atomic_store_n(&server.connected, false, __ATOMIC_RELEASE);
+    server.dirty_cnt = 0;
+    pthread_mutex_unlock(&server.lock);
+
+    close(server.client_fd);
+    server.client_fd = -1;
+
+    LV_LOG_USER("RFB client disconnected");
+}
+
+/**
+ * Take the areas flushed by the LVGL thread
+ *
+ * @description the areas are copied from the shadow framebuffer, so
+ * that the LVGL thread only waits for the copy and never for the encoding
+ */
+static void take_dirty(void)
+{
+    uint32_t i;
+    int32_t y;
+    size_t offset;
+    size_t len;
+    lv_area_t *area;
+
+    pthread_mutex_lock(&server.lock);
+
+    for (i = 0; i < server.dirty_cnt; i++) {
+
+        area = &server.dirty[i];
+        len = lv_area_get_width(area) * sizeof(uint32_t);
+
+        for (y = area->y1; y <= area->y2; y++) {
+            offset = (size_t)y * server.width + area->x1;
+            memcpy(server.fb + offset, server.shadow + offset, len);
+        }
+
+        add_dirty(server.client_dirty, &server.client_dirty_cnt, area);
+    }
+
+    server.dirty_cnt = 0;
+
+    pthread_mutex_unlock(&server.lock);
+}
+
+/**
+ * Send the pending areas
+ *
+ * @return 0 on success, -1 on error
+ */
+static int send_update(void)
+{
+    uint32_t i;
+    lv_area_t *area;
+
+    server.out.len = 0;
+
+    put_u8(RFB_FRAMEBUFFER_UPDATE);
+    put_u8(0);
+    put_u16(server.client_dirty_cnt);
+
+    for (i = 0; i < server.client_dirty_cnt; i++) {
+
+        area = &server.client_dirty[i];
+
+        put_u16(area->x1);
+        put_u16(area->y1);
+        put_u16(lv_area_get_width(area));
+        put_u16(lv_area_get_height(area));
+
+        if (server.hextile) {
+            put_u32(RFB_ENCODING_HEXTILE);
+            encode_hextile(area);
+        } else {
+            put_u32(RFB_ENCODING_RAW);
+            encode_raw(area);
+        }
+    }
+
+    server.client_dirty_cnt = 0;
+    server.update_requested = false;
+
+    return write_full(server.client_fd, server.out.data, server.out.len);
+}
+
+/**
+ * Encode an area with the Raw encoding
+ *
+ * @param area the area
+ */
+static void encode_raw(const lv_area_t *area)
+{
+    int32_t x;
+    int32_t y;
+    const uint32_t *row;
+
+    for (y = area->y1; y <= area->y2; y++) {
+
+        row = server.fb + (size_t)y * server.width;
+
+        for (x = area->x1; x <= area->x2; x++) {
+            put_pixel(row[x]);
+        }
+    }
+}
+
+/**
+ * Encode an area with the Hextile encoding
+ *
+ * @description the area is split in tiles of 16x16 pixels, from left
+ * to right and top to bottom
+ * @param area the area
+ */
+static void encode_hextile(const lv_area_t *area)
+{
+    int32_t x;
+    int32_t y;
+
+    /* The background is not carried over from the previous rectangle */
+    server.bg_valid = false;
+
+    for (y = area->y1; y <= area->y2; y += RFB_TILE_SIZE) {
+        for (x = area->x1; x <= area->x2; x += RFB_TILE_SIZE) {
+            encode_tile(x, y, LV_MIN(RFB_TILE_SIZE, area->x2 - x + 1),
+                        LV_MIN(RFB_TILE_SIZE, area->y2 - y + 1));
+        }
+    }
+}
+
+/**
+ * Encode a tile
+ *
+ * @description a solid tile only costs its background color, or nothing
+ * if it is the same as the previous tile. Otherwise the pixels that differ
+ * from the background are covered with subrectangles, grown to the right
+ * then downwards. The tile is sent raw when it would be smaller
+ *
+ * @param x the left of the tile
+ * @param y the top of the tile
+ * @param w the width of the tile
+ * @param h the height of the tile
+ */
+static void encode_tile(int32_t x, int32_t y, int32_t w, int32_t h)
+{
+    int32_t i;
+    int32_t j;
+    int32_t k;
+    int32_t sw;
+    int32_t sh;
+    uint32_t n = 0;
+    uint32_t bg;
+    uint32_t color;
+    size_t bg_size;
+    size_t size;
+    size_t raw_size;
+    bool solid = true;
+    bool mono = true;
+    bool fits = true;
+    uint8_t flags;
+    uint32_t px[RFB_TILE_SIZE * RFB_TILE_SIZE];
+    bool covered[RFB_TILE_SIZE * RFB_TILE_SIZE];
+    hextile_subrect_t subrects[RFB_TILE_SIZE * RFB_TILE_SIZE];
+    uint32_t bpp = server.bytes_per_pixel;
+
+    for (j = 0; j < h; j++) {
+        memcpy(&px[j * w], server.fb + (size_t)(y + j) * server.width + x, w * sizeof(uint32_t));
+    }
+
+    bg = px[0];
+
+    for (i = 1; i < w * h && solid; i++) {
+        solid = px[i] == bg;
+    }
+
+    if (solid) {
+        if (server.bg_valid && server.bg == bg) {
+            put_u8(0);
+        } else {
+            put_u8(HEXTILE_BACKGROUND_SPECIFIED);
+            put_pixel(bg);
+        }
+
+        server.bg = bg;
+        server.bg_valid = true;
+        return;
+    }
+
+    raw_size = w * h * bpp;
+    bg_size = server.bg_valid && server.bg == bg ? 0 : bpp;
+    memset(covered, 0, sizeof(covered));
+
+    for (j = 0; j < h && fits; j++) {
+        for (i = 0; i < w && fits; i++) {
+
+            color = px[j * w + i];
+
+            if (color == bg || covered[j * w + i]) {
+                continue;
+            }
+
+            /* Grow to the right */
+            for (sw = 1; i + sw < w; sw++) {
+                if (px[j * w + i + sw] != color || covered[j * w + i + sw]) {
+                    break;
+                }
+            }
+
+            /* Then downwards while the whole row matches */
+            for (sh = 1; j + sh < h; sh++) {
+                for (k = 0; k < sw; k++) {
+                    if (px[(j + sh) * w + i + k] != color || covered[(j + sh) * w + i + k]) {
+                        break;
+                    }
+                }
+                if (k < sw) {
+                    break;
+                }
+            }
+
+            for (k = 0; k < sh; k++) {
+                memset(&covered[(j + k) * w + i], 1, sw);
+            }
+
+            subrects[n].color = color;
+            subrects[n].xy = (i << 4) | j;
+            subrects[n].wh = ((sw - 1) << 4) | (sh - 1);
+            mono = mono && color == subrects[0].color;
+            n++;
+
+            /* Give up once even a single foreground color would be larger */
+            fits = bg_size + bpp + 1 + 2 * n < raw_size;
+        }
+    }
+
+    if (fits) {
+        size = bg_size + 1 + (mono ? bpp + 2 * n : (bpp + 2) * n);
+        fits = size < raw_size;
+    }
+
+    if (!fits) {
+        put_u8(HEXTILE_RAW);
+
+        for (i = 0; i < w * h; i++) {
+            put_pixel(px[i]);
+        }
+
+        /* The background of the next tile must be specified again */
+        server.bg_valid = false;
+        return;
+    }
+
+    flags = HEXTILE_ANY_SUBRECTS;
+
+    if (!server.bg_valid || server.bg != bg) {
+        flags |= HEXTILE_BACKGROUND_SPECIFIED;
+    }
+
+    flags |= mono ? HEXTILE_FOREGROUND_SPECIFIED : HEXTILE_SUBRECTS_COLOURED;
+    put_u8(flags);
+
+    if (flags & HEXTILE_BACKGROUND_SPECIFIED) {
+        put_pixel(bg);
+    }
+
+    if (mono) {
+        put_pixel(subrects[0].color);
+    }
+
+    put_u8(n);
+
+    for (i = 0; i < (int32_t)n; i++) {
+        if (!mono) {
+            put_pixel(subrects[i].color);
+        }
+        put_u8(subrects[i].xy);
+        put_u8(subrects[i].wh);
+    }
+
+    server.bg = bg;
+    server.bg_valid = true;
+}
+
+/**
+ * Add an area to a list of dirty rectangles
+ *
+ * @description an area overlapping a rectangle of the list is joined
+ * with it, once the list is full all the rectangles are joined
+ * @param list the list
+ * @param cnt the number of rectangles in the list
+ * @param area the area to add
+ */
+static void add_dirty(lv_area_t *list, uint32_t *cnt, const lv_area_t *area)
+{
+    uint32_t i;
+    lv_area_t *r;
+
+    for (i = 0; i < *cnt; i++) {
+
+        r = &list[i];
+
+        if (area->x1 <= r->x2 + 1 && area->x2 + 1 >= r->x1 &&
+            area->y1 <= r->y2 + 1 && area->y2 + 1 >= r->y1) {
+            r->x1 = LV_MIN(r->x1, area->x1);
+            r->y1 = LV_MIN(r->y1, area->y1);
+            r->x2 = LV_MAX(r->x2, area->x2);
+            r->y2 = LV_MAX(r->y2, area->y2);
+            return;
+        }
+    }
+
+    if (*cnt < RFB_MAX_DIRTY) {
+        list[(*cnt)++] = *area;
+        return;
+    }
+
+    r = &list[0];
+
+    for (i = 1; i < *cnt; i++) {
+        r->x1 = LV_MIN(r->x1, list[i].x1);
+        r->y1 = LV_MIN(r->y1, list[i].y1);
+        r->x2 = LV_MAX(r->x2, list[i].x2);
+        r->y2 = LV_MAX(r->y2, list[i].y2);
+    }
+
+    r->x1 = LV_MIN(r->x1, area->x1);
+    r->y1 = LV_MIN(r->y1, area->y1);
+    r->x2 = LV_MAX(r->x2, area->x2);
+    r->y2 = LV_MAX(r->y2, area->y2);
+    *cnt = 1;
+}
+
+/**
+ * Append a byte to the message being encoded
+ *
+ * @param value the value
+ */
+static void put_u8(uint8_t value)
+{
+    if (server.out.len == server.out.size) {
+        server.out.size = server.out.size == 0 ? 65536 : server.out.size * 2;
+        server.out.data = realloc(server.out.data, server.out.size);
+        LV_ASSERT_NULL(server.out.data);
+    }
+
+    server.out.data[server.out.len++] = value;
+}
+
+/**
+ * Append a 16 bit value in network byte order
+ *
+ * @param value the value
+ */
+static void put_u16(uint16_t value)
+{
+    put_u8(value >> 8);
+    put_u8(value);
+}
+
+/**
+ * Append a 32 bit value in network byte order
+ *
+ * @param value the value
+ */
+static void put_u32(uint32_t value)
+{
+    put_u16(value >> 16);
+    put_u16(value);
+}
+
+/**
+ * Append a pixel in the pixel format of the client
+ *
+ * @param xrgb the XRGB8888 color
+ */
+static void put_pixel(uint32_t xrgb)
+{
+    uint32_t i;
+    uint32_t value;
+    const rfb_pixel_format_t *pf = &server.pf;
+
+    value = ((((xrgb >> 16) & 0xff) * pf->red_max / 255) << pf->red_shift) |
+            ((((xrgb >> 8) & 0xff) * pf->green_max / 255) << pf->green_shift) |
+            (((xrgb & 0xff) * pf->blue_max / 255) << pf->blue_shift);
+
+    for (i = 0; i < server.bytes_per_pixel; i++) {
+        if (pf->big_endian) {
+            put_u8(value >> (8 * (server.bytes_per_pixel - 1 - i)));
+        } else {
+            put_u8(value >> (8 * i));
+        }
+    }
+}
+
+/**
+ * Read exactly len bytes
+ *
+ * @return 0 on success, -1 on error or if the connection was closed
+ */
+static int read_full(int fd, void *buf, size_t len)
+{
+    ssize_t n;
+    uint8_t *p = buf;
+
+    while (len > 0) {
+
+        n = recv(fd, p, len, 0);
+
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            return -1;
+        }
+
+        p += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+/**
+ * Write exactly len bytes
+ *
+ * @return 0 on success, -1 on error
+ */
+static int write_full(int fd, const void *buf, size_t len)
+{
+    ssize_t n;
+    const uint8_t *p = buf;
+
+    while (len > 0) {
+
+        n = send(fd, p, len, MSG_NOSIGNAL);
+
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            return -1;
+        }
+
+        p += n;
+        len -= n;
+    }
+
+    return 0;
+}
+
+/**
+ * Wake up a thread
+ *
+ * @param fd the eventfd the thread waits for
+ */
+static void notify(int fd)
+{
+    uint64_t one = 1;
+
+    if (write(fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+        LV_LOG_WARN("Failed to wake up the RFB thread: %s", strerror(errno));
+    }
+}
@@ -15,14 +15,18 @@
 /*********************
  *      INCLUDES
  *********************/
-#include <unistd.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "lvgl/lvgl.h"
 #if LV_USE_SDL
+#include LV_SDL_INCLUDE_PATH
+
 #include "../simulator_util.h"
 #include "../simulator_settings.h"
+#include "../display_buffers.h"
+#include "../driver_backends.h"
 #include "../backends.h"
 
 /*********************
@@ -33,6 +37,20 @@
  *      TYPEDEFS
  **********************/
 
+/* The state of the vsync presentation
+ * LVGL renders into its own buffers, the invalidated areas are copied
+ * into a streaming texture which is presented once per frame, the
+ * present blocks until the next vertical blank */
+typedef struct {
+    lv_display_t *disp;
+    SDL_Renderer *renderer;
+    SDL_Texture *texture;
+    Uint32 format;
+    int32_t width;
+    int32_t height;
+    bool exposed;              /* The window was exposed, redraw the display */
+} sdl_vsync_t;
+
 /**********************
  *  EXTERNAL VARIABLES
  **********************/
@@ -41,8 +59,13 @@ extern simulator_settings_t settings;
 /**********************
  *  STATIC PROTOTYPES
  **********************/
-static void run_loop_sdl(void);
 static lv_display_t *init_sdl(void);
+static uint32_t timer_handler_sdl(void);
+static int init_vsync(lv_display_t *disp);
+static int create_texture(void);
+static Uint32 texture_format(lv_color_format_t cf);
+static void flush_vsync_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map);
+static int window_event_watch(void *user_data, SDL_Event *event);
 
 /**********************
  *  STATIC VARIABLES
@@ -50,6 +73,10 @@ static lv_display_t *init_sdl(void);
 
 static char *backend_name = "SDL";
 
+static display_backend_t *display_backend;
+
+static sdl_vsync_t vsync;
+
 /**********************
  *      MACROS
  **********************/
@@ -71,7 +98,11 @@ int backend_init_sdl(backend_t *backend)
     LV_ASSERT_NULL(backend->handle->display);
 
     backend->handle->display->init_display = init_sdl;
-    backend->handle->display->run_loop = run_loop_sdl;
+    backend->handle->display->run_loop = NULL;
+    backend->handle->display->timer_handler = timer_handler_sdl;
+    backend->handle->display->init_cursor = NULL;
+    backend->handle->display->main_thread = true;
+    display_backend = backend->handle->display;
     backend->name = backend_name;
     backend->type = BACKEND_DISPLAY;
 
@@ -90,6 +121,9 @@ int backend_init_sdl(backend_t *backend)
 static lv_display_t *init_sdl(void)
 {
     lv_display_t *disp;
+    bool use_vsync = settings.vsync || atoi(getenv_default("LV_LINUX_SDL_VSYNC", "0"));
+
+    display_buffers_warn_unsupported(backend_name);
 
     disp = lv_sdl_window_create(settings.window_width, settings.window_height);
 
@@ -97,21 +131,220 @@ static lv_display_t *init_sdl(void)
         return NULL;
     }
 
+    if (use_vsync && init_vsync(disp) == -1) {
+        LV_LOG_WARN("vsync presentation unavailable - using the refresh timer");
+    }
+
     return disp;
 }
 
 /**
- * The run loop of the SDL driver
+ * Run the LVGL timers in the shared run loop
+ *
+ * @description the SDL events are polled by the event timer of the LVGL
+ * SDL driver, the run loop wakes up for it like for any other timer while
+ * the watched file descriptors and signals are served as soon as they are
+ * ready. The display is redrawn first if the window was exposed
+ * @return the time until the next timer is due
+ */
+static uint32_t timer_handler_sdl(void)
+{
+    if (vsync.exposed) {
+        vsync.exposed = false;
+#if LV_USE_OS != LV_OS_NONE
+        lv_lock();
+        lv_obj_invalidate(lv_display_get_screen_active(vsync.disp));
+        lv_unlock();
+#else
+        lv_obj_invalidate(lv_display_get_screen_active(vsync.disp));
+#endif
+    }
+
+    return lv_timer_handler();
+}
+
+/**
+ * Present the frames with vsync from a streaming texture
+ *
+ * @description the refresh timer runs at the refresh rate of the monitor,
+ * the frames are presented by the flush callback which replaces the one
+ * of the LVGL driver
+ * @param disp the LVGL display
+ * @return 0 on success, -1 on error
+ */
+static int init_vsync(lv_display_t *disp)
+{
+    SDL_DisplayMode mode;
+    SDL_Window *window;
+    uint32_t period;
+
+    vsync.disp = disp;
+    vsync.renderer = lv_sdl_window_get_renderer(disp);
+
+    if (vsync.renderer == NULL) {
+        return -1;
+    }
+
+    if (SDL_RenderSetVSync(vsync.renderer, 1) != 0) {
+        LV_LOG_ERROR("Failed to enable vsync: %s", SDL_GetError());
+        return -1;
+    }
+
+    vsync.format = texture_format(lv_display_get_color_format(disp));
+
+    if (vsync.format == SDL_PIXELFORMAT_UNKNOWN || create_texture() == -1) {
+        SDL_RenderSetVSync(vsync.renderer, 0);
+        return -1;
+    }
+
+    window = SDL_RenderGetWindow(vsync.renderer);
+
+    if (window != NULL &&
+        SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) == 0 &&
+        mode.refresh_rate > 0) {
+
+        /* Rounded down, the present blocks until the vertical blank */
+        period = LV_MAX(1000 / mode.refresh_rate, 1);
+        lv_timer_set_period(lv_display_get_refr_timer(disp), period);
+        display_backend->refr_period = period;
+        LV_LOG_USER("SDL vsync presentation at %d Hz", mode.refresh_rate);
+    }
+
+    /* The driver presents its own texture when the window is exposed */
+    SDL_AddEventWatch(window_event_watch, NULL);
+
+    lv_display_set_flush_cb(disp, flush_vsync_cb);
+
+    return 0;
+}
+
+/**
+ * Create the streaming texture with the resolution of the display
+ *
+ * @return 0 on success, -1 on error
+ */
+static int create_texture(void)
+{
+    if (vsync.texture != NULL) {
+        SDL_DestroyTexture(vsync.texture);
+    }
+
+    vsync.width = lv_display_get_horizontal_resolution(vsync.disp);
+    vsync.height = lv_display_get_vertical_resolution(vsync.disp);
+
+    vsync.texture = SDL_CreateTexture(vsync.renderer, vsync.format,
+                                      SDL_TEXTUREACCESS_STREAMING,
+                                      vsync.width, vsync.height);
+
+    if (vsync.texture == NULL) {
+        LV_LOG_ERROR("Failed to create the streaming texture: %s", SDL_GetError());
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Get the SDL pixel format of a color format
+ *
+ * @param cf the color format of the display
+ * @return the pixel format, SDL_PIXELFORMAT_UNKNOWN if not supported
+ */
+static Uint32 texture_format(lv_color_format_t cf)
+{
+    switch (cf) {
+    case LV_COLOR_FORMAT_RGB565:
+        return SDL_PIXELFORMAT_RGB565;
+    case LV_COLOR_FORMAT_RGB888:
+        return SDL_PIXELFORMAT_BGR24;
+    case LV_COLOR_FORMAT_XRGB8888:
+        return SDL_PIXELFORMAT_XRGB8888;
+    case LV_COLOR_FORMAT_ARGB8888:
+        return SDL_PIXELFORMAT_ARGB8888;
+    default:
+        return SDL_PIXELFORMAT_UNKNOWN;
+    }
+}
+
+/**
+ * Copy an invalidated area into the streaming texture
+ *
+ * @description only the area is locked and written, the whole texture
+ * is presented after the last area of the frame
+ * @note called by LVGL
+ */
+static void flush_vsync_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    SDL_Rect rect;
+    void *pixels;
+    int pitch;
+    int32_t y;
+    lv_color_format_t cf = lv_display_get_color_format(disp);
+    uint32_t px_size = lv_color_format_get_size(cf);
+    uint32_t row_size = lv_area_get_width(area) * px_size;
+    uint32_t src_stride;
+    const uint8_t *src;
+
+    /* The window was resized */
+    if ((vsync.width != lv_display_get_horizontal_resolution(disp) ||
+         vsync.height != lv_display_get_vertical_resolution(disp)) &&
+        create_texture() == -1) {
+        lv_display_flush_ready(disp);
+        return;
+    }
+
+    if (LV_SDL_RENDER_MODE == LV_DISPLAY_RENDER_MODE_PARTIAL) {
+        /* The buffer only holds the area */
+        src_stride = lv_draw_buf_width_to_stride(lv_area_get_width(area), cf);
+        src = px_map;
+    } else {
+        /* The buffer holds the whole screen */
+        src_stride = lv_draw_buf_width_to_stride(vsync.width, cf);
+        src = px_map + area->y1 * src_stride + area->x1 * px_size;
+    }
+
+    rect.x = area->x1;
+    rect.y = area->y1;
+    rect.w = lv_area_get_width(area);
+    rect.h = lv_area_get_height(area);
+
+    if (SDL_LockTexture(vsync.texture, &rect, &pixels, &pitch) == 0) {
+
+        for (y = 0; y < rect.h; y++) {
+            memcpy((uint8_t *)pixels + y * pitch, src + y * src_stride, row_size);
+        }
+
+        SDL_UnlockTexture(vsync.texture);
+    }
+
+    if (lv_display_flush_is_last(disp)) {
+        SDL_RenderClear(vsync.renderer);
+        SDL_RenderCopy(vsync.renderer, vsync.texture, NULL, NULL);
+
+        /* Blocks until the next vertical blank */
+        SDL_RenderPresent(vsync.renderer);
+    }
+
+    lv_display_flush_ready(disp);
+}
+
+/**
+ * Redraw the display once the window is exposed
+ *
+ * @description the LVGL driver presents its own texture that is no longer
+ * updated, timer_handler_sdl invalidates the display so that the next frame
+ * presents the streaming texture again
+ * @note called by SDL from SDL_PumpEvents
  */
-static void run_loop_sdl(void)
+static int window_event_watch(void *user_data, SDL_Event *event)
 {
-    uint32_t idle_time;
+    LV_UNUSED(user_data);
 
-    /* Handle LVGL tasks */
-    while (true) {
-        /* Returns the time to the next timer execution */
-        idle_time = lv_timer_handler();
-        usleep(idle_time * 1000);
+    if (event->type == SDL_WINDOWEVENT &&
+        event->window.event == SDL_WINDOWEVENT_EXPOSED) {
+        vsync.exposed = true;
     }
+
+    return 0;
 }
 #endif /*#if LV_USE_SDL*/
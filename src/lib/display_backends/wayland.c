@@ -18,11 +18,14 @@
 #include <unistd.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <sys/epoll.h>
 
 #include "lvgl/lvgl.h"
 #if LV_USE_WAYLAND
 #include "../simulator_util.h"
 #include "../simulator_settings.h"
+#include "../display_buffers.h"
+#include "../driver_backends.h"
 #include "../backends.h"
 
 /*********************
@@ -37,7 +40,8 @@
  *  STATIC PROTOTYPES
  **********************/
 static lv_display_t *init_wayland(void);
-static void run_loop_wayland(void);
+static uint32_t timer_handler_wayland(void);
+static void wayland_fd_ready_cb(int fd, uint32_t events, void *user_data);
 
 /**********************
  *  STATIC VARIABLES
@@ -70,7 +74,10 @@ int backend_init_wayland(backend_t *backend)
     LV_ASSERT_NULL(backend->handle->display);
 
     backend->handle->display->init_display = init_wayland;
-    backend->handle->display->run_loop = run_loop_wayland;
+    backend->handle->display->run_loop = NULL;
+    backend->handle->display->timer_handler = timer_handler_wayland;
+    backend->handle->display->init_cursor = NULL;
+    backend->handle->display->main_thread = false;
     backend->name = backend_name;
     backend->type = BACKEND_DISPLAY;
 
@@ -91,6 +98,8 @@ static lv_display_t *init_wayland(void)
     lv_display_t *disp;
     lv_group_t *g;
 
+    display_buffers_warn_unsupported(backend_name);
+
     disp = lv_wayland_window_create(settings.window_width, settings.window_height,
             "LVGL Simulator", NULL);
 
@@ -109,35 +118,53 @@ static lv_display_t *init_wayland(void)
     lv_indev_set_group(lv_wayland_get_keyboard(disp), g);
     lv_indev_set_group(lv_wayland_get_pointeraxis(disp), g);
 
+    /* Wake up the run loop when the compositor sends events */
+    if (driver_backends_watch_fd(lv_wayland_get_fd(), EPOLLIN, wayland_fd_ready_cb, NULL) == -1) {
+        die("Failed to watch the Wayland display\n");
+    }
+
     return disp;
 
 }
 
 /**
- * The run loop of the DRM driver
+ * Run the LVGL timers and handle the Wayland events
+ *
+ * @description lv_wayland_timer_handler reads and dispatches the events of
+ * the display connection (prepare_read, read_events, dispatch_pending),
+ * runs lv_timer_handler and flushes the requests. The frame callbacks
+ * of the compositor are dispatched there, while the surface is hidden
+ * no callback arrives and the driver doesn't render.
+ * The shared run loop then sleeps until the next timer or until the
+ * compositor sends an event
  *
- * @note Currently, the wayland driver calls lv_timer_handler internaly
- * The wayland driver needs to be re-written to match the other backends
+ * @note called by the shared run loop
+ * @return the time until the next timer is due
  */
-static void run_loop_wayland(void)
+static uint32_t timer_handler_wayland(void)
 {
+    uint32_t idle_time = lv_wayland_timer_handler();
 
-    uint32_t idle_time;
-
-    /* Handle LVGL tasks */
-    while (true) {
-
-        idle_time = lv_wayland_timer_handler();
+    /* Run until the last window closes */
+    if (!lv_wayland_window_is_open(NULL)) {
+        exit(EXIT_SUCCESS);
+    }
 
-        if(idle_time != 0) {
-            usleep(idle_time * 1000);
-        }
+    return idle_time;
+}
 
-        /* Run until the last window closes */
-        if (!lv_wayland_window_is_open(NULL)) {
-            break;
-        }
-    }
+/**
+ * Wake up the run loop
+ *
+ * @description the events are read by timer_handler_wayland right after
+ * the ready file descriptors are processed
+ * @note called by the run loop
+ */
+static void wayland_fd_ready_cb(int fd, uint32_t events, void *user_data)
+{
+    LV_UNUSED(fd);
+    LV_UNUSED(events);
+    LV_UNUSED(user_data);
 }
 
 #endif /*#if LV_USE_WAYLAND*/
@@ -16,24 +16,80 @@
  *      INCLUDES
  *********************/
 
-#include <unistd.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
 
 #include "lvgl/lvgl.h"
 #if LV_USE_X11
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XShm.h>
+
 #include "../simulator_util.h"
 #include "../simulator_settings.h"
+#include "../display_buffers.h"
+#include "../driver_backends.h"
 #include "../backends.h"
 
 /*********************
  *      DEFINES
  *********************/
 
+/* Maximum number of areas put separately per frame, the next ones are joined */
+#define X11_SHM_MAX_AREAS 16
+
+/* Number of key events queued between two reads of the keyboard, power of 2 */
+#define X11_KEY_QUEUE_SIZE 16
+
+/* The title of the window */
+#define X11_WINDOW_TITLE "LVGL simulator"
+
 /**********************
  *      TYPEDEFS
  **********************/
 
+/* A key pressed or released */
+typedef struct {
+    uint32_t key;
+    bool pressed;
+} x11_key_t;
+
+/* The window of the MIT-SHM flush path
+ * LVGL renders directly into an image shared with the X server, the
+ * rendered areas are put with XShmPutImage. The backend creates the
+ * window and reads its input events on the same connection as the
+ * completion events of the puts */
+typedef struct {
+    lv_display_t *disp;
+    Display *display;
+    Window window;
+    GC gc;
+    XImage *image;
+    XShmSegmentInfo shminfo;
+    int completion_type;
+    Atom wm_delete;
+    bool attached;
+    bool pending;                         /* The last put has not completed */
+    lv_area_t areas[X11_SHM_MAX_AREAS];   /* The areas flushed in the current frame */
+    uint32_t area_count;
+    lv_indev_t *pointer;
+    lv_indev_t *wheel;
+    lv_indev_t *keyboard;
+    lv_point_t point;
+    bool pressed;
+    int16_t wheel_diff;                   /* Steps of the wheel since the last read */
+    bool wheel_pressed;
+    x11_key_t keys[X11_KEY_QUEUE_SIZE];
+    uint32_t key_head;
+    uint32_t key_tail;
+    x11_key_t last_key;                   /* The last key returned to LVGL */
+} x11_shm_t;
+
 /**********************
  *  EXTERNAL VARIABLES
  **********************/
@@ -43,13 +99,31 @@ extern simulator_settings_t settings;
  *  STATIC PROTOTYPES
  **********************/
 static lv_display_t *init_x11(void);
-static void run_loop_x11(void);
+static lv_display_t *init_shm(void);
+static int create_window(int32_t hor_res, int32_t ver_res);
+static void create_inputs(void);
+static void release_shm(void);
+static int shm_error_handler(Display *display, XErrorEvent *event);
+static void flush_shm_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map);
+static void flush_wait_shm_cb(lv_display_t *disp);
+static void put_area(const lv_area_t *area);
+static void handle_shm_event(XEvent *event);
+static void handle_button(const XButtonEvent *event, bool pressed);
+static void handle_key(XKeyEvent *event, bool pressed);
+static void shm_fd_ready_cb(int fd, uint32_t events, void *user_data);
+static void pointer_read_cb(lv_indev_t *indev, lv_indev_data_t *data);
+static void wheel_read_cb(lv_indev_t *indev, lv_indev_data_t *data);
+static void keyboard_read_cb(lv_indev_t *indev, lv_indev_data_t *data);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
 static char *backend_name = "X11";
 
+static x11_shm_t shm;
+
+static bool shm_failed;
+
 /**********************
  *      MACROS
  **********************/
@@ -72,7 +146,10 @@ int backend_init_x11(backend_t *backend)
 
     backend->name = backend_name;
     backend->handle->display->init_display = init_x11;
-    backend->handle->display->run_loop = run_loop_x11;
+    backend->handle->display->run_loop = NULL;
+    backend->handle->display->timer_handler = NULL;
+    backend->handle->display->init_cursor = NULL;
+    backend->handle->display->main_thread = false;
     backend->type = BACKEND_DISPLAY;
 
     return 0;
@@ -85,6 +162,8 @@ int backend_init_x11(backend_t *backend)
 /**
  * Initialize the X11 display driver
  *
+ * @description the window is created by the backend when the pixels
+ * can be shared with the X server, otherwise by the LVGL driver
  * @return the LVGL display
  */
 static lv_display_t *init_x11(void)
@@ -92,8 +171,19 @@ static lv_display_t *init_x11(void)
     lv_display_t *disp;
     LV_IMG_DECLARE(mouse_cursor_icon);
 
-    disp = lv_x11_window_create("LVGL simulator",
-           settings.window_width , settings.window_height);
+    display_buffers_warn_unsupported(backend_name);
+
+    if (atoi(getenv_default("LV_LINUX_X11_SHM", "1"))) {
+        disp = init_shm();
+
+        if (disp != NULL) {
+            return disp;
+        }
+
+        LV_LOG_WARN("MIT-SHM unavailable - the pixels are sent over the X connection");
+    }
+
+    disp = lv_x11_window_create(X11_WINDOW_TITLE, settings.window_width , settings.window_height);
 
     disp = lv_display_get_default();
 
@@ -107,18 +197,543 @@ static lv_display_t *init_x11(void)
 }
 
 /**
- * The run loop of the X11 driver
+ * Create a window flushed through an image shared with the X server
+ *
+ * @description LVGL renders into a MIT-SHM image in DIRECT mode, the X
+ * server copies the rendered areas to the window without transferring
+ * the pixels over the socket. The next frame is rendered only once the
+ * server reports that the previous put has completed.
+ * Only works with a local server and a 24-bit visual
+ *
+ * @return the LVGL display, NULL on error
+ */
+static lv_display_t *init_shm(void)
+{
+    int screen;
+    XErrorHandler old_handler;
+    int32_t hor_res = settings.window_width;
+    int32_t ver_res = settings.window_height;
+
+    memset(&shm, 0, sizeof(shm));
+    shm.shminfo.shmid = -1;
+    shm.display = XOpenDisplay(NULL);
+
+    if (shm.display == NULL) {
+        return NULL;
+    }
+
+    screen = DefaultScreen(shm.display);
+
+    if (!XShmQueryExtension(shm.display) || DefaultDepth(shm.display, screen) != 24) {
+        goto err;
+    }
+
+    shm.image = XShmCreateImage(shm.display, DefaultVisual(shm.display, screen), 24, ZPixmap,
+                                NULL, &shm.shminfo, hor_res, ver_res);
+
+    if (shm.image == NULL || shm.image->bits_per_pixel != 32) {
+        goto err;
+    }
+
+    shm.shminfo.shmid = shmget(IPC_PRIVATE, shm.image->bytes_per_line * ver_res, IPC_CREAT | 0600);
+
+    if (shm.shminfo.shmid == -1) {
+        goto err;
+    }
+
+    shm.shminfo.shmaddr = shmat(shm.shminfo.shmid, NULL, 0);
+
+    if (shm.shminfo.shmaddr == (char *)-1) {
+        shm.shminfo.shmaddr = NULL;
+        goto err;
+    }
+
+    shm.image->data = shm.shminfo.shmaddr;
+    shm.shminfo.readOnly = True;
+
+    /* Attaching fails if the server is not on the same machine */
+    shm_failed = false;
+    old_handler = XSetErrorHandler(shm_error_handler);
+    XShmAttach(shm.display, &shm.shminfo);
+    XSync(shm.display, False);
+    XSetErrorHandler(old_handler);
+
+    if (shm_failed) {
+        goto err;
+    }
+
+    shm.attached = true;
+
+    /* The segment is destroyed once both processes have detached it */
+    shmctl(shm.shminfo.shmid, IPC_RMID, NULL);
+
+    memset(shm.image->data, 0, shm.image->bytes_per_line * ver_res);
+    shm.completion_type = XShmGetEventBase(shm.display) + ShmCompletion;
+
+    if (create_window(hor_res, ver_res) == -1) {
+        goto err;
+    }
+
+    if (driver_backends_watch_fd(ConnectionNumber(shm.display), EPOLLIN,
+                                 shm_fd_ready_cb, NULL) == -1) {
+        goto err;
+    }
+
+    shm.disp = lv_display_create(hor_res, ver_res);
+
+    if (shm.disp == NULL) {
+        driver_backends_unwatch_fd(ConnectionNumber(shm.display));
+        goto err;
+    }
+
+    lv_display_set_color_format(shm.disp, LV_COLOR_FORMAT_XRGB8888);
+    lv_display_set_buffers_with_stride(shm.disp, shm.image->data, NULL,
+                                       shm.image->bytes_per_line * ver_res,
+                                       shm.image->bytes_per_line, LV_DISPLAY_RENDER_MODE_DIRECT);
+    lv_display_set_flush_cb(shm.disp, flush_shm_cb);
+    lv_display_set_flush_wait_cb(shm.disp, flush_wait_shm_cb);
+
+    create_inputs();
+
+    LV_LOG_INFO("Flushing through MIT-SHM (%dx%d)", hor_res, ver_res);
+    return shm.disp;
+
+err:
+    release_shm();
+    return NULL;
+}
+
+/**
+ * Create and map the window of the shared image
+ *
+ * @description the window can't be resized, closing it exits the program
+ * @param hor_res the width of the window
+ * @param ver_res the height of the window
+ * @return 0 on success, -1 on error
+ */
+static int create_window(int32_t hor_res, int32_t ver_res)
+{
+    int screen = DefaultScreen(shm.display);
+    XSizeHints *hints;
+
+    shm.window = XCreateSimpleWindow(shm.display, RootWindow(shm.display, screen), 0, 0,
+                                     hor_res, ver_res, 0, BlackPixel(shm.display, screen),
+                                     BlackPixel(shm.display, screen));
+
+    if (shm.window == None) {
+        return -1;
+    }
+
+    hints = XAllocSizeHints();
+
+    if (hints != NULL) {
+        hints->flags = PMinSize | PMaxSize;
+        hints->min_width = hints->max_width = hor_res;
+        hints->min_height = hints->max_height = ver_res;
+        XSetWMNormalHints(shm.display, shm.window, hints);
+        XFree(hints);
+    }
+
+    XStoreName(shm.display, shm.window, X11_WINDOW_TITLE);
+
+    shm.wm_delete = XInternAtom(shm.display, "WM_DELETE_WINDOW", False);
+    XSetWMProtocols(shm.display, shm.window, &shm.wm_delete, 1);
+
+    XSelectInput(shm.display, shm.window, ExposureMask | PointerMotionMask |
+                 ButtonPressMask | ButtonReleaseMask | KeyPressMask | KeyReleaseMask);
+
+    shm.gc = XCreateGC(shm.display, shm.window, 0, NULL);
+    XMapWindow(shm.display, shm.window);
+    XFlush(shm.display);
+
+    return 0;
+}
+
+/**
+ * Create the input devices of the window
+ *
+ * @description a pointer for the mouse, an encoder for the wheel and a
+ * keypad for the keyboard, the last two are added to a default group
+ */
+static void create_inputs(void)
+{
+    lv_group_t *g;
+
+    shm.pointer = lv_indev_create();
+    lv_indev_set_type(shm.pointer, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_read_cb(shm.pointer, pointer_read_cb);
+    lv_indev_set_display(shm.pointer, shm.disp);
+
+    shm.wheel = lv_indev_create();
+    lv_indev_set_type(shm.wheel, LV_INDEV_TYPE_ENCODER);
+    lv_indev_set_read_cb(shm.wheel, wheel_read_cb);
+    lv_indev_set_display(shm.wheel, shm.disp);
+
+    shm.keyboard = lv_indev_create();
+    lv_indev_set_type(shm.keyboard, LV_INDEV_TYPE_KEYPAD);
+    lv_indev_set_read_cb(shm.keyboard, keyboard_read_cb);
+    lv_indev_set_display(shm.keyboard, shm.disp);
+
+    g = lv_group_create();
+    lv_group_set_default(g);
+    lv_indev_set_group(shm.wheel, g);
+    lv_indev_set_group(shm.keyboard, g);
+}
+
+/**
+ * Release the shared image and close the connection
+ *
+ * @description can be called when it was partially set up
+ */
+static void release_shm(void)
+{
+    if (shm.gc != NULL) {
+        XFreeGC(shm.display, shm.gc);
+    }
+
+    if (shm.window != None) {
+        XDestroyWindow(shm.display, shm.window);
+    }
+
+    if (shm.attached) {
+        XShmDetach(shm.display, &shm.shminfo);
+    }
+
+    if (shm.image != NULL) {
+        /* The data is not owned by the image */
+        shm.image->data = NULL;
+        XDestroyImage(shm.image);
+    }
+
+    if (shm.shminfo.shmaddr != NULL) {
+        shmdt(shm.shminfo.shmaddr);
+    }
+
+    if (shm.shminfo.shmid != -1) {
+        shmctl(shm.shminfo.shmid, IPC_RMID, NULL);
+    }
+
+    if (shm.display != NULL) {
+        XCloseDisplay(shm.display);
+    }
+
+    memset(&shm, 0, sizeof(shm));
+}
+
+/**
+ * Record the failure of XShmAttach
+ *
+ * @note called by Xlib
+ */
+static int shm_error_handler(Display *display, XErrorEvent *event)
+{
+    LV_UNUSED(display);
+    LV_UNUSED(event);
+
+    shm_failed = true;
+    return 0;
+}
+
+/**
+ * Put the rendered areas to the window
+ *
+ * @description the areas are put once the last one of the frame is
+ * rendered, flush_ready is called when the completion event of the last
+ * put is received
+ * @note called by LVGL
+ */
+static void flush_shm_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    uint32_t i;
+    lv_area_t *a;
+
+    LV_UNUSED(px_map);
+
+    if (shm.area_count < X11_SHM_MAX_AREAS) {
+        shm.areas[shm.area_count++] = *area;
+    } else {
+        a = &shm.areas[X11_SHM_MAX_AREAS - 1];
+        lv_area_join(a, a, area);
+    }
+
+    if (!lv_display_flush_is_last(disp)) {
+        lv_display_flush_ready(disp);
+        return;
+    }
+
+    for (i = 0; i < shm.area_count; i++) {
+        a = &shm.areas[i];
+        XShmPutImage(shm.display, shm.window, shm.gc, shm.image, a->x1, a->y1, a->x1, a->y1,
+                     lv_area_get_width(a), lv_area_get_height(a), i + 1 == shm.area_count);
+    }
+
+    XFlush(shm.display);
+
+    shm.area_count = 0;
+    shm.pending = true;
+}
+
+/**
+ * Wait until the server has copied the shared image
+ *
+ * @description LVGL is about to render into the shared image
+ * @note called by LVGL
+ */
+static void flush_wait_shm_cb(lv_display_t *disp)
+{
+    XEvent event;
+
+    LV_UNUSED(disp);
+
+    while (shm.pending) {
+        XNextEvent(shm.display, &event);
+        handle_shm_event(&event);
+    }
+}
+
+/**
+ * Put an area of the last frame to the window
+ *
+ * @description the shared image isn't rendered into while the events
+ * are handled, it always holds the last frame
+ * @param area the area, clipped to the window
+ */
+static void put_area(const lv_area_t *area)
+{
+    lv_area_t a;
+    lv_area_t screen;
+
+    lv_area_set(&screen, 0, 0, shm.image->width - 1, shm.image->height - 1);
+
+    if (!lv_area_intersect(&a, area, &screen)) {
+        return;
+    }
+
+    XShmPutImage(shm.display, shm.window, shm.gc, shm.image, a.x1, a.y1, a.x1, a.y1,
+                 lv_area_get_width(&a), lv_area_get_height(&a), False);
+    XFlush(shm.display);
+}
+
+/**
+ * Handle an event of the window
+ *
+ * @param event the event
+ */
+static void handle_shm_event(XEvent *event)
+{
+    lv_area_t area;
+
+    if (event->type == shm.completion_type) {
+        if (shm.pending) {
+            shm.pending = false;
+            lv_display_flush_ready(shm.disp);
+        }
+        return;
+    }
+
+    switch (event->type) {
+    case Expose:
+        lv_area_set(&area, event->xexpose.x, event->xexpose.y,
+                    event->xexpose.x + event->xexpose.width - 1,
+                    event->xexpose.y + event->xexpose.height - 1);
+        put_area(&area);
+        break;
+    case MotionNotify:
+        shm.point.x = LV_CLAMP(0, event->xmotion.x, shm.image->width - 1);
+        shm.point.y = LV_CLAMP(0, event->xmotion.y, shm.image->height - 1);
+        lv_timer_ready(lv_indev_get_read_timer(shm.pointer));
+        break;
+    case ButtonPress:
+    case ButtonRelease:
+        handle_button(&event->xbutton, event->type == ButtonPress);
+        break;
+    case KeyPress:
+    case KeyRelease:
+        handle_key(&event->xkey, event->type == KeyPress);
+        break;
+    case ClientMessage:
+        if ((Atom)event->xclient.data.l[0] == shm.wm_delete) {
+            /* The atexit handlers run */
+            exit(EXIT_SUCCESS);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Handle a button of the mouse
+ *
+ * @description the left button presses the pointer, the wheel
+ * turns and presses the encoder
+ * @param event the event
+ * @param pressed the button was pressed, otherwise released
+ */
+static void handle_button(const XButtonEvent *event, bool pressed)
+{
+    switch (event->button) {
+    case Button1:
+        shm.pressed = pressed;
+        shm.point.x = LV_CLAMP(0, event->x, shm.image->width - 1);
+        shm.point.y = LV_CLAMP(0, event->y, shm.image->height - 1);
+        lv_timer_ready(lv_indev_get_read_timer(shm.pointer));
+        break;
+    case Button2:
+        shm.wheel_pressed = pressed;
+        lv_timer_ready(lv_indev_get_read_timer(shm.wheel));
+        break;
+    case Button4:
+    case Button5:
+        /* A press and a release per step */
+        if (pressed) {
+            shm.wheel_diff += event->button == Button4 ? -1 : 1;
+            lv_timer_ready(lv_indev_get_read_timer(shm.wheel));
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Queue a key of the keyboard
+ *
+ * @description the key is dropped if LVGL lags too much behind
+ * @param event the event
+ * @param pressed the key was pressed, otherwise released
+ */
+static void handle_key(XKeyEvent *event, bool pressed)
+{
+    char c = 0;
+    KeySym sym;
+    x11_key_t *k;
+
+    XLookupString(event, &c, 1, &sym, NULL);
+
+    if (shm.key_head - shm.key_tail == X11_KEY_QUEUE_SIZE) {
+        return;
+    }
+
+    k = &shm.keys[shm.key_head & (X11_KEY_QUEUE_SIZE - 1)];
+    k->pressed = pressed;
+
+    switch (sym) {
+    case XK_Up:
+        k->key = LV_KEY_UP;
+        break;
+    case XK_Down:
+        k->key = LV_KEY_DOWN;
+        break;
+    case XK_Left:
+        k->key = LV_KEY_LEFT;
+        break;
+    case XK_Right:
+        k->key = LV_KEY_RIGHT;
+        break;
+    case XK_Escape:
+        k->key = LV_KEY_ESC;
+        break;
+    case XK_Delete:
+        k->key = LV_KEY_DEL;
+        break;
+    case XK_BackSpace:
+        k->key = LV_KEY_BACKSPACE;
+        break;
+    case XK_Return:
+        k->key = LV_KEY_ENTER;
+        break;
+    case XK_Tab:
+    case XK_Next:
+        k->key = LV_KEY_NEXT;
+        break;
+    case XK_ISO_Left_Tab:
+    case XK_Prior:
+        k->key = LV_KEY_PREV;
+        break;
+    case XK_Home:
+        k->key = LV_KEY_HOME;
+        break;
+    case XK_End:
+        k->key = LV_KEY_END;
+        break;
+    default:
+        if (c == 0) {
+            return;
+        }
+        k->key = (uint8_t)c;
+        break;
+    }
+
+    shm.key_head++;
+    lv_timer_ready(lv_indev_get_read_timer(shm.keyboard));
+}
+
+/**
+ * Handle the events of the window
+ *
+ * @note called by the run loop
  */
-void run_loop_x11(void)
+static void shm_fd_ready_cb(int fd, uint32_t events, void *user_data)
 {
-    uint32_t idle_time;
+    XEvent event;
+
+    LV_UNUSED(fd);
+    LV_UNUSED(events);
+    LV_UNUSED(user_data);
 
-    /* Handle LVGL tasks */
-    while (true) {
-        /* Returns the time to the next timer execution */
-        idle_time = lv_timer_handler();
-        usleep(idle_time * 1000);
+    while (XPending(shm.display)) {
+        XNextEvent(shm.display, &event);
+        handle_shm_event(&event);
     }
 }
 
+/**
+ * Read the mouse
+ *
+ * @note called by LVGL from the read timer of the indev
+ */
+static void pointer_read_cb(lv_indev_t *indev, lv_indev_data_t *data)
+{
+    LV_UNUSED(indev);
+
+    data->point = shm.point;
+    data->state = shm.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+}
+
+/**
+ * Read the mouse wheel
+ *
+ * @note called by LVGL from the read timer of the indev
+ */
+static void wheel_read_cb(lv_indev_t *indev, lv_indev_data_t *data)
+{
+    LV_UNUSED(indev);
+
+    data->enc_diff = shm.wheel_diff;
+    data->state = shm.wheel_pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+    shm.wheel_diff = 0;
+}
+
+/**
+ * Read the queued keys
+ *
+ * @description every key is handed to LVGL, continue_reading makes
+ * LVGL process the next one in the same read
+ * @note called by LVGL from the read timer of the indev
+ */
+static void keyboard_read_cb(lv_indev_t *indev, lv_indev_data_t *data)
+{
+    LV_UNUSED(indev);
+
+    if (shm.key_tail != shm.key_head) {
+        shm.last_key = shm.keys[shm.key_tail & (X11_KEY_QUEUE_SIZE - 1)];
+        shm.key_tail++;
+        data->continue_reading = shm.key_tail != shm.key_head;
+    }
+
+    data->key = shm.last_key.key;
+    data->state = shm.last_key.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+}
+
 #endif /*#if LV_USE_X11*/
@@ -0,0 +1,145 @@
+/**
+ * @file display_buffers.c
+ *
+ * Runtime configuration of the draw buffers of a display
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdbool.h>
+#include <stdint.h>
+#include <strings.h>
+
+#include "lvgl/lvgl.h"
+
+#include "simulator_settings.h"
+#include "display_buffers.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Default height of the PARTIAL buffers, as a fraction of the display */
+#define PARTIAL_BUFFER_DIVIDER 10
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  EXTERNAL VARIABLES
+ **********************/
+extern simulator_settings_t settings;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int display_buffers_parse_render_mode(const char *name)
+{
+    if (strcasecmp(name, "PARTIAL") == 0) {
+        return LV_DISPLAY_RENDER_MODE_PARTIAL;
+    } else if (strcasecmp(name, "DIRECT") == 0) {
+        return LV_DISPLAY_RENDER_MODE_DIRECT;
+    } else if (strcasecmp(name, "FULL") == 0) {
+        return LV_DISPLAY_RENDER_MODE_FULL;
+    }
+
+    return -1;
+}
+
+lv_color_format_t display_buffers_parse_color_format(const char *name)
+{
+    if (strcasecmp(name, "RGB565") == 0) {
+        return LV_COLOR_FORMAT_RGB565;
+    } else if (strcasecmp(name, "RGB888") == 0) {
+        return LV_COLOR_FORMAT_RGB888;
+    } else if (strcasecmp(name, "XRGB8888") == 0) {
+        return LV_COLOR_FORMAT_XRGB8888;
+    } else if (strcasecmp(name, "ARGB8888") == 0) {
+        return LV_COLOR_FORMAT_ARGB8888;
+    }
+
+    return LV_COLOR_FORMAT_UNKNOWN;
+}
+
+bool display_buffers_configured(void)
+{
+    return settings.render_mode != DISPLAY_BUFFERS_MODE_DEFAULT ||
+           settings.buffer_count != 0 || settings.buffer_lines != 0;
+}
+
+int display_buffers_setup(lv_display_t *disp, lv_display_render_mode_t default_mode)
+{
+    lv_display_render_mode_t mode = default_mode;
+    lv_color_format_t cf = lv_display_get_color_format(disp);
+    int32_t hor_res = lv_display_get_horizontal_resolution(disp);
+    int32_t ver_res = lv_display_get_vertical_resolution(disp);
+    int32_t lines = ver_res;
+    lv_draw_buf_t *buf1;
+    lv_draw_buf_t *buf2 = NULL;
+
+    if (settings.render_mode != DISPLAY_BUFFERS_MODE_DEFAULT) {
+        mode = settings.render_mode;
+    }
+
+    if (mode == LV_DISPLAY_RENDER_MODE_PARTIAL) {
+        lines = settings.buffer_lines != 0 ? (int32_t)settings.buffer_lines :
+                                             ver_res / PARTIAL_BUFFER_DIVIDER;
+        lines = LV_CLAMP(1, lines, ver_res);
+    } else if (settings.buffer_lines != 0) {
+        LV_LOG_WARN("The buffer lines are only used in PARTIAL mode");
+    }
+
+    buf1 = lv_draw_buf_create(hor_res, lines, cf, 0);
+
+    if (buf1 == NULL) {
+        LV_LOG_ERROR("Failed to allocate the draw buffer");
+        return -1;
+    }
+
+    if (settings.buffer_count == 2) {
+        buf2 = lv_draw_buf_create(hor_res, lines, cf, 0);
+
+        if (buf2 == NULL) {
+            LV_LOG_ERROR("Failed to allocate the second draw buffer");
+            lv_draw_buf_destroy(buf1);
+            return -1;
+        }
+    }
+
+    lv_display_set_draw_buffers(disp, buf1, buf2);
+    lv_display_set_render_mode(disp, mode);
+
+    LV_LOG_INFO("%s mode, %d buffer(s) of %" LV_PRId32 " lines",
+                mode == LV_DISPLAY_RENDER_MODE_PARTIAL ? "PARTIAL" :
+                mode == LV_DISPLAY_RENDER_MODE_DIRECT ? "DIRECT" : "FULL",
+                buf2 != NULL ? 2 : 1, lines);
+
+    return 0;
+}
+
+void display_buffers_warn_unsupported(const char *backend_name)
+{
+    if (display_buffers_configured() || settings.color_format != LV_COLOR_FORMAT_UNKNOWN) {
+        LV_LOG_WARN("The %s driver is configured at compile time, "
+                    "ignoring the render mode, buffer and color format settings",
+                    backend_name);
+    }
+}
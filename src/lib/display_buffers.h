@@ -0,0 +1,91 @@
+/**
+ * @file display_buffers.h
+ *
+ * Runtime configuration of the draw buffers of a display
+ *
+ * The render mode, the number and the height of the draw buffers and
+ * the color format are selected with the simulator settings instead of
+ * the LV_LINUX_FBDEV_* / LV_WAYLAND_* compile time constants
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef DISPLAY_BUFFERS_H
+#define DISPLAY_BUFFERS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* The render mode of the backend is used */
+#define DISPLAY_BUFFERS_MODE_DEFAULT -1
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Parse the name of a render mode
+ * @param name PARTIAL, DIRECT or FULL
+ * @return the render mode, -1 if the name is invalid
+ */
+int display_buffers_parse_render_mode(const char *name);
+
+/**
+ * @brief Parse the name of a color format
+ * @param name RGB565, RGB888, XRGB8888 or ARGB8888
+ * @return the color format, LV_COLOR_FORMAT_UNKNOWN if not supported
+ */
+lv_color_format_t display_buffers_parse_color_format(const char *name);
+
+/**
+ * @brief Check if the draw buffers are configured by the settings
+ * @return true if the render mode or the buffer count or lines are set
+ */
+bool display_buffers_configured(void);
+
+/**
+ * @brief Allocate the draw buffers of a display according to the settings
+ * @description the color format of the display must be set beforehand.
+ * In PARTIAL mode the buffers are a tenth of the display high by default,
+ * in the other modes they cover the whole display. One buffer is
+ * allocated by default
+ *
+ * @param disp the display
+ * @param default_mode the render mode used if none is set
+ * @return 0 on success, -1 on error
+ */
+int display_buffers_setup(lv_display_t *disp, lv_display_render_mode_t default_mode);
+
+/**
+ * @brief Warn that the settings are not supported by a backend
+ * @description the driver of the backend is configured at compile time
+ * @param backend_name the name of the backend
+ */
+void display_buffers_warn_unsupported(const char *backend_name);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*DISPLAY_BUFFERS_H*/
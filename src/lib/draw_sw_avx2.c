@@ -0,0 +1,492 @@
+/**
+ * @file draw_sw_avx2.c
+ *
+ * AVX2 software draw kernels
+ *
+ * The kernels are compiled with the avx2 target attribute so the rest of
+ * the program doesn't require AVX2. The blending matches the scalar code
+ * of LVGL: (src * mix + dest * (255 - mix)) >> 8 per channel, the mix
+ * factors are computed in 16-bit lanes, 4 pixels at a time. The output is
+ * compared with the one of the scalar code by draw_sw_bench_run
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "lvgl/lvgl.h"
+#include "lvgl/src/draw/sw/blend/lv_draw_sw_blend_private.h"
+
+#include "simulator_util.h"
+#include "draw_sw_avx2.h"
+
+#if defined(__x86_64__) && LV_USE_DRAW_SW_ASM == LV_DRAW_SW_ASM_CUSTOM
+#include <immintrin.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* An area of XRGB8888 pixels to blend */
+typedef struct {
+    uint8_t *dest;
+    int32_t dest_stride;
+    int32_t w;
+    int32_t h;
+    const uint8_t *src;       /* XRGB8888 or ARGB8888 pixels, NULL to blend the color */
+    int32_t src_stride;
+    uint32_t color;
+    const lv_opa_t *mask;     /* NULL if not masked */
+    int32_t mask_stride;
+    lv_opa_t opa;
+    bool src_alpha;           /* Use the alpha channel of src */
+} blend_area_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static inline bool is_active(void);
+static void fill_32(uint8_t *dest, int32_t stride, int32_t w, int32_t h, uint32_t color);
+static int32_t fill_row_32(uint32_t *row, int32_t w, uint32_t color);
+static void fill_16(uint8_t *dest, int32_t stride, int32_t w, int32_t h, uint16_t color);
+static void blend(const blend_area_t *area);
+static inline uint32_t get_mix(const blend_area_t *area, const uint8_t *src,
+                               const lv_opa_t *mask, int32_t x);
+static inline void mix_px(const uint8_t *src, uint8_t *dest, uint32_t mix);
+static int32_t blend_row(const blend_area_t *area, uint8_t *dest,
+                         const uint8_t *src, const lv_opa_t *mask);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static bool enabled;
+
+/* The kernels are bypassed on this thread */
+static __thread bool scalar;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void draw_sw_avx2_init(void)
+{
+    __builtin_cpu_init();
+
+    enabled = __builtin_cpu_supports("avx2") &&
+              atoi(getenv_default("LV_SIM_DRAW_SW_AVX2", "1"));
+
+    LV_LOG_INFO("AVX2 draw kernels %s", enabled ? "enabled" : "disabled");
+}
+
+bool draw_sw_avx2_is_enabled(void)
+{
+    return enabled;
+}
+
+void draw_sw_avx2_set_scalar(bool value)
+{
+    scalar = value;
+}
+
+lv_result_t draw_sw_avx2_fill_xrgb8888(lv_draw_sw_blend_fill_dsc_t *dsc, uint32_t dest_px_size)
+{
+    if (!is_active() || dest_px_size != 4) {
+        return LV_RESULT_INVALID;
+    }
+
+    fill_32(dsc->dest_buf, dsc->dest_stride, dsc->dest_w, dsc->dest_h,
+            lv_color_to_u32(dsc->color));
+
+    return LV_RESULT_OK;
+}
+
+lv_result_t draw_sw_avx2_fill_argb8888(lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+    return draw_sw_avx2_fill_xrgb8888(dsc, 4);
+}
+
+lv_result_t draw_sw_avx2_fill_rgb565(lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+    if (!is_active()) {
+        return LV_RESULT_INVALID;
+    }
+
+    fill_16(dsc->dest_buf, dsc->dest_stride, dsc->dest_w, dsc->dest_h,
+            lv_color_to_u16(dsc->color));
+
+    return LV_RESULT_OK;
+}
+
+lv_result_t draw_sw_avx2_blend_color(lv_draw_sw_blend_fill_dsc_t *dsc, uint32_t dest_px_size)
+{
+    blend_area_t area;
+
+    if (!is_active() || dest_px_size != 4) {
+        return LV_RESULT_INVALID;
+    }
+
+    area.dest = dsc->dest_buf;
+    area.dest_stride = dsc->dest_stride;
+    area.w = dsc->dest_w;
+    area.h = dsc->dest_h;
+    area.src = NULL;
+    area.src_stride = 0;
+    area.color = lv_color_to_u32(dsc->color);
+    area.mask = dsc->mask_buf;
+    area.mask_stride = dsc->mask_stride;
+    area.opa = dsc->opa;
+    area.src_alpha = false;
+
+    blend(&area);
+
+    return LV_RESULT_OK;
+}
+
+lv_result_t draw_sw_avx2_blend_argb8888(lv_draw_sw_blend_image_dsc_t *dsc, uint32_t dest_px_size)
+{
+    blend_area_t area;
+
+    if (!is_active() || dest_px_size != 4) {
+        return LV_RESULT_INVALID;
+    }
+
+    area.dest = dsc->dest_buf;
+    area.dest_stride = dsc->dest_stride;
+    area.w = dsc->dest_w;
+    area.h = dsc->dest_h;
+    area.src = dsc->src_buf;
+    area.src_stride = dsc->src_stride;
+    area.color = 0;
+    area.mask = dsc->mask_buf;
+    area.mask_stride = dsc->mask_stride;
+    area.opa = dsc->opa;
+    area.src_alpha = true;
+
+    blend(&area);
+
+    return LV_RESULT_OK;
+}
+
+lv_result_t draw_sw_avx2_blend_xrgb8888(lv_draw_sw_blend_image_dsc_t *dsc,
+                                        uint32_t dest_px_size, uint32_t src_px_size)
+{
+    blend_area_t area;
+
+    if (!is_active() || dest_px_size != 4 || src_px_size != 4) {
+        return LV_RESULT_INVALID;
+    }
+
+    area.dest = dsc->dest_buf;
+    area.dest_stride = dsc->dest_stride;
+    area.w = dsc->dest_w;
+    area.h = dsc->dest_h;
+    area.src = dsc->src_buf;
+    area.src_stride = dsc->src_stride;
+    area.color = 0;
+    area.mask = dsc->mask_buf;
+    area.mask_stride = dsc->mask_stride;
+    area.opa = dsc->opa;
+    area.src_alpha = false;
+
+    blend(&area);
+
+    return LV_RESULT_OK;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Check if the kernels are used by the calling thread
+ *
+ * @return true if the kernels are enabled and not bypassed
+ */
+static inline bool is_active(void)
+{
+    return enabled && !scalar;
+}
+
+/**
+ * Fill an area of 32-bit pixels
+ *
+ * @param dest the first pixel of the area
+ * @param stride the length of a line in bytes
+ * @param w the width of the area in px
+ * @param h the height of the area in px
+ * @param color the color of the pixels
+ */
+static void fill_32(uint8_t *dest, int32_t stride, int32_t w, int32_t h, uint32_t color)
+{
+    int32_t x;
+    int32_t y;
+    uint32_t *row;
+
+    for (y = 0; y < h; y++) {
+        row = (uint32_t *)(dest + y * stride);
+
+        x = fill_row_32(row, w, color);
+
+        for (; x < w; x++) {
+            row[x] = color;
+        }
+    }
+}
+
+/**
+ * Fill a line of 32-bit pixels, 8 at a time
+ *
+ * @param row the first pixel of the line
+ * @param w the width of the line in px
+ * @param color the color of the pixels
+ * @return the number of pixels filled
+ */
+static int32_t AVX2_TARGET fill_row_32(uint32_t *row, int32_t w, uint32_t color)
+{
+    int32_t x;
+    __m256i c = _mm256_set1_epi32(color);
+
+    for (x = 0; x + 8 <= w; x += 8) {
+        _mm256_storeu_si256((__m256i *)(row + x), c);
+    }
+
+    return x;
+}
+
+/**
+ * Fill an area of 16-bit pixels
+ *
+ * @param dest the first pixel of the area
+ * @param stride the length of a line in bytes
+ * @param w the width of the area in px
+ * @param h the height of the area in px
+ * @param color the color of the pixels
+ */
+static void AVX2_TARGET fill_16(uint8_t *dest, int32_t stride, int32_t w, int32_t h,
+                                uint16_t color)
+{
+    int32_t x;
+    int32_t y;
+    uint16_t *row;
+    __m256i c = _mm256_set1_epi16(color);
+
+    for (y = 0; y < h; y++) {
+        row = (uint16_t *)(dest + y * stride);
+
+        for (x = 0; x + 16 <= w; x += 16) {
+            _mm256_storeu_si256((__m256i *)(row + x), c);
+        }
+
+        for (; x < w; x++) {
+            row[x] = color;
+        }
+    }
+}
+
+/**
+ * Blend an area of XRGB8888 pixels
+ *
+ * @description the pixels that don't fill a vector are blended
+ * with the scalar implementation
+ * @param area the area to blend
+ */
+static void blend(const blend_area_t *area)
+{
+    int32_t x;
+    int32_t y;
+    uint8_t *dest;
+    const uint8_t *src = NULL;
+    const lv_opa_t *mask = NULL;
+    uint8_t color[4];
+
+    memcpy(color, &area->color, sizeof(color));
+
+    for (y = 0; y < area->h; y++) {
+        dest = area->dest + y * area->dest_stride;
+
+        if (area->src != NULL) {
+            src = area->src + y * area->src_stride;
+        }
+
+        if (area->mask != NULL) {
+            mask = area->mask + y * area->mask_stride;
+        }
+
+        x = blend_row(area, dest, src, mask);
+
+        for (; x < area->w; x++) {
+            mix_px(src != NULL ? src + x * 4 : color, dest + x * 4, get_mix(area, src, mask, x));
+        }
+    }
+}
+
+/**
+ * Get the mix factor of a pixel
+ *
+ * @description combines the alpha channel of the source, the mask and
+ * the opacity the same way as LVGL, the three are mixed at once
+ * with LV_OPA_MIX3
+ */
+static inline uint32_t get_mix(const blend_area_t *area, const uint8_t *src,
+                               const lv_opa_t *mask, int32_t x)
+{
+    uint32_t mix = area->src_alpha ? src[x * 4 + 3] : LV_OPA_COVER;
+
+    if (area->src_alpha && mask != NULL && area->opa < LV_OPA_MAX) {
+        return LV_OPA_MIX3(mix, mask[x], area->opa);
+    }
+
+    if (mask != NULL) {
+        mix = area->src_alpha ? LV_OPA_MIX2(mix, mask[x]) : mask[x];
+    }
+
+    if (area->opa < LV_OPA_MAX) {
+        mix = area->src_alpha || mask != NULL ? LV_OPA_MIX2(mix, area->opa) : area->opa;
+    }
+
+    return mix;
+}
+
+/**
+ * Mix a pixel, the X channel of the destination is kept
+ *
+ * @description same as lv_color_24_24_mix
+ */
+static inline void mix_px(const uint8_t *src, uint8_t *dest, uint32_t mix)
+{
+    uint32_t mix_inv;
+
+    if (mix == 0) {
+        return;
+    }
+
+    if (mix >= LV_OPA_MAX) {
+        dest[0] = src[0];
+        dest[1] = src[1];
+        dest[2] = src[2];
+        return;
+    }
+
+    mix_inv = 255 - mix;
+    dest[0] = (src[0] * mix + dest[0] * mix_inv) >> 8;
+    dest[1] = (src[1] * mix + dest[1] * mix_inv) >> 8;
+    dest[2] = (src[2] * mix + dest[2] * mix_inv) >> 8;
+}
+
+/**
+ * Blend a line of pixels, 4 at a time
+ *
+ * @description the channels are widened to 16-bit lanes. The mix factor
+ * of the X channel is 0 so that it is kept, like mix_px the factors above
+ * LV_OPA_MAX replace the pixel and the factors of 0 keep it unchanged.
+ * The product of the alpha channel and the mask fits in 16 bits, its
+ * product with the opacity is shifted by 16 like LV_OPA_MIX3
+ *
+ * @param area the area to blend
+ * @param dest the first pixel of the line
+ * @param src the first source pixel of the line, NULL to blend the color
+ * @param mask the first mask value of the line, NULL if not masked
+ * @return the number of pixels blended
+ */
+static int32_t AVX2_TARGET blend_row(const blend_area_t *area, uint8_t *dest,
+                                     const uint8_t *src, const lv_opa_t *mask)
+{
+    int32_t x;
+    uint32_t mask4;
+    __m128i s;
+    __m128i d;
+    __m256i s16;
+    __m256i d16;
+    __m256i mix;
+    __m256i mix_inv;
+    __m256i m;
+    __m256i res;
+    const __m128i shuf_alpha = _mm_setr_epi8(3, 3, 3, -1, 7, 7, 7, -1,
+                                             11, 11, 11, -1, 15, 15, 15, -1);
+    const __m128i shuf_mask = _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1,
+                                            2, 2, 2, -1, 3, 3, 3, -1);
+    const __m256i cover = _mm256_set1_epi64x(0x000000ff00ff00ffLL);
+    const __m256i opa = _mm256_set1_epi64x(area->opa * 0x0000000100010001LL);
+    const __m256i full = _mm256_set1_epi16(256);
+    const __m256i max = _mm256_set1_epi16(LV_OPA_MAX - 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m128i color = _mm_set1_epi32(area->color);
+
+    for (x = 0; x + 4 <= area->w; x += 4) {
+        s = src != NULL ? _mm_loadu_si128((const __m128i *)(src + x * 4)) : color;
+        d = _mm_loadu_si128((const __m128i *)(dest + x * 4));
+
+        mix = area->src_alpha ? _mm256_cvtepu8_epi16(_mm_shuffle_epi8(s, shuf_alpha)) : cover;
+
+        if (mask != NULL) {
+            memcpy(&mask4, mask + x, sizeof(mask4));
+            m = _mm256_cvtepu8_epi16(_mm_shuffle_epi8(_mm_cvtsi32_si128(mask4), shuf_mask));
+        }
+
+        if (area->src_alpha && mask != NULL) {
+            mix = _mm256_mullo_epi16(mix, m);
+            mix = area->opa < LV_OPA_MAX ? _mm256_mulhi_epu16(mix, opa) : _mm256_srli_epi16(mix, 8);
+        } else {
+            if (mask != NULL) {
+                mix = m;
+            }
+
+            if (area->opa < LV_OPA_MAX) {
+                mix = area->src_alpha || mask != NULL ?
+                      _mm256_srli_epi16(_mm256_mullo_epi16(mix, opa), 8) : opa;
+            }
+        }
+
+        /* mix >= LV_OPA_MAX: 256 and 0, mix == 0: 0 and 256 */
+        mix_inv = _mm256_sub_epi16(cover, mix);
+        m = _mm256_cmpgt_epi16(mix, max);
+        mix = _mm256_blendv_epi8(mix, full, m);
+        mix_inv = _mm256_blendv_epi8(mix_inv, zero, m);
+        mix_inv = _mm256_blendv_epi8(mix_inv, full, _mm256_cmpeq_epi16(mix, zero));
+
+        s16 = _mm256_cvtepu8_epi16(s);
+        d16 = _mm256_cvtepu8_epi16(d);
+        res = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(s16, mix),
+                                                 _mm256_mullo_epi16(d16, mix_inv)), 8);
+
+        _mm_storeu_si128((__m128i *)(dest + x * 4),
+                         _mm_packus_epi16(_mm256_castsi256_si128(res),
+                                          _mm256_extracti128_si256(res, 1)));
+    }
+
+    return x;
+}
+
+#else
+
+void draw_sw_avx2_init(void)
+{
+}
+
+bool draw_sw_avx2_is_enabled(void)
+{
+    return false;
+}
+
+void draw_sw_avx2_set_scalar(bool value)
+{
+    LV_UNUSED(value);
+}
+
+#endif /*defined(__x86_64__) && LV_USE_DRAW_SW_ASM == LV_DRAW_SW_ASM_CUSTOM*/
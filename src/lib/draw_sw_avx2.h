@@ -0,0 +1,124 @@
+/**
+ * @file draw_sw_avx2.h
+ *
+ * AVX2 software draw kernels
+ *
+ * Blend kernels for the XRGB8888 destinations of the LVGL software
+ * renderer, enabled with LV_LINUX_DRAW_SW_ASM=AVX2 which sets this file
+ * as LV_DRAW_SW_ASM_CUSTOM_INCLUDE. The CPU features are detected at
+ * runtime, LVGL falls back to its scalar code if AVX2 is not supported
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef DRAW_SW_AVX2_H
+#define DRAW_SW_AVX2_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Detect the CPU features and enable the kernels
+ * @description must be called after lv_init, the kernels stay disabled
+ * if the CPU doesn't support AVX2 or LV_SIM_DRAW_SW_AVX2 is set to 0.
+ * Does nothing if the kernels are not built
+ */
+void draw_sw_avx2_init(void);
+
+/**
+ * @brief Check if the kernels are used
+ * @return true if draw_sw_avx2_init enabled them
+ */
+bool draw_sw_avx2_is_enabled(void);
+
+/**
+ * @brief Bypass the kernels on the calling thread
+ * @description the blend functions of LVGL called by the thread fall
+ * back to their scalar code, i.e. to compare them with the kernels
+ * @param scalar true to bypass the kernels, false to use them again
+ */
+void draw_sw_avx2_set_scalar(bool scalar);
+
+/* The blend functions of LVGL include this file after the blend descriptors */
+#ifdef LV_DRAW_SW_BLEND_PRIVATE_H
+
+lv_result_t draw_sw_avx2_fill_xrgb8888(lv_draw_sw_blend_fill_dsc_t *dsc, uint32_t dest_px_size);
+lv_result_t draw_sw_avx2_fill_argb8888(lv_draw_sw_blend_fill_dsc_t *dsc);
+lv_result_t draw_sw_avx2_fill_rgb565(lv_draw_sw_blend_fill_dsc_t *dsc);
+lv_result_t draw_sw_avx2_blend_color(lv_draw_sw_blend_fill_dsc_t *dsc, uint32_t dest_px_size);
+lv_result_t draw_sw_avx2_blend_argb8888(lv_draw_sw_blend_image_dsc_t *dsc, uint32_t dest_px_size);
+lv_result_t draw_sw_avx2_blend_xrgb8888(lv_draw_sw_blend_image_dsc_t *dsc,
+                                        uint32_t dest_px_size, uint32_t src_px_size);
+
+/**********************
+ *      MACROS
+ **********************/
+
+/* Color fills, XRGB8888 destinations are handled by the RGB888 blend functions */
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB565(dsc) \
+    draw_sw_avx2_fill_rgb565(dsc)
+
+#define LV_DRAW_SW_COLOR_BLEND_TO_ARGB8888(dsc) \
+    draw_sw_avx2_fill_argb8888(dsc)
+
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB888(dsc, dest_px_size) \
+    draw_sw_avx2_fill_xrgb8888(dsc, dest_px_size)
+
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB888_WITH_OPA(dsc, dest_px_size) \
+    draw_sw_avx2_blend_color(dsc, dest_px_size)
+
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB888_WITH_MASK(dsc, dest_px_size) \
+    draw_sw_avx2_blend_color(dsc, dest_px_size)
+
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB888_MIX_MASK_OPA(dsc, dest_px_size) \
+    draw_sw_avx2_blend_color(dsc, dest_px_size)
+
+/* Images, copies without opacity nor mask are left to lv_memcpy */
+#define LV_DRAW_SW_ARGB8888_BLEND_NORMAL_TO_RGB888(dsc, dest_px_size) \
+    draw_sw_avx2_blend_argb8888(dsc, dest_px_size)
+
+#define LV_DRAW_SW_ARGB8888_BLEND_NORMAL_TO_RGB888_WITH_OPA(dsc, dest_px_size) \
+    draw_sw_avx2_blend_argb8888(dsc, dest_px_size)
+
+#define LV_DRAW_SW_ARGB8888_BLEND_NORMAL_TO_RGB888_WITH_MASK(dsc, dest_px_size) \
+    draw_sw_avx2_blend_argb8888(dsc, dest_px_size)
+
+#define LV_DRAW_SW_ARGB8888_BLEND_NORMAL_TO_RGB888_MIX_MASK_OPA(dsc, dest_px_size) \
+    draw_sw_avx2_blend_argb8888(dsc, dest_px_size)
+
+#define LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB888_WITH_OPA(dsc, dest_px_size, src_px_size) \
+    draw_sw_avx2_blend_xrgb8888(dsc, dest_px_size, src_px_size)
+
+#define LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB888_WITH_MASK(dsc, dest_px_size, src_px_size) \
+    draw_sw_avx2_blend_xrgb8888(dsc, dest_px_size, src_px_size)
+
+#define LV_DRAW_SW_RGB888_BLEND_NORMAL_TO_RGB888_MIX_MASK_OPA(dsc, dest_px_size, src_px_size) \
+    draw_sw_avx2_blend_xrgb8888(dsc, dest_px_size, src_px_size)
+
+#endif /*LV_DRAW_SW_BLEND_PRIVATE_H*/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*DRAW_SW_AVX2_H*/
@@ -0,0 +1,232 @@
+/**
+ * @file draw_sw_bench.c
+ *
+ * Benchmark of the software blend kernels
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "lvgl/lvgl.h"
+#include "lvgl/src/draw/sw/blend/lv_draw_sw_blend_private.h"
+#include "lvgl/src/draw/sw/blend/lv_draw_sw_blend_to_rgb888.h"
+
+#include "simulator_util.h"
+#include "draw_sw_avx2.h"
+#include "draw_sw_bench.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Size of the area blended by the benchmark */
+#define BENCH_WIDTH 800
+#define BENCH_HEIGHT 480
+#define BENCH_ITERATIONS 20
+
+/* Size of the XRGB8888 destination pixels */
+#define BENCH_PX_SIZE 4
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* A kernel measured by the benchmark */
+typedef struct {
+    const char *name;
+    bool image;
+    lv_color_format_t src_cf;
+    bool mask;
+    lv_opa_t opa;
+} bench_kernel_t;
+
+/* The buffers blended by the benchmark */
+typedef struct {
+    uint8_t *dest;
+    uint8_t *ref;       /* The destination blended by the scalar code */
+    uint8_t *init;      /* The initial content of the destination */
+    uint8_t *src;
+    lv_opa_t *mask;
+} bench_buffers_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void blend(const bench_kernel_t *kernel, const bench_buffers_t *buf, uint8_t *dest);
+static double measure(const bench_kernel_t *kernel, const bench_buffers_t *buf);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static const bench_kernel_t bench_kernels[] = {
+    { "fill",                false, LV_COLOR_FORMAT_UNKNOWN,  false, LV_OPA_COVER },
+    { "fill_opa",            false, LV_COLOR_FORMAT_UNKNOWN,  false, LV_OPA_50 },
+    { "fill_mask",           false, LV_COLOR_FORMAT_UNKNOWN,  true,  LV_OPA_COVER },
+    { "fill_mask_opa",       false, LV_COLOR_FORMAT_UNKNOWN,  true,  LV_OPA_50 },
+    { "image_argb8888",      true,  LV_COLOR_FORMAT_ARGB8888, false, LV_OPA_COVER },
+    { "image_argb8888_mask", true,  LV_COLOR_FORMAT_ARGB8888, true,  LV_OPA_COVER },
+    { "image_xrgb8888_opa",  true,  LV_COLOR_FORMAT_XRGB8888, false, LV_OPA_50 },
+    { "image_xrgb8888_mask", true,  LV_COLOR_FORMAT_XRGB8888, true,  LV_OPA_COVER },
+};
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+uint32_t draw_sw_bench_run(draw_sw_bench_result_t *results)
+{
+    uint32_t i;
+    uint32_t count = sizeof(bench_kernels) / sizeof(bench_kernels[0]);
+    size_t size = BENCH_WIDTH * BENCH_HEIGHT;
+    bench_buffers_t buf;
+
+    LV_ASSERT(count <= DRAW_SW_BENCH_MAX_KERNELS);
+
+    buf.dest = malloc(size * BENCH_PX_SIZE);
+    buf.ref = malloc(size * BENCH_PX_SIZE);
+    buf.init = malloc(size * BENCH_PX_SIZE);
+    buf.src = malloc(size * BENCH_PX_SIZE);
+    buf.mask = malloc(size);
+    LV_ASSERT_NULL(buf.dest);
+    LV_ASSERT_NULL(buf.ref);
+    LV_ASSERT_NULL(buf.init);
+    LV_ASSERT_NULL(buf.src);
+    LV_ASSERT_NULL(buf.mask);
+
+    /* Mix transparent, opaque and translucent pixels like antialiased edges */
+    srand(0);
+    for (i = 0; i < size * BENCH_PX_SIZE; i++) {
+        buf.src[i] = rand();
+        buf.init[i] = rand();
+    }
+
+    for (i = 0; i < size; i++) {
+        buf.mask[i] = i % 3 == 0 ? LV_OPA_TRANSP : i % 3 == 1 ? LV_OPA_COVER : rand();
+    }
+
+    for (i = 0; i < count; i++) {
+
+        results[i].name = bench_kernels[i].name;
+        results[i].scalar_ns = 0;
+        results[i].identical = true;
+
+        /* The kernels that can be disabled are compared with the scalar
+         * code, the same pixels are blended once by each implementation */
+        if (draw_sw_avx2_is_enabled()) {
+            draw_sw_avx2_set_scalar(true);
+            memcpy(buf.ref, buf.init, size * BENCH_PX_SIZE);
+            blend(&bench_kernels[i], &buf, buf.ref);
+            results[i].scalar_ns = measure(&bench_kernels[i], &buf);
+            draw_sw_avx2_set_scalar(false);
+
+            memcpy(buf.dest, buf.init, size * BENCH_PX_SIZE);
+            blend(&bench_kernels[i], &buf, buf.dest);
+            results[i].identical = memcmp(buf.ref, buf.dest, size * BENCH_PX_SIZE) == 0;
+        }
+
+        results[i].ns = measure(&bench_kernels[i], &buf);
+    }
+
+    free(buf.dest);
+    free(buf.ref);
+    free(buf.init);
+    free(buf.src);
+    free(buf.mask);
+
+    return count;
+}
+
+const char *draw_sw_bench_get_kernels(void)
+{
+#if LV_USE_DRAW_SW_ASM == LV_DRAW_SW_ASM_NEON
+    return "neon";
+#else
+    return draw_sw_avx2_is_enabled() ? "avx2" : "none";
+#endif
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Blend the whole area once with the blend functions of LVGL
+ *
+ * @param kernel the kernel
+ * @param buf the buffers
+ * @param dest the destination pixels
+ */
+static void blend(const bench_kernel_t *kernel, const bench_buffers_t *buf, uint8_t *dest)
+{
+    lv_draw_sw_blend_fill_dsc_t fill;
+    lv_draw_sw_blend_image_dsc_t image;
+
+    if (kernel->image) {
+        memset(&image, 0, sizeof(image));
+        image.dest_buf = dest;
+        image.dest_w = BENCH_WIDTH;
+        image.dest_h = BENCH_HEIGHT;
+        image.dest_stride = BENCH_WIDTH * BENCH_PX_SIZE;
+        image.mask_buf = kernel->mask ? buf->mask : NULL;
+        image.mask_stride = BENCH_WIDTH;
+        image.src_buf = buf->src;
+        image.src_stride = BENCH_WIDTH * BENCH_PX_SIZE;
+        image.src_color_format = kernel->src_cf;
+        image.opa = kernel->opa;
+        image.blend_mode = LV_BLEND_MODE_NORMAL;
+        lv_area_set(&image.relative_area, 0, 0, BENCH_WIDTH - 1, BENCH_HEIGHT - 1);
+        image.src_area = image.relative_area;
+
+        lv_draw_sw_blend_image_to_rgb888(&image, BENCH_PX_SIZE);
+    } else {
+        memset(&fill, 0, sizeof(fill));
+        fill.dest_buf = dest;
+        fill.dest_w = BENCH_WIDTH;
+        fill.dest_h = BENCH_HEIGHT;
+        fill.dest_stride = BENCH_WIDTH * BENCH_PX_SIZE;
+        fill.mask_buf = kernel->mask ? buf->mask : NULL;
+        fill.mask_stride = BENCH_WIDTH;
+        fill.color = lv_color_hex(0x3c78d8);
+        fill.opa = kernel->opa;
+        lv_area_set(&fill.relative_area, 0, 0, BENCH_WIDTH - 1, BENCH_HEIGHT - 1);
+
+        lv_draw_sw_blend_color_to_rgb888(&fill, BENCH_PX_SIZE);
+    }
+}
+
+/**
+ * Measure a kernel
+ *
+ * @param kernel the kernel
+ * @param buf the buffers
+ * @return the average time per pixel in ns, the reset of the
+ * destination between the iterations isn't counted
+ */
+static double measure(const bench_kernel_t *kernel, const bench_buffers_t *buf)
+{
+    uint32_t i;
+    uint64_t start;
+    uint64_t elapsed = 0;
+
+    for (i = 0; i < BENCH_ITERATIONS; i++) {
+        memcpy(buf->dest, buf->init, BENCH_WIDTH * BENCH_HEIGHT * BENCH_PX_SIZE);
+
+        start = get_time_us();
+        blend(kernel, buf, buf->dest);
+        elapsed += get_time_us() - start;
+    }
+
+    return elapsed * 1000.0 / ((double)BENCH_ITERATIONS * BENCH_WIDTH * BENCH_HEIGHT);
+}
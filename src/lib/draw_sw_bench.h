@@ -0,0 +1,75 @@
+/**
+ * @file draw_sw_bench.h
+ *
+ * Benchmark of the software blend kernels
+ *
+ * Times the blend functions of the LVGL software renderer for XRGB8888
+ * destinations, whichever SIMD kernels they are built with. With the AVX2
+ * kernels, which can be disabled at runtime, the scalar code of LVGL is
+ * measured as well and its output compared with the one of the kernels
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef DRAW_SW_BENCH_H
+#define DRAW_SW_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Maximum number of results of draw_sw_bench_run */
+#define DRAW_SW_BENCH_MAX_KERNELS 8
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* The result of a kernel benchmark */
+typedef struct {
+    const char *name;
+    double ns;           /* Time per pixel of the blend function of LVGL */
+    double scalar_ns;    /* Time per pixel of its scalar code, 0 if not measured */
+    bool identical;      /* The kernel and the scalar code produced the same pixels */
+} draw_sw_bench_result_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Measure the blend kernels
+ * @description each kernel blends a synthetic 800x480 area. Must be
+ * called from the LVGL thread while nothing is rendered
+ *
+ * @param results the results, at least DRAW_SW_BENCH_MAX_KERNELS
+ * @return the number of results
+ */
+uint32_t draw_sw_bench_run(draw_sw_bench_result_t *results);
+
+/**
+ * @brief Get the name of the kernels the blend functions use
+ * @return avx2, neon or none
+ */
+const char *draw_sw_bench_get_kernels(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*DRAW_SW_BENCH_H*/
@@ -18,12 +18,22 @@
 #include <stdbool.h>
 #include <string.h>
 #include <ctype.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 
 #include "lvgl/lvgl.h"
 
 #include "simulator_util.h"
 #include "simulator_settings.h"
 #include "driver_backends.h"
+#include "frame_stats.h"
+#include "dirty_regions.h"
+#include "thread_sched.h"
 
 #include "backends.h"
 
@@ -42,14 +52,55 @@
 #error Unsupported configuration - Please select at least one graphics backend in lv_conf.h
 #endif
 
+/* Maximum number of file descriptors the run loop can watch */
+#define RUN_LOOP_MAX_WATCHES 32
+
+/* Maximum number of display backends that can be used at the same time */
+#define MAX_DISPLAY_BACKENDS 4
+
+/* Period of the refresh timer of a display rendered by its own thread,
+ * the timer never expires */
+#define RENDER_THREAD_REFR_PERIOD UINT32_MAX
+
 /**********************
  *      TYPEDEFS
  **********************/
 
+/* A file descriptor watched by the run loop */
+typedef struct {
+    int fd;
+    driver_backends_fd_cb_t cb;
+    void *user_data;
+} fd_watch_t;
+
+/* A signal handled by the run loop */
+typedef struct {
+    driver_backends_signal_cb_t cb;
+    void *user_data;
+} signal_watch_t;
+
+/* A display refreshed by its own thread */
+typedef struct {
+    lv_display_t *display;
+    uint32_t period;        /* The refresh period in ms */
+    pthread_t thread;
+} render_thread_t;
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
 
+static int run_loop_setup(void);
+static void run_loop_arm_timer(uint32_t idle_time);
+static void run_loop_dispatch(int timeout);
+static void run_loop(void);
+static void signal_handler(int signum);
+static void signal_pipe_cb(int fd, uint32_t events, void *user_data);
+static void exit_signal_cb(int signum, void *user_data);
+static backend_t *find_display_backend(const char *backend_name);
+static display_backend_t *find_display(lv_display_t *display);
+static void *render_thread(void *arg);
+
 /**********************
  *  STATIC VARIABLES
  **********************/
@@ -84,6 +135,9 @@ backend_init_t available_backends[] = {
     backend_init_glfw3,
 #endif
 
+    backend_init_headless,
+    backend_init_rfb,
+
 #if LV_USE_EVDEV
     backend_init_evdev,
 #endif
@@ -93,9 +147,25 @@ backend_init_t available_backends[] = {
 /* Contains the backend descriptors */
 static backend_t *backends[sizeof(available_backends) / sizeof(available_backends[0])];
 
-/* Set once the user selects a backend - or it is set to the default backend */
+/* Set once the user selects a backend - or it is set to the default backend
+ * when several display backends are initialized, this is the first one */
 static backend_t *sel_display_backend = NULL;
 
+/* All the initialized display backends */
+static backend_t *sel_display_backends[MAX_DISPLAY_BACKENDS];
+static int sel_display_count;
+
+/* The epoll instance and timer the shared run loop blocks on */
+static int epoll_fd = -1;
+static int timer_fd = -1;
+
+/* Watched file descriptors, a slot is free when fd is -1 */
+static fd_watch_t fd_watches[RUN_LOOP_MAX_WATCHES];
+
+/* Signals are forwarded to the run loop through a pipe */
+static signal_watch_t signal_watches[NSIG];
+static int signal_pipe[2] = { -1, -1 };
+
 /**********************
  *  GLOBAL VARIABLES
  **********************/
@@ -141,6 +211,8 @@ void driver_backends_register(void)
 int driver_backends_init_backend(char *backend_name)
 {
     backend_t *b;
+    backend_t *disp_b;
+    const char *disp_name;
     int i;
     display_backend_t *dispb;
     indev_backend_t *indevb;
@@ -176,16 +248,54 @@ int driver_backends_init_backend(char *backend_name)
             if (b->type == BACKEND_DISPLAY) {
                 /* Initialize the display */
 
+                if (find_display_backend(b->name) != NULL) {
+                    LV_LOG_ERROR("The %s display backend is already initialized", b->name);
+                    return -1;
+                }
+
+                if (sel_display_count == MAX_DISPLAY_BACKENDS) {
+                    LV_LOG_ERROR("Too many display backends, max: %d", MAX_DISPLAY_BACKENDS);
+                    return -1;
+                }
+
                 dispb = b->handle->display;
                 LV_ASSERT_NULL(dispb->init_display);
+
+                /* Only the shared run loop drives several displays */
+                if (sel_display_count > 0 &&
+                    (dispb->run_loop != NULL ||
+                     sel_display_backend->handle->display->run_loop != NULL)) {
+                    LV_LOG_ERROR("The %s backend can't be combined with other display backends",
+                            dispb->run_loop != NULL ? b->name : sel_display_backend->name);
+                    return -1;
+                }
+
+                dispb->refr_period = LV_DEF_REFR_PERIOD;
+                dispb->refr_paced = false;
+
+                LV_PROFILER_BEGIN_TAG(b->name);
                 dispb->display = dispb->init_display();
+                LV_PROFILER_END_TAG(b->name);
 
                 if (dispb->display == NULL) {
                     LV_LOG_ERROR("Failed to init display with %s backend", b->name);
                     return -1;
                 }
 
-                sel_display_backend = b;
+                if (settings.frame_stats) {
+                    frame_stats_attach(dispb->display, b->name);
+                    frame_stats_enable_report();
+                }
+
+                if (settings.dirty_regions || settings.dirty_overlay) {
+                    dirty_regions_attach(dispb->display, b->name, settings.dirty_overlay);
+                }
+
+                if (sel_display_backend == NULL) {
+                    sel_display_backend = b;
+                }
+
+                sel_display_backends[sel_display_count++] = b;
                 LV_LOG_INFO("Initialized %s display backend", b->name);
                 break;
 
@@ -203,12 +313,29 @@ int driver_backends_init_backend(char *backend_name)
                     return -1;
                 }
 
+                /* Bind the input devices to the first display unless specified */
+                disp_name = getenv("LV_SIM_INDEV_DISPLAY");
+                disp_b = sel_display_backend;
+
+                if (disp_name != NULL) {
+
+                    disp_b = find_display_backend(disp_name);
+
+                    if (disp_b == NULL) {
+                        LV_LOG_ERROR("Failed to init indev backend: %s - %s is not initialized",
+                                b->name, disp_name);
+                        return -1;
+                    }
+                }
+
                 LV_LOG_INFO("Initialized %s indev backend", b->name);
 
-                dispb = sel_display_backend->handle->display;
+                dispb = disp_b->handle->display;
 
                 LV_ASSERT_NULL(dispb->display);
+                LV_PROFILER_BEGIN_TAG(b->name);
                 indevb->init_indev(dispb->display);
+                LV_PROFILER_END_TAG(b->name);
                 break;
             }
         }
@@ -218,6 +345,131 @@ int driver_backends_init_backend(char *backend_name)
     return 0;
 }
 
+lv_display_t *driver_backends_get_display(const char *backend_name)
+{
+    backend_t *b = find_display_backend(backend_name);
+
+    if (b == NULL) {
+        return NULL;
+    }
+
+    return b->handle->display->display;
+}
+
+void driver_backends_set_refr_period(lv_display_t *display, uint32_t period)
+{
+    display_backend_t *dispb = find_display(display);
+
+    LV_ASSERT_NULL(dispb);
+
+    if (dispb->refr_paced) {
+        LV_LOG_WARN("The frames of the display are requested by the backend, ignoring the period");
+        return;
+    }
+
+    lv_timer_set_period(lv_display_get_refr_timer(display), period);
+    dispb->refr_period = period;
+}
+
+bool driver_backends_get_refr_period(lv_display_t *display, uint32_t *period)
+{
+    display_backend_t *dispb = find_display(display);
+
+    if (dispb == NULL || dispb->refr_paced) {
+        return false;
+    }
+
+    *period = dispb->refr_period;
+    return true;
+}
+
+int driver_backends_start_render_thread(lv_display_t *display, uint32_t period)
+{
+#if LV_USE_OS != LV_OS_NONE
+    int i;
+    int ret;
+    render_thread_t *rt;
+    pthread_attr_t attr;
+    display_backend_t *dispb;
+
+    LV_ASSERT_NULL(display);
+
+    for (i = 0; i < sel_display_count; i++) {
+        if (sel_display_backends[i]->handle->display->display == display &&
+            sel_display_backends[i]->handle->display->main_thread) {
+            LV_LOG_ERROR("The %s backend can't be refreshed from its own thread",
+                         sel_display_backends[i]->name);
+            return -1;
+        }
+    }
+
+    dispb = find_display(display);
+    LV_ASSERT_NULL(dispb);
+
+    rt = malloc(sizeof(render_thread_t));
+    LV_ASSERT_NULL(rt);
+
+    rt->display = display;
+    rt->period = period;
+
+    lv_lock();
+    lv_timer_set_period(lv_display_get_refr_timer(display), RENDER_THREAD_REFR_PERIOD);
+    lv_unlock();
+
+    /* The configuration of the main role is applied explicitly, whatever
+     * the thread starting the render thread runs with */
+    thread_sched_init_helper_attr(&attr);
+    ret = pthread_create(&rt->thread, &attr, render_thread, rt);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0) {
+        LV_LOG_ERROR("Failed to create render thread: %s", strerror(ret));
+        lv_lock();
+        lv_timer_set_period(lv_display_get_refr_timer(display), dispb->refr_period);
+        lv_unlock();
+        free(rt);
+        return -1;
+    }
+
+    dispb->refr_paced = true;
+
+    thread_sched_apply(THREAD_SCHED_MAIN, rt->thread);
+
+    return 0;
+#else
+    LV_UNUSED(display);
+    LV_UNUSED(period);
+    LV_LOG_ERROR("Render threads require LV_USE_OS, see LV_LINUX_DRAW_THREADS");
+    return -1;
+#endif
+}
+
+int driver_backends_set_hw_cursor(lv_indev_t *indev, const lv_image_dsc_t *icon)
+{
+    int i;
+    display_backend_t *dispb;
+    lv_display_t *display = lv_indev_get_display(indev);
+
+    for (i = 0; i < sel_display_count; i++) {
+        dispb = sel_display_backends[i]->handle->display;
+
+        if (dispb->display == display && dispb->init_cursor != NULL) {
+            return dispb->init_cursor(indev, icon);
+        }
+    }
+
+    return -1;
+}
+
+const char *driver_backends_get_display_name(void)
+{
+    if (sel_display_backend == NULL) {
+        return NULL;
+    }
+
+    return sel_display_backend->name;
+}
+
 int driver_backends_print_supported(void)
 {
     int i;
@@ -271,14 +523,458 @@ void driver_backends_run_loop(void)
     if (sel_display_backend != NULL && sel_display_backend->handle->display != NULL) {
 
         dispb = sel_display_backend->handle->display;
-        dispb->run_loop();
+
+        /* Exit cleanly on SIGINT/SIGTERM so that the atexit handlers run */
+        if (signal_watches[SIGINT].cb == NULL) {
+            driver_backends_watch_signal(SIGINT, exit_signal_cb, NULL);
+        }
+
+        if (signal_watches[SIGTERM].cb == NULL) {
+            driver_backends_watch_signal(SIGTERM, exit_signal_cb, NULL);
+        }
+
+        if (dispb->run_loop != NULL) {
+            dispb->run_loop();
+        } else {
+            run_loop();
+        }
 
     } else {
         LV_LOG_ERROR("No backend has been selected - initialize the backend first");
     }
 }
 
+int driver_backends_watch_fd(int fd, uint32_t events,
+        driver_backends_fd_cb_t cb, void *user_data)
+{
+    int i;
+    struct epoll_event ev;
+    fd_watch_t *w = NULL;
+
+    LV_ASSERT_NULL(cb);
+
+    if (run_loop_setup() == -1) {
+        return -1;
+    }
+
+    for (i = 0; i < RUN_LOOP_MAX_WATCHES; i++) {
+        if (fd_watches[i].fd == -1) {
+            w = &fd_watches[i];
+            break;
+        }
+    }
+
+    if (w == NULL) {
+        LV_LOG_ERROR("Too many watched file descriptors, max: %d", RUN_LOOP_MAX_WATCHES);
+        return -1;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.ptr = w;
+
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        LV_LOG_ERROR("Failed to watch fd %d: %s", fd, strerror(errno));
+        return -1;
+    }
+
+    w->fd = fd;
+    w->cb = cb;
+    w->user_data = user_data;
+
+    return 0;
+}
+
+int driver_backends_watch_signal(int signum,
+        driver_backends_signal_cb_t cb, void *user_data)
+{
+    int i;
+    struct sigaction sa;
+
+    LV_ASSERT_NULL(cb);
+
+    if (signum <= 0 || signum >= NSIG) {
+        return -1;
+    }
+
+    if (signal_pipe[0] == -1) {
+
+        if (pipe(signal_pipe) == -1) {
+            LV_LOG_ERROR("Failed to create signal pipe: %s", strerror(errno));
+            return -1;
+        }
+
+        for (i = 0; i < 2; i++) {
+            fcntl(signal_pipe[i], F_SETFL, O_NONBLOCK);
+            fcntl(signal_pipe[i], F_SETFD, FD_CLOEXEC);
+        }
+
+        if (driver_backends_watch_fd(signal_pipe[0], EPOLLIN, signal_pipe_cb, NULL) == -1) {
+            close(signal_pipe[0]);
+            close(signal_pipe[1]);
+            signal_pipe[0] = -1;
+            signal_pipe[1] = -1;
+            return -1;
+        }
+    }
+
+    signal_watches[signum].cb = cb;
+    signal_watches[signum].user_data = user_data;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = signal_handler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+
+    if (sigaction(signum, &sa, NULL) == -1) {
+        LV_LOG_ERROR("Failed to install handler for signal %d: %s", signum, strerror(errno));
+        signal_watches[signum].cb = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+void driver_backends_dispatch_events(void)
+{
+    if (run_loop_setup() == -1) {
+        return;
+    }
+
+    run_loop_dispatch(0);
+}
+
+int driver_backends_unwatch_fd(int fd)
+{
+    int i;
+
+    if (epoll_fd == -1) {
+        return -1;
+    }
+
+    for (i = 0; i < RUN_LOOP_MAX_WATCHES; i++) {
+
+        if (fd_watches[i].fd == fd) {
+
+            /* The fd might already be closed, in that case it is
+             * removed from the epoll set by the kernel */
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            fd_watches[i].fd = -1;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
 
+/**
+ * Create the epoll instance and the timer of the run loop
+ *
+ * @description the timer is re-armed after each call to lv_timer_handler
+ * so that the run loop sleeps until either the next LVGL timer is due
+ * or one of the watched file descriptors becomes ready
+ * @return 0 on success, -1 on error
+ */
+static int run_loop_setup(void)
+{
+    int i;
+    struct epoll_event ev;
+
+    if (epoll_fd != -1) {
+        return 0;
+    }
+
+    for (i = 0; i < RUN_LOOP_MAX_WATCHES; i++) {
+        fd_watches[i].fd = -1;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (epoll_fd == -1) {
+        LV_LOG_ERROR("Failed to create epoll instance: %s", strerror(errno));
+        return -1;
+    }
+
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (timer_fd == -1) {
+        LV_LOG_ERROR("Failed to create timerfd: %s", strerror(errno));
+        close(epoll_fd);
+        epoll_fd = -1;
+        return -1;
+    }
+
+    /* The timer is identified by a NULL pointer */
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) == -1) {
+        LV_LOG_ERROR("Failed to watch timerfd: %s", strerror(errno));
+        close(timer_fd);
+        close(epoll_fd);
+        timer_fd = -1;
+        epoll_fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Arm the timer of the run loop
+ *
+ * @param idle_time the value returned by lv_timer_handler,
+ * LV_NO_TIMER_READY disarms the timer
+ */
+static void run_loop_arm_timer(uint32_t idle_time)
+{
+    struct itimerspec its;
+
+    memset(&its, 0, sizeof(its));
+
+    if (idle_time != LV_NO_TIMER_READY) {
+        its.it_value.tv_sec = idle_time / 1000;
+        its.it_value.tv_nsec = (long)(idle_time % 1000) * 1000000L;
+    }
+
+    timerfd_settime(timer_fd, 0, &its, NULL);
+}
+
+/**
+ * Wait for events and run the callbacks of the ready file descriptors
+ *
+ * @param timeout the maximum time to wait in ms, -1 to wait until
+ * the timer or a watched file descriptor wakes up the loop
+ */
+static void run_loop_dispatch(int timeout)
+{
+    int i;
+    int n;
+    uint64_t expirations;
+    fd_watch_t *w;
+    struct epoll_event events[RUN_LOOP_MAX_WATCHES];
+
+    n = epoll_wait(epoll_fd, events, RUN_LOOP_MAX_WATCHES, timeout);
+
+    if (n == -1) {
+        if (errno != EINTR) {
+            die("epoll_wait failed: %s\n", strerror(errno));
+        }
+        return;
+    }
+
+    for (i = 0; i < n; i++) {
+
+        w = events[i].data.ptr;
+
+        if (w == NULL) {
+            /* Acknowledge the timer expiration */
+            if (read(timer_fd, &expirations, sizeof(expirations)) == -1) {
+                LV_LOG_TRACE("timerfd read: %s", strerror(errno));
+            }
+            continue;
+        }
+
+        /* A previous callback may have removed the watch */
+        if (w->fd != -1) {
+#if LV_USE_OS != LV_OS_NONE
+            /* The callbacks use LVGL, the draw threads may run concurrently */
+            lv_lock();
+            w->cb(w->fd, events[i].events, w->user_data);
+            lv_unlock();
+#else
+            w->cb(w->fd, events[i].events, w->user_data);
+#endif
+        }
+    }
+}
+
+/**
+ * Find an initialized display backend
+ *
+ * @param backend_name the name of the backend
+ * @return the backend, NULL if no display backend with this name is initialized
+ */
+static backend_t *find_display_backend(const char *backend_name)
+{
+    int i;
+
+    for (i = 0; i < sel_display_count; i++) {
+        if (strcasecmp(sel_display_backends[i]->name, backend_name) == 0) {
+            return sel_display_backends[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Find the backend of a display
+ *
+ * @param display the LVGL display
+ * @return the display backend, NULL if the display wasn't created by a backend
+ */
+static display_backend_t *find_display(lv_display_t *display)
+{
+    int i;
+
+    for (i = 0; i < sel_display_count; i++) {
+        if (sel_display_backends[i]->handle->display->display == display) {
+            return sel_display_backends[i]->handle->display;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Refresh a display periodically
+ *
+ * @description the refresh timer of the display never expires, the thread
+ * renders the invalidated areas at its own pace instead. Rendering is
+ * serialized with the run loop by the LVGL lock
+ * @param arg the render thread descriptor
+ */
+static void *render_thread(void *arg)
+{
+    uint64_t start_us;
+    uint64_t elapsed_us;
+    render_thread_t *rt = arg;
+
+    while (true) {
+
+        start_us = get_time_us();
+
+        lv_lock();
+        lv_refr_now(rt->display);
+        lv_unlock();
+
+        elapsed_us = get_time_us() - start_us;
+
+        if (elapsed_us < rt->period * 1000ULL) {
+            usleep(rt->period * 1000ULL - elapsed_us);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Forward a signal to the run loop
+ *
+ * @note async-signal-safe, the callback is called later from the run loop
+ * @param signum the number of the received signal
+ */
+static void signal_handler(int signum)
+{
+    int saved_errno = errno;
+    unsigned char c = signum;
+
+    if (write(signal_pipe[1], &c, 1) == -1) {
+        /* The pipe is full - the signal is dropped */
+    }
+
+    errno = saved_errno;
+}
+
+/**
+ * Call the callbacks of the received signals
+ *
+ * @note called by the run loop
+ */
+static void signal_pipe_cb(int fd, uint32_t events, void *user_data)
+{
+    unsigned char signum;
+    signal_watch_t *sw;
+
+    LV_UNUSED(events);
+    LV_UNUSED(user_data);
+
+    while (read(fd, &signum, 1) == 1) {
+
+        sw = &signal_watches[signum];
+
+        if (sw->cb != NULL) {
+            sw->cb(signum, sw->user_data);
+        }
+    }
+}
+
+/**
+ * Exit the program
+ *
+ * @description the atexit handlers run, the exit status is the one of
+ * a process killed by the signal like the shells report it
+ * @note called by the run loop on SIGINT or SIGTERM
+ */
+static void exit_signal_cb(int signum, void *user_data)
+{
+    LV_UNUSED(user_data);
+
+    exit(128 + signum);
+}
+
+/**
+ * The shared run loop
+ *
+ * @description instead of sleeping for the time returned by lv_timer_handler
+ * the loop blocks in epoll until the next timer is due, or until a
+ * display or input device file descriptor becomes ready, this allows
+ * input events to be handled as soon as they arrive.
+ * The display backends can replace lv_timer_handler, i.e to read the
+ * events of their connection before the timers run. The handler of
+ * every selected backend is called, the loop sleeps until the earliest
+ * time they return
+ */
+static void run_loop(void)
+{
+    int i;
+    int handler_count = 0;
+    uint32_t idle_time;
+    uint32_t t;
+    timer_handler_t timer_handlers[MAX_DISPLAY_BACKENDS];
+
+    for (i = 0; i < sel_display_count; i++) {
+        if (sel_display_backends[i]->handle->display->timer_handler != NULL) {
+            timer_handlers[handler_count++] = sel_display_backends[i]->handle->display->timer_handler;
+        }
+    }
+
+    if (handler_count == 0) {
+        timer_handlers[handler_count++] = lv_timer_handler;
+    }
+
+    if (run_loop_setup() == -1) {
+        die("Failed to setup the run loop\n");
+    }
+
+    /* Handle LVGL tasks */
+    while (true) {
+
+        /* Returns the time to the next timer execution */
+        idle_time = LV_NO_TIMER_READY;
+
+        for (i = 0; i < handler_count; i++) {
+            t = timer_handlers[i]();
+            idle_time = LV_MIN(idle_time, t);
+        }
+
+        if (idle_time == 0) {
+            /* A timer is already due - only collect pending events */
+            run_loop_dispatch(0);
+            continue;
+        }
+
+        run_loop_arm_timer(idle_time);
+
+        LV_PROFILER_BEGIN_TAG("run_loop_wait");
+        run_loop_dispatch(-1);
+        LV_PROFILER_END_TAG("run_loop_wait");
+    }
+}
+
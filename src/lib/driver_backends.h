@@ -26,6 +26,10 @@ extern "C" {
 /*********************
  *      INCLUDES
  *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
 
 /*********************
  *      DEFINES
@@ -35,6 +39,12 @@ extern "C" {
  *      TYPEDEFS
  **********************/
 
+/* Prototype of the callback called when a watched file descriptor is ready */
+typedef void (*driver_backends_fd_cb_t)(int fd, uint32_t events, void *user_data);
+
+/* Prototype of the callback called when a watched signal is received */
+typedef void (*driver_backends_signal_cb_t)(int signum, void *user_data);
+
 /**********************
  * GLOBAL PROTOTYPES
  **********************/
@@ -52,6 +62,10 @@ void driver_backends_register(void);
  * - create the lv_display, in case of a indev driver backend
  * create an input device
  *
+ * Several display backends can be initialized, the input devices
+ * are bound to the first one, unless LV_SIM_INDEV_DISPLAY is set to
+ * the name of another display backend
+ *
  * @param backend_name the name of the backend to initialize FBDEV,DRM etc
  * @return 0 on success, -1 on error
  */
@@ -64,6 +78,63 @@ int driver_backends_init_backend(char *backend_name);
  */
 int driver_backends_is_supported(char *backend_name);
 
+/**
+ * @brief Get the display created by a display backend
+ * @param backend_name the name of the backend
+ * @return the display, NULL if the backend is not initialized
+ */
+lv_display_t *driver_backends_get_display(const char *backend_name);
+
+/**
+ * @brief Set the refresh period of a display
+ * @description ignored with a warning if the frames of the display are
+ * requested by the backend, i.e on vblank events
+ *
+ * @param display the display created by a backend
+ * @param period the refresh period in ms
+ */
+void driver_backends_set_refr_period(lv_display_t *display, uint32_t period);
+
+/**
+ * @brief Get the refresh period of a display
+ *
+ * @param display the display
+ * @param period set to the period of the refresh timer in ms
+ * @return false if the frames of the display are requested by the backend
+ * or a render thread, or if the display wasn't created by a backend
+ */
+bool driver_backends_get_refr_period(lv_display_t *display, uint32_t *period);
+
+/**
+ * @brief Refresh a display from a dedicated thread
+ * @description the display is no longer refreshed by the run loop,
+ * requires LV_USE_OS. Fails for the backends that must be refreshed by
+ * the thread that initialized them (GLFW3, SDL)
+ *
+ * @param display the display to refresh
+ * @param period the refresh period in ms
+ * @return 0 on success, -1 on error
+ */
+int driver_backends_start_render_thread(lv_display_t *display, uint32_t period);
+
+/**
+ * @brief Display the cursor of a pointer device on a hardware plane
+ * @description moving the cursor doesn't invalidate the display, the
+ * caller falls back to an LVGL cursor object if -1 is returned
+ *
+ * @param indev the pointer device, bound to its display
+ * @param icon the cursor image
+ * @return 0 on success, -1 if the display backend has no hardware cursor
+ */
+int driver_backends_set_hw_cursor(lv_indev_t *indev, const lv_image_dsc_t *icon);
+
+/**
+ * @brief Get the name of the initialized display backend
+ * @return the name of the first initialized display backend,
+ * NULL if no display backend is initialized
+ */
+const char *driver_backends_get_display_name(void);
+
 /**
  * @brief Print supported backends
  * @description Prints a list of supported backends
@@ -74,10 +145,54 @@ int driver_backends_print_supported(void);
 
 /**
  * @brief Enter the run loop
- * @description enter the run loop of the selected backend
+ * @description enter the run loop of the selected backend, if the backend
+ * doesn't provide its own run loop, the shared event driven run loop is used
  */
 void driver_backends_run_loop(void);
 
+/**
+ * @brief Watch a file descriptor from the shared run loop
+ * @description the run loop wakes up as soon as the file descriptor
+ * becomes ready and calls the callback from the LVGL thread
+ *
+ * @param fd the file descriptor to watch
+ * @param events the epoll events to wait for i.e EPOLLIN
+ * @param cb the callback to call when the file descriptor is ready
+ * @param user_data passed to the callback
+ * @return 0 on success, -1 on error
+ */
+int driver_backends_watch_fd(int fd, uint32_t events,
+        driver_backends_fd_cb_t cb, void *user_data);
+
+/**
+ * @brief Handle a signal from the shared run loop
+ * @description the callback is not called from the signal handler but
+ * from the LVGL thread, so it can safely use LVGL and stdio.
+ * By default SIGINT and SIGTERM exit the program with the status
+ * 128 + signum, so that the atexit handlers run
+ *
+ * @param signum the signal to handle i.e SIGUSR1
+ * @param cb the callback to call once the signal is received
+ * @param user_data passed to the callback
+ * @return 0 on success, -1 on error
+ */
+int driver_backends_watch_signal(int signum,
+        driver_backends_signal_cb_t cb, void *user_data);
+
+/**
+ * @brief Dispatch the events of the watched file descriptors
+ * @description does not block, meant for backends that provide
+ * their own run loop
+ */
+void driver_backends_dispatch_events(void);
+
+/**
+ * @brief Stop watching a file descriptor
+ * @param fd the file descriptor previously passed to driver_backends_watch_fd
+ * @return 0 on success, -1 if the file descriptor was not watched
+ */
+int driver_backends_unwatch_fd(int fd);
+
 /**********************
  *      MACROS
  **********************/
@@ -0,0 +1,813 @@
+/**
+ * @file frame_capture.c
+ *
+ * Asynchronous frame capture
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <signal.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "lvgl/lvgl.h"
+#if LV_USE_LODEPNG
+#include "lvgl/src/libs/lodepng/lodepng.h"
+#endif
+
+#include "driver_backends.h"
+#include "thread_sched.h"
+#include "frame_capture.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* The PNG encoder allocates with lv_malloc, which can only be called
+ * from the writer thread with the C library allocator or an OS layer */
+#if LV_USE_LODEPNG && defined(LODEPNG_COMPILE_ENCODER) && \
+    (LV_USE_STDLIB_MALLOC == LV_STDLIB_CLIB || LV_USE_OS != LV_OS_NONE)
+#define CAPTURE_USE_PNG 1
+#else
+#define CAPTURE_USE_PNG 0
+#endif
+
+/* Number of frames that can be captured while the previous ones are written */
+#define CAPTURE_POOL_SIZE 3
+
+/* Maximum length of the prefix of the file names */
+#define CAPTURE_NAME_MAX 64
+
+/* The prefix of the file names when none is specified */
+#define CAPTURE_DEFAULT_NAME "frame"
+
+/* Nice value of the writer thread */
+#define CAPTURE_WRITER_NICE 10
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* The states of a buffer of the pool */
+typedef enum {
+    CAPTURE_BUF_FREE,
+    CAPTURE_BUF_FILLING,    /* Receiving the flushed pixels */
+    CAPTURE_BUF_QUEUED      /* Waiting for or being written by the writer thread */
+} capture_buf_state_t;
+
+/* A captured frame */
+typedef struct capture_buf {
+    capture_buf_state_t state;
+    uint8_t *data;
+    size_t size;            /* Allocated size of data */
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+    lv_color_format_t cf;
+    uint32_t seq;
+    char name[CAPTURE_NAME_MAX];
+    struct capture_buf *next;
+} capture_buf_t;
+
+/* The capture of a display */
+typedef struct {
+    lv_display_t *disp;
+    char *dir;
+    frame_capture_format_t format;
+    capture_buf_t pool[CAPTURE_POOL_SIZE];
+
+    /* Only accessed by the LVGL thread */
+    bool requested;
+    char req_name[CAPTURE_NAME_MAX];
+    capture_buf_t *cur;                   /* The buffer of the frame being rendered */
+    uint32_t seq;
+    uint32_t dropped;
+
+    /* The last frame flushed in DIRECT or FULL mode. The flushed areas
+     * of each frame are copied to it, a capture copies it at once instead
+     * of reading the whole draw buffer, which can be mapped scanout memory */
+    capture_buf_t shadow;
+    bool shadow_valid;
+
+    /* The queue of the writer thread and the states of the buffers,
+     * protected by the mutex */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    capture_buf_t *head;
+    capture_buf_t *tail;
+    bool stop;
+
+    /* Only accessed by the writer thread */
+    pthread_t thread;
+    uint8_t *rgb;
+    size_t rgb_size;
+    uint32_t written;
+} capture_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void get_frame_size(lv_display_t *disp, uint32_t *width, uint32_t *height);
+static bool setup_buffer(capture_buf_t *buf, lv_display_t *disp);
+static capture_buf_t *claim_buffer(lv_display_t *disp);
+static void queue_buffer(capture_buf_t *buf);
+static void invalidate_frame(lv_display_t *disp);
+static void copy_area(capture_buf_t *buf, const lv_area_t *area,
+                      const uint8_t *src, uint32_t src_stride);
+static void update_shadow(lv_display_t *disp, const lv_area_t *area, const uint8_t *px_map);
+static void refr_start_cb(lv_event_t *e);
+static void flush_start_cb(lv_event_t *e);
+static void interval_timer_cb(lv_timer_t *timer);
+static void request_signal_cb(int signum, void *user_data);
+static void *writer_thread(void *arg);
+static int write_capture(capture_buf_t *buf);
+#if CAPTURE_USE_PNG
+static int encode_png(capture_buf_t *buf, uint8_t **png, size_t *png_size);
+static int convert_to_rgb(capture_buf_t *buf);
+#endif
+static void stop_at_exit(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static capture_t capture;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int frame_capture_init(lv_display_t *disp, const char *dir,
+                       frame_capture_format_t format, uint32_t interval)
+{
+    int i;
+    int ret;
+    uint32_t width;
+    uint32_t height;
+    size_t size;
+    pthread_attr_t attr;
+
+    LV_ASSERT_NULL(disp);
+
+    if (capture.disp != NULL) {
+        LV_LOG_ERROR("The frames of a display are already captured");
+        return -1;
+    }
+
+    if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+        LV_LOG_ERROR("Failed to create %s: %s", dir, strerror(errno));
+        return -1;
+    }
+
+#if !CAPTURE_USE_PNG
+    if (format == FRAME_CAPTURE_PNG) {
+        LV_LOG_WARN("The PNG encoder can't run on the capture thread, writing raw frames");
+        format = FRAME_CAPTURE_RAW;
+    }
+#endif
+
+    /* Allocated upfront, capturing a frame only copies the pixels */
+    get_frame_size(disp, &width, &height);
+    size = (size_t)width * height * lv_color_format_get_size(lv_display_get_color_format(disp));
+
+    for (i = 0; i < CAPTURE_POOL_SIZE; i++) {
+        capture.pool[i].data = malloc(size);
+        LV_ASSERT_NULL(capture.pool[i].data);
+        capture.pool[i].size = size;
+        capture.pool[i].state = CAPTURE_BUF_FREE;
+    }
+
+    pthread_mutex_init(&capture.mutex, NULL);
+    pthread_cond_init(&capture.cond, NULL);
+
+    /* The writer doesn't inherit the real-time policy set with --sched and
+     * stays off the CPUs of the UI, it must never delay the rendering */
+    thread_sched_init_helper_attr(&attr);
+
+    ret = pthread_create(&capture.thread, &attr, writer_thread, NULL);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0) {
+        LV_LOG_ERROR("Failed to create the capture thread: %s", strerror(ret));
+
+        for (i = 0; i < CAPTURE_POOL_SIZE; i++) {
+            free(capture.pool[i].data);
+            capture.pool[i].data = NULL;
+        }
+        return -1;
+    }
+
+    capture.dir = strdup(dir);
+    LV_ASSERT_NULL(capture.dir);
+    capture.format = format;
+    capture.disp = disp;
+
+    lv_display_add_event_cb(disp, refr_start_cb, LV_EVENT_REFR_START, NULL);
+    lv_display_add_event_cb(disp, flush_start_cb, LV_EVENT_FLUSH_START, NULL);
+
+    driver_backends_watch_signal(SIGRTMIN, request_signal_cb, NULL);
+
+    if (interval > 0) {
+        lv_timer_create(interval_timer_cb, interval, NULL);
+    }
+
+    atexit(stop_at_exit);
+
+    LV_LOG_USER("Capturing the frames to %s", dir);
+    return 0;
+}
+
+int frame_capture_parse_format(const char *name)
+{
+    if (strcmp(name, "png") == 0) {
+        return FRAME_CAPTURE_PNG;
+    }
+
+    if (strcmp(name, "raw") == 0) {
+        return FRAME_CAPTURE_RAW;
+    }
+
+    return -1;
+}
+
+void frame_capture_request(const char *name)
+{
+    lv_area_t area = { 0, 0, 0, 0 };
+
+    if (capture.disp == NULL) {
+        return;
+    }
+
+    if (!capture.requested) {
+        snprintf(capture.req_name, sizeof(capture.req_name), "%s",
+                 name != NULL ? name : CAPTURE_DEFAULT_NAME);
+        capture.requested = true;
+    }
+
+    /* Wakes the refresh timer up, also when the display is idle */
+    lv_inv_area(capture.disp, &area);
+}
+
+bool frame_capture_is_enabled(void)
+{
+    return capture.disp != NULL;
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Get the size of the frames flushed by a display
+ *
+ * @param disp the display
+ * @param width set to the width of the flushed frames in px
+ * @param height set to the height of the flushed frames in px
+ */
+static void get_frame_size(lv_display_t *disp, uint32_t *width, uint32_t *height)
+{
+    lv_display_rotation_t rotation = lv_display_get_rotation(disp);
+
+    *width = lv_display_get_horizontal_resolution(disp);
+    *height = lv_display_get_vertical_resolution(disp);
+
+    /* The software rotation is applied before the flush */
+    if (rotation == LV_DISPLAY_ROTATION_90 || rotation == LV_DISPLAY_ROTATION_270) {
+        *width = lv_display_get_vertical_resolution(disp);
+        *height = lv_display_get_horizontal_resolution(disp);
+    }
+}
+
+/**
+ * Set the geometry of a buffer to the one of the frames of a display
+ *
+ * @param buf the buffer
+ * @param disp the display
+ * @return true if the geometry or the color format changed
+ */
+static bool setup_buffer(capture_buf_t *buf, lv_display_t *disp)
+{
+    size_t size;
+    uint32_t width = buf->width;
+    uint32_t height = buf->height;
+    lv_color_format_t cf = buf->cf;
+
+    buf->cf = lv_display_get_color_format(disp);
+    get_frame_size(disp, &buf->width, &buf->height);
+    buf->stride = buf->width * lv_color_format_get_size(buf->cf);
+    size = (size_t)buf->stride * buf->height;
+
+    /* The resolution or the color format changed */
+    if (size > buf->size) {
+        free(buf->data);
+        buf->data = malloc(size);
+        LV_ASSERT_NULL(buf->data);
+        buf->size = size;
+    }
+
+    return buf->width != width || buf->height != height || buf->cf != cf;
+}
+
+/**
+ * Take a free buffer of the pool for the next frame
+ *
+ * @description the capture is dropped if all the buffers are queued,
+ * the rendering never waits for the writer thread
+ * @param disp the display
+ * @return the buffer, NULL if none is free
+ */
+static capture_buf_t *claim_buffer(lv_display_t *disp)
+{
+    int i;
+    capture_buf_t *buf = NULL;
+
+    pthread_mutex_lock(&capture.mutex);
+
+    for (i = 0; i < CAPTURE_POOL_SIZE; i++) {
+        if (capture.pool[i].state == CAPTURE_BUF_FREE) {
+            buf = &capture.pool[i];
+            buf->state = CAPTURE_BUF_FILLING;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&capture.mutex);
+
+    if (buf == NULL) {
+        capture.dropped++;
+        LV_LOG_WARN("All the capture buffers are being written, capture dropped");
+        return NULL;
+    }
+
+    setup_buffer(buf, disp);
+
+    buf->seq = capture.seq++;
+    memcpy(buf->name, capture.req_name, sizeof(buf->name));
+
+    return buf;
+}
+
+/**
+ * Hand a complete frame over to the writer thread
+ *
+ * @param buf the buffer of the frame
+ */
+static void queue_buffer(capture_buf_t *buf)
+{
+    pthread_mutex_lock(&capture.mutex);
+
+    buf->state = CAPTURE_BUF_QUEUED;
+    buf->next = NULL;
+
+    if (capture.tail != NULL) {
+        capture.tail->next = buf;
+    } else {
+        capture.head = buf;
+    }
+
+    capture.tail = buf;
+
+    pthread_cond_signal(&capture.cond);
+    pthread_mutex_unlock(&capture.mutex);
+}
+
+/**
+ * Make sure that the next refresh flushes a complete frame
+ *
+ * @description in PARTIAL mode the draw buffer only holds the areas being
+ * rendered, the frame is assembled from the flushes of a full redraw. In
+ * the other modes the shadow holds the whole frame, flushing any area is
+ * enough once it was filled by a full redraw
+ * @param disp the display
+ */
+static void invalidate_frame(lv_display_t *disp)
+{
+    lv_area_t area = { 0, 0, 0, 0 };
+
+    if (lv_display_get_render_mode(disp) == LV_DISPLAY_RENDER_MODE_PARTIAL ||
+        !capture.shadow_valid) {
+        area.x2 = lv_display_get_horizontal_resolution(disp) - 1;
+        area.y2 = lv_display_get_vertical_resolution(disp) - 1;
+    }
+
+    lv_inv_area(disp, &area);
+}
+
+/**
+ * Copy flushed pixels to a capture buffer
+ *
+ * @param buf the capture buffer
+ * @param area the area of the pixels on the display, clipped to the frame
+ * @param src the first pixel of the area
+ * @param src_stride the length of a line of src in bytes
+ */
+static void copy_area(capture_buf_t *buf, const lv_area_t *area,
+                      const uint8_t *src, uint32_t src_stride)
+{
+    int32_t y;
+    int32_t x1 = LV_MAX(area->x1, 0);
+    int32_t y1 = LV_MAX(area->y1, 0);
+    int32_t x2 = LV_MIN(area->x2, (int32_t)buf->width - 1);
+    int32_t y2 = LV_MIN(area->y2, (int32_t)buf->height - 1);
+    uint32_t px_size = lv_color_format_get_size(buf->cf);
+    uint8_t *dst;
+
+    if (x2 < x1 || y2 < y1) {
+        return;
+    }
+
+    src += (y1 - area->y1) * src_stride + (x1 - area->x1) * px_size;
+    dst = buf->data + y1 * buf->stride + x1 * px_size;
+
+    for (y = y1; y <= y2; y++) {
+        memcpy(dst, src, (x2 - x1 + 1) * px_size);
+        src += src_stride;
+        dst += buf->stride;
+    }
+}
+
+/**
+ * Copy a flushed area to the shadow
+ *
+ * @description in DIRECT mode each rendered area is flushed on its own,
+ * in FULL mode the whole frame at once. The shadow becomes valid when
+ * the whole frame was redrawn
+ * @param disp the display
+ * @param area the flushed area
+ * @param px_map the draw buffer holding the whole frame
+ */
+static void update_shadow(lv_display_t *disp, const lv_area_t *area, const uint8_t *px_map)
+{
+    capture_buf_t *shadow = &capture.shadow;
+    uint32_t stride = lv_display_get_buf_active(disp)->header.stride;
+    uint32_t px_size;
+
+    if (setup_buffer(shadow, disp)) {
+        capture.shadow_valid = false;
+    }
+
+    px_size = lv_color_format_get_size(shadow->cf);
+
+    copy_area(shadow, area, px_map + area->y1 * stride + area->x1 * px_size, stride);
+
+    if (area->x1 <= 0 && area->y1 <= 0 &&
+        area->x2 >= (int32_t)shadow->width - 1 && area->y2 >= (int32_t)shadow->height - 1) {
+        capture.shadow_valid = true;
+    }
+}
+
+/**
+ * Start a requested capture
+ *
+ * @description the areas can still be invalidated at this point of
+ * the refresh, the frame to capture is rendered right away
+ * @note called by LVGL
+ */
+static void refr_start_cb(lv_event_t *e)
+{
+    lv_display_t *disp = lv_event_get_target(e);
+
+    if (capture.cur == NULL) {
+
+        if (!capture.requested) {
+            return;
+        }
+
+        capture.requested = false;
+        capture.cur = claim_buffer(disp);
+
+        if (capture.cur == NULL) {
+            return;
+        }
+    }
+
+    invalidate_frame(disp);
+}
+
+/**
+ * Copy the flushed pixels of the frame being captured
+ *
+ * @description the pixels are copied before the flush callback of the
+ * backend is called, the draw buffer isn't modified until the flush is
+ * ready. In DIRECT and FULL mode the flushed areas of every frame are
+ * copied to the shadow, a captured frame costs a single copy of the shadow
+ * @note called by LVGL before each call of the flush callback
+ */
+static void flush_start_cb(lv_event_t *e)
+{
+    lv_area_t frame;
+    lv_display_t *disp = lv_event_get_target(e);
+    const lv_area_t *area = lv_event_get_param(e);
+    uint8_t *px_map = lv_display_get_buf_active(disp)->data;
+    capture_buf_t *buf = capture.cur;
+    bool partial = lv_display_get_render_mode(disp) == LV_DISPLAY_RENDER_MODE_PARTIAL;
+
+    if (!partial) {
+        update_shadow(disp, area, px_map);
+    }
+
+    if (buf != NULL && buf->cf == lv_display_get_color_format(disp)) {
+
+        if (partial) {
+            copy_area(buf, area, px_map,
+                      lv_draw_buf_width_to_stride(lv_area_get_width(area), buf->cf));
+        } else if (lv_display_flush_is_last(disp) && capture.shadow_valid) {
+            memcpy(buf->data, capture.shadow.data, (size_t)buf->stride * buf->height);
+        } else if (lv_display_flush_is_last(disp)) {
+            frame.x1 = 0;
+            frame.y1 = 0;
+            frame.x2 = buf->width - 1;
+            frame.y2 = buf->height - 1;
+            copy_area(buf, &frame, px_map, lv_display_get_buf_active(disp)->header.stride);
+        }
+
+        if (lv_display_flush_is_last(disp)) {
+            queue_buffer(buf);
+            capture.cur = NULL;
+        }
+    }
+}
+
+/**
+ * Capture a frame periodically
+ *
+ * @note called by LVGL
+ */
+static void interval_timer_cb(lv_timer_t *timer)
+{
+    LV_UNUSED(timer);
+
+    frame_capture_request(NULL);
+}
+
+/**
+ * Capture a frame on SIGRTMIN
+ *
+ * @note called by the run loop
+ */
+static void request_signal_cb(int signum, void *user_data)
+{
+    LV_UNUSED(signum);
+    LV_UNUSED(user_data);
+
+    frame_capture_request(NULL);
+}
+
+/**
+ * Write the queued frames
+ *
+ * @description runs until the program exits, the frames queued at
+ * that point are written first
+ * @param arg unused
+ */
+static void *writer_thread(void *arg)
+{
+    capture_buf_t *buf;
+
+    LV_UNUSED(arg);
+
+    /* Leave the CPU to the rendering, writing a frame is never urgent */
+    setpriority(PRIO_PROCESS, syscall(SYS_gettid), CAPTURE_WRITER_NICE);
+
+    pthread_mutex_lock(&capture.mutex);
+
+    while (true) {
+
+        while (capture.head == NULL && !capture.stop) {
+            pthread_cond_wait(&capture.cond, &capture.mutex);
+        }
+
+        buf = capture.head;
+
+        if (buf == NULL) {
+            break;
+        }
+
+        capture.head = buf->next;
+
+        if (capture.head == NULL) {
+            capture.tail = NULL;
+        }
+
+        pthread_mutex_unlock(&capture.mutex);
+
+        if (write_capture(buf) == 0) {
+            capture.written++;
+        }
+
+        pthread_mutex_lock(&capture.mutex);
+        buf->state = CAPTURE_BUF_FREE;
+    }
+
+    pthread_mutex_unlock(&capture.mutex);
+
+    return NULL;
+}
+
+/**
+ * Write a captured frame
+ *
+ * @description the frame is written to a temporary file renamed once
+ * complete, a reader never sees a truncated frame. The frames that can't
+ * be encoded to PNG are written in the LVGL binary image format
+ * @param buf the buffer of the frame
+ * @return 0 on success, -1 on error
+ */
+static int write_capture(capture_buf_t *buf)
+{
+    char path[PATH_MAX];
+    char tmp_path[PATH_MAX];
+    FILE *f;
+    bool ok;
+    bool png = false;
+    uint8_t *png_data = NULL;
+    size_t png_size = 0;
+    lv_image_header_t header;
+
+#if CAPTURE_USE_PNG
+    if (capture.format == FRAME_CAPTURE_PNG) {
+        png = encode_png(buf, &png_data, &png_size) == 0;
+    }
+#endif
+
+    snprintf(path, sizeof(path), "%s/%s-%05u.%s", capture.dir, buf->name,
+             (unsigned int)buf->seq, png ? "png" : "bin");
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    f = fopen(tmp_path, "wb");
+
+    if (f == NULL) {
+        LV_LOG_ERROR("Failed to create %s: %s", tmp_path, strerror(errno));
+        lv_free(png_data);
+        return -1;
+    }
+
+    if (png) {
+        ok = fwrite(png_data, png_size, 1, f) == 1;
+    } else {
+        memset(&header, 0, sizeof(header));
+        header.magic = LV_IMAGE_HEADER_MAGIC;
+        header.cf = buf->cf;
+        header.w = buf->width;
+        header.h = buf->height;
+        header.stride = buf->stride;
+
+        ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(buf->data, (size_t)buf->stride * buf->height, 1, f) == 1;
+    }
+
+    lv_free(png_data);
+
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+
+    if (!ok) {
+        LV_LOG_ERROR("Failed to write %s: %s", tmp_path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+
+    if (rename(tmp_path, path) == -1) {
+        LV_LOG_ERROR("Failed to rename %s: %s", tmp_path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+
+    LV_LOG_INFO("Frame captured to %s", path);
+    return 0;
+}
+
+#if CAPTURE_USE_PNG
+/**
+ * Encode a captured frame to PNG
+ *
+ * @param buf the buffer of the frame
+ * @param png set to the encoded image, allocated with lv_malloc
+ * @param png_size set to the size of the encoded image
+ * @return 0 on success, -1 on error
+ */
+static int encode_png(capture_buf_t *buf, uint8_t **png, size_t *png_size)
+{
+    unsigned error;
+
+    if (convert_to_rgb(buf) == -1) {
+        LV_LOG_WARN("Can't encode color format %d to PNG, writing a raw frame", buf->cf);
+        return -1;
+    }
+
+    error = lodepng_encode_memory(png, png_size, capture.rgb,
+                                  buf->width, buf->height, LCT_RGB, 8);
+
+    if (error != 0) {
+        LV_LOG_ERROR("Failed to encode the frame to PNG: %s", lodepng_error_text(error));
+        lv_free(*png);
+        *png = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Convert a captured frame to 8 bit RGB
+ *
+ * @description the result is stored in the conversion buffer of the
+ * writer thread, reused by the next frames
+ * @param buf the buffer of the frame
+ * @return 0 on success, -1 if the color format isn't supported
+ */
+static int convert_to_rgb(capture_buf_t *buf)
+{
+    uint32_t x;
+    uint32_t y;
+    uint16_t px;
+    const uint8_t *row;
+    const uint16_t *row16;
+    uint8_t *dst;
+    size_t size = (size_t)buf->width * buf->height * 3;
+
+    if (buf->cf != LV_COLOR_FORMAT_RGB565 && buf->cf != LV_COLOR_FORMAT_RGB888 &&
+        buf->cf != LV_COLOR_FORMAT_XRGB8888 && buf->cf != LV_COLOR_FORMAT_ARGB8888) {
+        return -1;
+    }
+
+    if (size > capture.rgb_size) {
+        free(capture.rgb);
+        capture.rgb = malloc(size);
+        LV_ASSERT_NULL(capture.rgb);
+        capture.rgb_size = size;
+    }
+
+    dst = capture.rgb;
+
+    for (y = 0; y < buf->height; y++) {
+
+        row = buf->data + y * buf->stride;
+
+        switch (buf->cf) {
+        case LV_COLOR_FORMAT_RGB565:
+            row16 = (const uint16_t *)row;
+            for (x = 0; x < buf->width; x++) {
+                px = row16[x];
+                *dst++ = ((px >> 8) & 0xf8) | (px >> 13);
+                *dst++ = ((px >> 3) & 0xfc) | ((px >> 9) & 0x03);
+                *dst++ = ((px << 3) & 0xf8) | ((px >> 2) & 0x07);
+            }
+            break;
+        case LV_COLOR_FORMAT_RGB888:
+            /* Stored as BGR */
+            for (x = 0; x < buf->width; x++, row += 3) {
+                *dst++ = row[2];
+                *dst++ = row[1];
+                *dst++ = row[0];
+            }
+            break;
+        default:
+            /* Stored as BGRX/BGRA */
+            for (x = 0; x < buf->width; x++, row += 4) {
+                *dst++ = row[2];
+                *dst++ = row[1];
+                *dst++ = row[0];
+            }
+            break;
+        }
+    }
+
+    return 0;
+}
+#endif
+
+/**
+ * Write the queued frames before the program exits
+ */
+static void stop_at_exit(void)
+{
+    pthread_mutex_lock(&capture.mutex);
+    capture.stop = true;
+    pthread_cond_signal(&capture.cond);
+    pthread_mutex_unlock(&capture.mutex);
+
+    pthread_join(capture.thread, NULL);
+
+    LV_LOG_USER("%u frame(s) captured to %s, %u dropped",
+                (unsigned int)capture.written, capture.dir, (unsigned int)capture.dropped);
+}
@@ -0,0 +1,99 @@
+/**
+ * @file frame_capture.h
+ *
+ * Asynchronous frame capture
+ *
+ * The pixels flushed by a display are copied to one buffer of a small
+ * pool while the frame is rendered, a background thread encodes the
+ * buffer to a PNG or an LVGL binary image and writes it. The rendering
+ * never waits for the writer, a capture requested while all the buffers
+ * are queued is dropped instead
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* The file formats of the captures */
+typedef enum {
+    FRAME_CAPTURE_PNG,      /* 8 bit RGB PNG, requires LV_USE_LODEPNG */
+    FRAME_CAPTURE_RAW       /* LVGL binary image in the color format of the display */
+} frame_capture_format_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Start capturing the frames of a display
+ * @description copies the flushed areas from the flush events, allocates the
+ * buffers and starts the writer thread. A capture is requested on
+ * SIGRTMIN, every interval and by frame_capture_request. The queued
+ * captures are written before the program exits.
+ * Must be called once the display backend is initialized
+ *
+ * @param disp the display
+ * @param dir the directory the captures are written to
+ * @param format the file format, PNG falls back to RAW if the PNG
+ * encoder can't run on the writer thread
+ * @param interval the time between two captures in ms, 0 to only capture on request
+ * @return 0 on success, -1 on error
+ */
+int frame_capture_init(lv_display_t *disp, const char *dir,
+                       frame_capture_format_t format, uint32_t interval);
+
+/**
+ * @brief Parse the name of a file format
+ * @param name png or raw
+ * @return the format, -1 if the name is invalid
+ */
+int frame_capture_parse_format(const char *name);
+
+/**
+ * @brief Capture the next frame
+ * @description a frame is rendered even if nothing was invalidated,
+ * in PARTIAL render mode the whole display is redrawn. Requests made
+ * before the frame is rendered are merged. Does nothing if the capture
+ * isn't initialized
+ *
+ * @param name the prefix of the file name, NULL for "frame"
+ */
+void frame_capture_request(const char *name);
+
+/**
+ * @brief Check if the frames are captured
+ * @return true once frame_capture_init succeeded
+ */
+bool frame_capture_is_enabled(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*FRAME_CAPTURE_H*/
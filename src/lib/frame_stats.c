@@ -0,0 +1,498 @@
+/**
+ * @file frame_stats.c
+ *
+ * Per frame timing instrumentation
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+
+#include "lvgl/lvgl.h"
+
+#include "simulator_util.h"
+#include "driver_backends.h"
+#include "frame_stats.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Maximum number of displays that can be instrumented */
+#define FRAME_STATS_MAX_DISPLAYS 4
+
+/* Each power of two is split in 2^HIST_SUB_BITS buckets */
+#define HIST_SUB_BITS 2
+#define HIST_SUB_CNT (1 << HIST_SUB_BITS)
+
+/* Enough buckets for values up to 2^32 */
+#define HIST_BUCKETS ((32 - HIST_SUB_BITS + 1) * HIST_SUB_CNT)
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* A log-linear histogram
+ * The samples are recorded by the LVGL thread and read from the
+ * reporting code with atomic operations, no lock is required */
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[HIST_BUCKETS];
+} histogram_t;
+
+/* The statistics of a display */
+typedef struct {
+    lv_display_t *disp;
+    const char *name;
+    histogram_t hist[FRAME_STATS_METRIC_CNT];
+
+    /* State of the frame being rendered, only accessed by the LVGL thread */
+    uint64_t render_start_us;
+    uint64_t flush_start_us;
+    uint64_t frame_flush_us;
+    uint64_t last_frame_us;
+    uint64_t dirty_px;
+    uint64_t input_us;        /* Oldest input event without visible effect yet */
+    bool reading;             /* An input device read is in progress */
+    uint64_t frame_input_us;  /* Input event shown by the next frame */
+} display_stats_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static display_stats_t *find_stats(lv_display_t *disp);
+static void display_event_cb(lv_event_t *e);
+static void indev_read_timer_cb(lv_timer_t *timer);
+static void hist_record(histogram_t *h, uint64_t value);
+static uint32_t hist_bucket(uint64_t value);
+static uint64_t hist_bucket_low(uint32_t idx);
+static uint64_t hist_percentile(histogram_t *h, double pct);
+static void print_signal_cb(int signum, void *user_data);
+static void print_at_exit(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static display_stats_t stats[FRAME_STATS_MAX_DISPLAYS];
+static uint32_t stats_count;
+
+static const char *metric_names[FRAME_STATS_METRIC_CNT] = {
+    "render_us",
+    "flush_us",
+    "interval_us",
+    "area_px",
+    "latency_us"
+};
+
+/**********************
+ *      MACROS
+ **********************/
+#define ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define ATOMIC_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define ATOMIC_ADD(p, v) __atomic_fetch_add((p), (v), __ATOMIC_RELAXED)
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int frame_stats_attach(lv_display_t *disp, const char *name)
+{
+    display_stats_t *ds;
+
+    LV_ASSERT_NULL(disp);
+
+    if (find_stats(disp) != NULL) {
+        return 0;
+    }
+
+    if (stats_count == FRAME_STATS_MAX_DISPLAYS) {
+        LV_LOG_ERROR("Too many instrumented displays, max: %d", FRAME_STATS_MAX_DISPLAYS);
+        return -1;
+    }
+
+    ds = &stats[stats_count];
+    memset(ds, 0, sizeof(*ds));
+    ds->disp = disp;
+    ds->name = name;
+
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_ALL, ds);
+
+    stats_count++;
+    return 0;
+}
+
+void frame_stats_enable_report(void)
+{
+    static bool enabled;
+
+    if (enabled) {
+        return;
+    }
+
+    driver_backends_watch_signal(SIGUSR1, print_signal_cb, NULL);
+    atexit(print_at_exit);
+    enabled = true;
+}
+
+void frame_stats_input(lv_display_t *disp, uint64_t timestamp_us)
+{
+    display_stats_t *ds = find_stats(disp);
+
+    if (ds != NULL && ds->input_us == 0) {
+        ds->input_us = timestamp_us;
+    }
+}
+
+void frame_stats_track_indev(lv_indev_t *indev)
+{
+    lv_timer_t *read_timer = lv_indev_get_read_timer(indev);
+
+    if (read_timer != NULL) {
+        lv_timer_set_cb(read_timer, indev_read_timer_cb);
+    }
+}
+
+int frame_stats_is_attached(lv_display_t *disp)
+{
+    return find_stats(disp) != NULL;
+}
+
+void frame_stats_reset(lv_display_t *disp)
+{
+    int i;
+    uint32_t b;
+    histogram_t *h;
+    display_stats_t *ds = find_stats(disp);
+
+    if (ds == NULL) {
+        return;
+    }
+
+    for (i = 0; i < FRAME_STATS_METRIC_CNT; i++) {
+
+        h = &ds->hist[i];
+        ATOMIC_STORE(&h->count, 0);
+        ATOMIC_STORE(&h->sum, 0);
+        ATOMIC_STORE(&h->max, 0);
+
+        for (b = 0; b < HIST_BUCKETS; b++) {
+            ATOMIC_STORE(&h->buckets[b], 0);
+        }
+    }
+
+    /* Don't count the time elapsed before the reset as a frame interval */
+    ds->last_frame_us = 0;
+    ds->input_us = 0;
+    ds->frame_input_us = 0;
+}
+
+uint64_t frame_stats_get_count(lv_display_t *disp, frame_stats_metric_t metric)
+{
+    display_stats_t *ds = find_stats(disp);
+
+    if (ds == NULL) {
+        return 0;
+    }
+
+    return ATOMIC_LOAD(&ds->hist[metric].count);
+}
+
+double frame_stats_get_avg(lv_display_t *disp, frame_stats_metric_t metric)
+{
+    uint64_t count;
+    display_stats_t *ds = find_stats(disp);
+
+    if (ds == NULL) {
+        return 0;
+    }
+
+    count = ATOMIC_LOAD(&ds->hist[metric].count);
+
+    if (count == 0) {
+        return 0;
+    }
+
+    return (double)ATOMIC_LOAD(&ds->hist[metric].sum) / count;
+}
+
+uint64_t frame_stats_get_percentile(lv_display_t *disp, frame_stats_metric_t metric, double pct)
+{
+    display_stats_t *ds = find_stats(disp);
+
+    if (ds == NULL) {
+        return 0;
+    }
+
+    return hist_percentile(&ds->hist[metric], pct);
+}
+
+void frame_stats_print(FILE *fp)
+{
+    uint32_t i;
+    int m;
+    histogram_t *h;
+    display_stats_t *ds;
+
+    for (i = 0; i < stats_count; i++) {
+
+        ds = &stats[i];
+
+        fprintf(fp, "Frame statistics - %s\n", ds->name);
+        fprintf(fp, "%-12s %10s %10s %10s %10s %10s %10s\n",
+                "metric", "count", "avg", "p50", "p90", "p99", "max");
+
+        for (m = 0; m < FRAME_STATS_METRIC_CNT; m++) {
+
+            h = &ds->hist[m];
+
+            fprintf(fp, "%-12s %10llu %10.0f %10llu %10llu %10llu %10llu\n",
+                    metric_names[m],
+                    (unsigned long long)ATOMIC_LOAD(&h->count),
+                    frame_stats_get_avg(ds->disp, m),
+                    (unsigned long long)hist_percentile(h, 50),
+                    (unsigned long long)hist_percentile(h, 90),
+                    (unsigned long long)hist_percentile(h, 99),
+                    (unsigned long long)ATOMIC_LOAD(&h->max));
+        }
+    }
+
+    fflush(fp);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Find the statistics of a display
+ *
+ * @param disp the LVGL display
+ * @return the statistics, NULL if the display is not instrumented
+ */
+static display_stats_t *find_stats(lv_display_t *disp)
+{
+    uint32_t i;
+
+    for (i = 0; i < stats_count; i++) {
+        if (stats[i].disp == disp) {
+            return &stats[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Measure the frames
+ *
+ * @description a frame starts with LV_EVENT_RENDER_START and ends with
+ * LV_EVENT_RENDER_READY, the flushes happen in between. The areas
+ * invalidated since the previous frame are accounted to the frame,
+ * as well as the pending input event
+ * @note called by LVGL
+ */
+static void display_event_cb(lv_event_t *e)
+{
+    uint64_t now;
+    lv_area_t *area;
+    display_stats_t *ds = lv_event_get_user_data(e);
+
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_INVALIDATE_AREA:
+        area = lv_event_get_param(e);
+        if (area != NULL) {
+            ds->dirty_px += lv_area_get_size(area);
+        }
+        if (ds->reading && ds->input_us != 0 && ds->frame_input_us == 0) {
+            ds->frame_input_us = ds->input_us;
+            ds->input_us = 0;
+        }
+        break;
+    case LV_EVENT_RENDER_START:
+        now = get_time_us();
+        if (ds->last_frame_us != 0) {
+            hist_record(&ds->hist[FRAME_STATS_INTERVAL], now - ds->last_frame_us);
+        }
+        ds->last_frame_us = now;
+        ds->render_start_us = now;
+        ds->frame_flush_us = 0;
+        break;
+    case LV_EVENT_FLUSH_START:
+    case LV_EVENT_FLUSH_WAIT_START:
+        ds->flush_start_us = get_time_us();
+        break;
+    case LV_EVENT_FLUSH_FINISH:
+    case LV_EVENT_FLUSH_WAIT_FINISH:
+        ds->frame_flush_us += get_time_us() - ds->flush_start_us;
+        break;
+    case LV_EVENT_RENDER_READY:
+        now = get_time_us();
+        hist_record(&ds->hist[FRAME_STATS_RENDER], now - ds->render_start_us - ds->frame_flush_us);
+        hist_record(&ds->hist[FRAME_STATS_FLUSH], ds->frame_flush_us);
+        hist_record(&ds->hist[FRAME_STATS_AREA], ds->dirty_px);
+        ds->dirty_px = 0;
+        if (ds->frame_input_us != 0 && now > ds->frame_input_us) {
+            hist_record(&ds->hist[FRAME_STATS_LATENCY], now - ds->frame_input_us);
+        }
+        ds->frame_input_us = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Read an input device
+ *
+ * @description the input events handled by the read are only tied to the
+ * areas it invalidates, an event that changed nothing on the display is
+ * dropped so a later unrelated frame doesn't record its latency
+ * @note called by LVGL from the read timer of the input device
+ */
+static void indev_read_timer_cb(lv_timer_t *timer)
+{
+    lv_indev_t *indev = lv_timer_get_user_data(timer);
+    display_stats_t *ds = find_stats(lv_indev_get_display(indev));
+
+    if (ds != NULL) {
+        ds->reading = true;
+    }
+
+    lv_indev_read_timer_cb(timer);
+
+    if (ds != NULL) {
+        ds->reading = false;
+        ds->input_us = 0;
+    }
+}
+
+/**
+ * Record a sample
+ *
+ * @param h the histogram
+ * @param value the value of the sample
+ */
+static void hist_record(histogram_t *h, uint64_t value)
+{
+    uint64_t max = ATOMIC_LOAD(&h->max);
+
+    ATOMIC_ADD(&h->buckets[hist_bucket(value)], 1);
+    ATOMIC_ADD(&h->sum, value);
+    ATOMIC_ADD(&h->count, 1);
+
+    /* Only the LVGL thread records samples */
+    if (value > max) {
+        ATOMIC_STORE(&h->max, value);
+    }
+}
+
+/**
+ * Get the bucket of a value
+ *
+ * @description values below HIST_SUB_CNT have their own bucket, above each
+ * power of two is divided in HIST_SUB_CNT buckets of equal width
+ * @param value the value
+ * @return the index of the bucket
+ */
+static uint32_t hist_bucket(uint64_t value)
+{
+    uint32_t msb;
+    uint32_t idx;
+
+    if (value < HIST_SUB_CNT) {
+        return value;
+    }
+
+    msb = 63 - __builtin_clzll(value);
+    idx = (msb - HIST_SUB_BITS + 1) * HIST_SUB_CNT +
+          ((value >> (msb - HIST_SUB_BITS)) & (HIST_SUB_CNT - 1));
+
+    return LV_MIN(idx, HIST_BUCKETS - 1);
+}
+
+/**
+ * Get the smallest value of a bucket
+ *
+ * @param idx the index of the bucket
+ * @return the lower bound of the bucket
+ */
+static uint64_t hist_bucket_low(uint32_t idx)
+{
+    uint32_t msb;
+
+    if (idx < HIST_SUB_CNT) {
+        return idx;
+    }
+
+    msb = idx / HIST_SUB_CNT + HIST_SUB_BITS - 1;
+
+    return (uint64_t)(HIST_SUB_CNT + idx % HIST_SUB_CNT) << (msb - HIST_SUB_BITS);
+}
+
+/**
+ * Compute a percentile
+ *
+ * @param h the histogram
+ * @param pct the percentile between 0 and 100
+ * @return the middle of the bucket containing the percentile
+ */
+static uint64_t hist_percentile(histogram_t *h, double pct)
+{
+    uint32_t i;
+    uint64_t seen = 0;
+    uint64_t count = ATOMIC_LOAD(&h->count);
+    uint64_t rank;
+
+    if (count == 0) {
+        return 0;
+    }
+
+    rank = (uint64_t)(count * pct / 100.0);
+
+    if (rank >= count) {
+        rank = count - 1;
+    }
+
+    for (i = 0; i < HIST_BUCKETS - 1; i++) {
+
+        seen += ATOMIC_LOAD(&h->buckets[i]);
+
+        if (seen > rank) {
+            return (hist_bucket_low(i) + hist_bucket_low(i + 1)) / 2;
+        }
+    }
+
+    return ATOMIC_LOAD(&h->max);
+}
+
+/**
+ * Print the statistics on SIGUSR1
+ *
+ * @note called by the run loop
+ */
+static void print_signal_cb(int signum, void *user_data)
+{
+    LV_UNUSED(signum);
+    LV_UNUSED(user_data);
+
+    frame_stats_print(stdout);
+}
+
+/**
+ * Print the statistics when the program exits
+ */
+static void print_at_exit(void)
+{
+    frame_stats_print(stdout);
+}
@@ -0,0 +1,146 @@
+/**
+ * @file frame_stats.h
+ *
+ * Per frame timing instrumentation
+ *
+ * Records the render time, flush time, invalidated area and interval
+ * of each frame of a display into histograms, as well as the latency
+ * between an input event and the end of the frame showing its effect. Once the report is enabled
+ * the statistics are printed when SIGUSR1 is received and at exit
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+#include <stdint.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* The measured quantities */
+typedef enum {
+    FRAME_STATS_RENDER,      /* Time spent rendering a frame excluding the flushes in us */
+    FRAME_STATS_FLUSH,       /* Time spent flushing or waiting for the flush in us */
+    FRAME_STATS_INTERVAL,    /* Time between the start of two consecutive frames in us */
+    FRAME_STATS_AREA,        /* Invalidated area of a frame in pixels */
+    FRAME_STATS_LATENCY,     /* Time from an input event to the end of the next frame in us */
+    FRAME_STATS_METRIC_CNT
+} frame_stats_metric_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Start recording the statistics of a display
+ * @param disp the LVGL display
+ * @param name the name displayed in the report, i.e the name of the backend
+ * @return 0 on success, -1 on error
+ */
+int frame_stats_attach(lv_display_t *disp, const char *name);
+
+/**
+ * @brief Print the statistics on SIGUSR1 and at exit
+ * @description installs the SIGUSR1 and atexit handlers, can be called
+ * multiple times
+ */
+void frame_stats_enable_report(void);
+
+/**
+ * @brief Report an input event
+ * @description the first area invalidated while an input device tracked
+ * with frame_stats_track_indev processes the event is considered to be its
+ * effect, the latency is recorded once the frame rendering this area is
+ * flushed. The event is discarded if the read invalidates nothing.
+ * Ignored if the display is not instrumented
+ *
+ * @param disp the display the input device is bound to
+ * @param timestamp_us the time of the event on the CLOCK_MONOTONIC
+ * clock, i.e the kernel timestamp of an evdev event
+ */
+void frame_stats_input(lv_display_t *disp, uint64_t timestamp_us);
+
+/**
+ * @brief Track the reads of an input device
+ * @description wraps the read timer of the input device, the input events
+ * reported before or during a read are only accounted to the areas
+ * invalidated by this read
+ *
+ * @param indev the input device, bound to its display
+ */
+void frame_stats_track_indev(lv_indev_t *indev);
+
+/**
+ * @brief Check if the statistics of a display are recorded
+ * @param disp the LVGL display
+ * @return 1 if frame_stats_attach was called for the display, 0 otherwise
+ */
+int frame_stats_is_attached(lv_display_t *disp);
+
+/**
+ * @brief Clear the recorded statistics of a display
+ * @param disp the LVGL display
+ */
+void frame_stats_reset(lv_display_t *disp);
+
+/**
+ * @brief Get the number of samples of a metric
+ * @param disp the LVGL display
+ * @param metric the metric
+ * @return the number of recorded samples, i.e of frames
+ */
+uint64_t frame_stats_get_count(lv_display_t *disp, frame_stats_metric_t metric);
+
+/**
+ * @brief Get the average of a metric
+ * @param disp the LVGL display
+ * @param metric the metric
+ * @return the average value, 0 if nothing was recorded
+ */
+double frame_stats_get_avg(lv_display_t *disp, frame_stats_metric_t metric);
+
+/**
+ * @brief Get a percentile of a metric
+ * @description the value is approximated by the histogram
+ * bucket, with a precision of 25%
+ *
+ * @param disp the LVGL display
+ * @param metric the metric
+ * @param pct the percentile between 0 and 100
+ * @return the value of the percentile, 0 if nothing was recorded
+ */
+uint64_t frame_stats_get_percentile(lv_display_t *disp, frame_stats_metric_t metric, double pct);
+
+/**
+ * @brief Print the statistics of all the displays
+ * @param fp the output file
+ */
+void frame_stats_print(FILE *fp);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*FRAME_STATS_H*/
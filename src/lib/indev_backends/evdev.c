@@ -19,21 +19,162 @@
  *********************/
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/input.h>
 
 #include "lvgl/lvgl.h"
 #if LV_USE_EVDEV
 #include "lvgl/src/core/lv_global.h"
+#include "../simulator_util.h"
 #include "../backends.h"
+#include "../driver_backends.h"
+#include "../frame_stats.h"
+#include "../adaptive_refresh.h"
+#include "../thread_sched.h"
 
 /*********************
  *      DEFINES
  *********************/
 
+/* The directory containing the evdev device nodes */
+#define EVDEV_INPUT_DIR "/dev/input"
+
+/* Number of devices read by the input thread */
+#define INPUT_THREAD_MAX_DEVICES 16
+
+/* Number of devices waking up the run loop */
+#define EVDEV_MAX_WATCHED 32
+
+/* The inotify events of the device nodes. A node created by udev can be
+ * unreadable until its permissions are set, it is opened again then */
+#define EVDEV_INOTIFY_MASK (IN_CREATE | IN_ATTRIB)
+
+/* Number of samples buffered between the input thread and LVGL, power of 2 */
+#define INPUT_RING_SIZE 256
+
+/* First line of the input traces, followed by the version of the format */
+#define INPUT_TRACE_HEADER "# lvglsim evdev trace"
+#define INPUT_TRACE_VERSION 1
+
+/* Number of devices recorded at the same time */
+#define INPUT_TRACE_MAX_DEVICES 32
+
+#define BIT_IS_SET(bits, n) ((bits)[(n) / (8 * sizeof(long))] & (1UL << ((n) % (8 * sizeof(long)))))
+
 /**********************
  *      TYPEDEFS
  **********************/
 
+/* A pointer sample, sent on each SYN_REPORT of a device */
+typedef struct {
+    uint64_t timestamp_us;  /* The kernel timestamp of the report, CLOCK_MONOTONIC */
+    int32_t x;
+    int32_t y;
+    bool pressed;
+} input_sample_t;
+
+/* A pointer device read by the input thread */
+typedef struct {
+    int fd;                 /* -1 if the slot is free, the id of the device when replaying */
+    bool relative;          /* A mouse, otherwise a touchscreen or a tablet */
+    bool dirty;             /* The state changed since the last report */
+    bool pressed;
+    int32_t x;
+    int32_t y;
+    struct input_absinfo abs_x;
+    struct input_absinfo abs_y;
+    struct input_absinfo abs_mt_x;  /* The multitouch axes have their own range */
+    struct input_absinfo abs_mt_y;
+    dev_t rdev;             /* The device node, to open it only once */
+} input_device_t;
+
+/* A device waking up the run loop */
+typedef struct {
+    int fd;
+    dev_t rdev;             /* 0 if the slot is free */
+} watched_device_t;
+
+/* The state of the input thread */
+typedef struct {
+    pthread_t thread;
+    lv_indev_t *indev;
+    lv_display_t *display;
+    int epoll_fd;
+    int inotify_fd;
+    int wake_fd;            /* eventfd waking up the run loop */
+    int32_t width;          /* Resolution of the display, used for the scaling */
+    int32_t height;
+    int32_t rel_x;          /* The position of the mouse pointer */
+    int32_t rel_y;
+    bool has_relative;      /* A mouse has been found, shared with the LVGL thread */
+    bool cursor_set;
+    input_device_t devices[INPUT_THREAD_MAX_DEVICES];
+
+    /* Single producer single consumer ring, head is written by the
+     * input thread, tail by the LVGL thread */
+    input_sample_t ring[INPUT_RING_SIZE];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t dropped;       /* Written by the input thread */
+    uint32_t dropped_reported;
+    input_sample_t last;    /* The last sample returned to LVGL */
+} input_thread_t;
+
+/* A device being recorded */
+typedef struct {
+    int fd;                 /* The file descriptor the events are read from */
+    int id;                 /* The id of the device in the trace, 0 if the slot is free */
+} record_device_t;
+
+/* The recording of the raw events, written by the thread reading the devices */
+typedef struct {
+    FILE *fp;
+    pthread_mutex_t lock;
+    uint64_t start_us;      /* CLOCK_MONOTONIC time of the start of the recording */
+    int last_id;            /* The id of the last recorded device */
+    record_device_t devices[INPUT_TRACE_MAX_DEVICES];
+} input_record_t;
+
+/* An entry of a trace, a device or an event */
+typedef struct {
+    int id;                 /* The device, unique in the recording */
+    bool is_device;
+    bool relative;
+    uint64_t time_us;       /* Time of the event since the start of the recording */
+    struct input_event ev;
+    struct input_absinfo abs_x;
+    struct input_absinfo abs_y;
+    struct input_absinfo abs_mt_x;
+    struct input_absinfo abs_mt_y;
+} replay_entry_t;
+
+/* The state of the replay */
+typedef struct {
+    replay_entry_t *entries;
+    uint32_t count;
+    uint32_t next;
+    uint32_t start;         /* lv_tick_get() at the start of the replay */
+    uint32_t samples;
+    float speed;            /* 0 - one sample per frame */
+    bool loop;
+    bool finished;
+    lv_timer_t *read_timer;
+} input_replay_t;
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
@@ -42,6 +183,38 @@ static void indev_deleted_cb(lv_event_t *e);
 static void discovery_cb(lv_indev_t *indev, lv_evdev_type_t type, void *user_data);
 static void set_mouse_cursor_icon(lv_indev_t *indev, lv_display_t *display);
 static lv_indev_t *init_pointer_evdev(lv_display_t *display);
+static void watch_input_device(const char *path, lv_display_t *display, bool discovered);
+static watched_device_t *find_watched_device(dev_t rdev);
+static bool is_discovered_device(int fd);
+static void watch_input_dir(lv_display_t *display);
+static void input_device_ready_cb(int fd, uint32_t events, void *user_data);
+static void input_dir_changed_cb(int fd, uint32_t events, void *user_data);
+static lv_indev_t *init_input_thread(lv_display_t *display, const char *device);
+static void input_thread_add_device(const char *path);
+static void input_thread_read_device(input_device_t *dev);
+static bool decode_event(input_device_t *dev, const struct input_event *ev);
+static void make_sample(input_device_t *dev, uint64_t timestamp_us, input_sample_t *sample);
+static void input_thread_push(input_device_t *dev, const struct input_event *ev);
+static int32_t scale_abs(const struct input_absinfo *abs, int32_t value, int32_t res);
+static void get_abs_mt(int fd, const unsigned long *abs_bits,
+                       const struct input_absinfo *abs_x, const struct input_absinfo *abs_y,
+                       struct input_absinfo *abs_mt_x, struct input_absinfo *abs_mt_y);
+static void *input_thread(void *arg);
+static void input_thread_read_cb(lv_indev_t *indev, lv_indev_data_t *data);
+static void input_thread_wake_cb(int fd, uint32_t events, void *user_data);
+static void record_open(const char *path);
+static void record_close(void);
+static void record_device(int fd, const char *path);
+static void record_remove_device(int fd);
+static record_device_t *record_find_device(int fd);
+static void record_events(int id, const struct input_event *ev, int count);
+static lv_indev_t *init_replay(lv_display_t *display, const char *path);
+static int replay_load(const char *path);
+static void replay_restart(void);
+static void replay_add_device(const replay_entry_t *entry);
+static input_device_t *replay_find_device(int id);
+static void replay_read_cb(lv_indev_t *indev, lv_indev_data_t *data);
+static void replay_refr_ready_cb(lv_event_t *e);
 
 /**********************
  *  STATIC VARIABLES
@@ -49,6 +222,12 @@ static lv_indev_t *init_pointer_evdev(lv_display_t *display);
 
 static char *backend_name = "EVDEV";
 
+static input_thread_t input;
+static input_record_t record = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static input_replay_t replay;
+
+static watched_device_t watched[EVDEV_MAX_WATCHED];
+
 /**********************
  *      MACROS
  **********************/
@@ -113,6 +292,7 @@ static void discovery_cb(lv_indev_t *indev, lv_evdev_type_t type, void *user_dat
 
     lv_display_t *disp = user_data;
     lv_indev_set_display(indev, disp);
+    frame_stats_track_indev(indev);
 
     if(type == LV_EVDEV_TYPE_REL) {
         set_mouse_cursor_icon(indev, disp);
@@ -130,6 +310,12 @@ static void set_mouse_cursor_icon(lv_indev_t *indev, lv_display_t *display)
 {
     /* Set the cursor icon */
     LV_IMAGE_DECLARE(mouse_cursor_icon);
+
+    /* Moving a cursor displayed on a hardware plane doesn't invalidate the display */
+    if (driver_backends_set_hw_cursor(indev, &mouse_cursor_icon) == 0) {
+        return;
+    }
+
     lv_obj_t *cursor_obj = lv_image_create(lv_display_get_screen_active(display));
     lv_image_set_src(cursor_obj, &mouse_cursor_icon);
     lv_indev_set_cursor(indev, cursor_obj);
@@ -148,6 +334,9 @@ static void set_mouse_cursor_icon(lv_indev_t *indev, lv_display_t *display)
  *
  * If LV_LINUX_EVDEV_POINTER_DEVICE is not set, automatic evdev disovery will start
  *
+ * The raw events are recorded to LV_LINUX_EVDEV_RECORD, instead of the devices
+ * the trace LV_LINUX_EVDEV_REPLAY is replayed if set
+ *
  * @param display the LVGL display
  *
  * @return input device
@@ -155,10 +344,22 @@ static void set_mouse_cursor_icon(lv_indev_t *indev, lv_display_t *display)
 static lv_indev_t *init_pointer_evdev(lv_display_t *display)
 {
     const char *input_device = getenv("LV_LINUX_EVDEV_POINTER_DEVICE");
+    const char *replay_path = getenv("LV_LINUX_EVDEV_REPLAY");
+
+    if (replay_path != NULL) {
+        return init_replay(display, replay_path);
+    }
+
+    record_open(getenv("LV_LINUX_EVDEV_RECORD"));
+
+    if (atoi(getenv_default("LV_LINUX_EVDEV_THREAD", "0"))) {
+        return init_input_thread(display, input_device);
+    }
 
     if (input_device == NULL) {
         LV_LOG_USER("Using evdev automatic discovery.");
         lv_evdev_discovery_start(discovery_cb, display);
+        watch_input_dir(display);
         return NULL;
     }
 
@@ -169,8 +370,1264 @@ static lv_indev_t *init_pointer_evdev(lv_display_t *display)
     }
 
     lv_indev_set_display(indev, display);
+    frame_stats_track_indev(indev);
 
     set_mouse_cursor_icon(indev, display);
+    watch_input_device(input_device, display, false);
     return indev;
 }
+
+/*
+ * Wake up the run loop on input
+ *
+ * @description The LVGL evdev driver reads the device from the read timer
+ * of the indev, a second file descriptor is opened on the same device
+ * so that the run loop wakes up as soon as an event arrives.
+ * Each open file of an evdev device receives its own copy of the events,
+ * their timestamps are used to measure the input latency
+ * @param path the path of the input device
+ * @param display the display the input devices are bound to
+ * @param discovered the device was found in /dev/input, it is only kept
+ * if the LVGL evdev driver uses it
+ */
+static void watch_input_device(const char *path, lv_display_t *display, bool discovered)
+{
+    int fd;
+    int clock_id = CLOCK_MONOTONIC;
+    struct stat st;
+    watched_device_t *slot;
+
+    /* Changing the permissions of a watched device reports it again */
+    if (stat(path, &st) == -1 || find_watched_device(st.st_rdev) != NULL) {
+        return;
+    }
+
+    slot = find_watched_device(0);
+
+    if (slot == NULL) {
+        LV_LOG_WARN("Too many input devices, not watching %s", path);
+        return;
+    }
+
+    fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+    if (fd == -1) {
+        if (discovered && errno == EACCES) {
+            LV_LOG_INFO("%s not readable yet, retrying once its permissions change", path);
+        } else {
+            LV_LOG_WARN("Unable to watch input device %s: %s", path, strerror(errno));
+        }
+        return;
+    }
+
+    if (discovered && !is_discovered_device(fd)) {
+        close(fd);
+        return;
+    }
+
+    ioctl(fd, EVIOCSCLOCKID, &clock_id);
+
+    if (driver_backends_watch_fd(fd, EPOLLIN, input_device_ready_cb, display) == -1) {
+        close(fd);
+        return;
+    }
+
+    slot->fd = fd;
+    slot->rdev = st.st_rdev;
+
+    record_device(fd, path);
+}
+
+/*
+ * Find a device waking up the run loop
+ *
+ * @param rdev the device node, 0 to find a free slot
+ * @return the device, NULL if not found
+ */
+static watched_device_t *find_watched_device(dev_t rdev)
+{
+    int i;
+
+    for (i = 0; i < EVDEV_MAX_WATCHED; i++) {
+        if (watched[i].rdev == rdev) {
+            return &watched[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Check if the LVGL evdev driver creates an input device for a device
+ *
+ * @param fd the device
+ * @return true for the mice, the touchscreens and the keyboards
+ */
+static bool is_discovered_device(int fd)
+{
+    int code;
+    unsigned long rel_bits[REL_CNT / (8 * sizeof(long)) + 1];
+    unsigned long abs_bits[ABS_CNT / (8 * sizeof(long)) + 1];
+    unsigned long key_bits[KEY_CNT / (8 * sizeof(long)) + 1];
+
+    memset(rel_bits, 0, sizeof(rel_bits));
+    memset(abs_bits, 0, sizeof(abs_bits));
+    memset(key_bits, 0, sizeof(key_bits));
+
+    ioctl(fd, EVIOCGBIT(EV_REL, sizeof(rel_bits)), rel_bits);
+    ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)), abs_bits);
+    ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits);
+
+    if ((BIT_IS_SET(rel_bits, REL_X) && BIT_IS_SET(rel_bits, REL_Y)) ||
+        (BIT_IS_SET(abs_bits, ABS_X) && BIT_IS_SET(abs_bits, ABS_Y))) {
+        return true;
+    }
+
+    for (code = KEY_ESC; code < BTN_MISC; code++) {
+        if (BIT_IS_SET(key_bits, code)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+ * Wake up the run loop on input when using automatic discovery
+ *
+ * @description watches all the devices currently present in /dev/input
+ * and those that will be added later
+ * @param display the display the input devices are bound to
+ */
+static void watch_input_dir(lv_display_t *display)
+{
+    int fd;
+    DIR *dir;
+    struct dirent *entry;
+    char path[PATH_MAX];
+
+    dir = opendir(EVDEV_INPUT_DIR);
+
+    if (dir == NULL) {
+        LV_LOG_WARN("Unable to open %s: %s", EVDEV_INPUT_DIR, strerror(errno));
+        return;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "event", 5) == 0) {
+            snprintf(path, sizeof(path), "%s/%s", EVDEV_INPUT_DIR, entry->d_name);
+            watch_input_device(path, display, true);
+        }
+    }
+
+    closedir(dir);
+
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (fd == -1) {
+        LV_LOG_WARN("inotify_init1 failed: %s", strerror(errno));
+        return;
+    }
+
+    if (inotify_add_watch(fd, EVDEV_INPUT_DIR, EVDEV_INOTIFY_MASK) == -1 ||
+        driver_backends_watch_fd(fd, EPOLLIN, input_dir_changed_cb, display) == -1) {
+        LV_LOG_WARN("Unable to watch %s for new devices", EVDEV_INPUT_DIR);
+        close(fd);
+    }
+}
+
+/*
+ * Handle input events
+ *
+ * @description drains the wake up file descriptor and makes
+ * LVGL read its input devices right away
+ * @note called by the run loop
+ */
+static void input_device_ready_cb(int fd, uint32_t events, void *user_data)
+{
+    int i;
+    ssize_t n;
+    lv_indev_t *indev;
+    lv_timer_t *read_timer;
+    struct input_event in[16];
+
+    while ((n = read(fd, in, sizeof(in))) > 0) {
+
+        record_events(fd, in, n / sizeof(struct input_event));
+
+        for (i = 0; i < n / (ssize_t)sizeof(struct input_event); i++) {
+            if (in[i].type == EV_SYN && in[i].code == SYN_REPORT) {
+                frame_stats_input(user_data, (uint64_t)in[i].input_event_sec * 1000000 +
+                                  in[i].input_event_usec);
+            }
+        }
+    }
+
+    if ((n == -1 && errno != EAGAIN) || (events & (EPOLLHUP | EPOLLERR))) {
+        /* The device was removed */
+        for (i = 0; i < EVDEV_MAX_WATCHED; i++) {
+            if (watched[i].rdev != 0 && watched[i].fd == fd) {
+                watched[i].rdev = 0;
+            }
+        }
+
+        driver_backends_unwatch_fd(fd);
+        record_remove_device(fd);
+        close(fd);
+    }
+
+    adaptive_refresh_wake(user_data);
+
+    indev = lv_indev_get_next(NULL);
+
+    while (indev != NULL) {
+        read_timer = lv_indev_get_read_timer(indev);
+        if (read_timer != NULL) {
+            lv_timer_ready(read_timer);
+        }
+        indev = lv_indev_get_next(indev);
+    }
+}
+
+/*
+ * Watch newly created input devices
+ *
+ * @description the devices that couldn't be opened when they were
+ * created are opened again when their permissions change
+ * @note called by the run loop
+ */
+static void input_dir_changed_cb(int fd, uint32_t events, void *user_data)
+{
+    ssize_t n;
+    char *p;
+    char path[PATH_MAX];
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev;
+
+    LV_UNUSED(events);
+
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+
+        for (p = buf; p < buf + n; p += sizeof(struct inotify_event) + ev->len) {
+
+            ev = (const struct inotify_event *)p;
+
+            if (ev->len > 0 && strncmp(ev->name, "event", 5) == 0) {
+                snprintf(path, sizeof(path), "%s/%s", EVDEV_INPUT_DIR, ev->name);
+                watch_input_device(path, user_data, true);
+            }
+        }
+    }
+}
+
+/*
+ * Read the pointer devices from a dedicated thread
+ *
+ * @description the LVGL evdev driver only reads the devices from the
+ * read timer of the indev, so during long frames the samples are
+ * coalesced or delayed. The input thread reads every device as soon as
+ * it reports, the device given by LV_LINUX_EVDEV_POINTER_DEVICE or all
+ * the pointer devices of /dev/input including the ones plugged later.
+ * The samples are queued in a lock-free ring with their kernel
+ * timestamp, the read callback of the indev drains the ring
+ *
+ * @param display the LVGL display
+ * @param device the path of the input device, NULL to use all devices
+ * @return the input device, NULL on error
+ */
+static lv_indev_t *init_input_thread(lv_display_t *display, const char *device)
+{
+    int i;
+    int ret;
+    DIR *dir;
+    struct dirent *entry;
+    char path[PATH_MAX];
+    struct epoll_event ev;
+    pthread_attr_t attr;
+
+    for (i = 0; i < INPUT_THREAD_MAX_DEVICES; i++) {
+        input.devices[i].fd = -1;
+    }
+
+    input.display = display;
+    input.width = lv_display_get_horizontal_resolution(display);
+    input.height = lv_display_get_vertical_resolution(display);
+    input.inotify_fd = -1;
+
+    input.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    input.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (input.epoll_fd == -1 || input.wake_fd == -1) {
+        LV_LOG_ERROR("Failed to setup the input thread: %s", strerror(errno));
+        return NULL;
+    }
+
+    if (device != NULL) {
+        input_thread_add_device(device);
+    } else {
+        input.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+        if (input.inotify_fd != -1 &&
+            inotify_add_watch(input.inotify_fd, EVDEV_INPUT_DIR, EVDEV_INOTIFY_MASK) != -1) {
+            ev.events = EPOLLIN;
+            ev.data.ptr = NULL;
+            epoll_ctl(input.epoll_fd, EPOLL_CTL_ADD, input.inotify_fd, &ev);
+        } else {
+            LV_LOG_WARN("Unable to watch %s for new devices", EVDEV_INPUT_DIR);
+        }
+
+        dir = opendir(EVDEV_INPUT_DIR);
+
+        while (dir != NULL && (entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, "event", 5) == 0) {
+                snprintf(path, sizeof(path), "%s/%s", EVDEV_INPUT_DIR, entry->d_name);
+                input_thread_add_device(path);
+            }
+        }
+
+        if (dir != NULL) {
+            closedir(dir);
+        }
+    }
+
+    input.indev = lv_indev_create();
+    lv_indev_set_type(input.indev, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_read_cb(input.indev, input_thread_read_cb);
+    lv_indev_set_display(input.indev, display);
+    frame_stats_track_indev(input.indev);
+
+    if (driver_backends_watch_fd(input.wake_fd, EPOLLIN, input_thread_wake_cb, NULL) == -1) {
+        lv_indev_delete(input.indev);
+        return NULL;
+    }
+
+    thread_sched_init_helper_attr(&attr);
+    ret = pthread_create(&input.thread, &attr, input_thread, NULL);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0) {
+        LV_LOG_ERROR("Failed to create the input thread: %s", strerror(ret));
+        driver_backends_unwatch_fd(input.wake_fd);
+        lv_indev_delete(input.indev);
+        return NULL;
+    }
+
+    thread_sched_apply(THREAD_SCHED_INPUT, input.thread);
+
+    LV_LOG_USER("Reading input devices from the input thread");
+    return input.indev;
+}
+
+/*
+ * Add a device to the input thread
+ *
+ * @description only the pointer devices are kept, the kernel
+ * timestamps of the device are switched to the monotonic clock.
+ * A device that is already read is ignored, changing its permissions
+ * reports it again
+ * @param path the path of the input device
+ */
+static void input_thread_add_device(const char *path)
+{
+    int i;
+    int clock_id = CLOCK_MONOTONIC;
+    struct stat st;
+    unsigned long rel_bits[REL_CNT / (8 * sizeof(long)) + 1];
+    unsigned long abs_bits[ABS_CNT / (8 * sizeof(long)) + 1];
+    input_device_t *dev = NULL;
+    struct epoll_event ev;
+
+    if (stat(path, &st) == -1) {
+        return;
+    }
+
+    for (i = 0; i < INPUT_THREAD_MAX_DEVICES; i++) {
+        if (input.devices[i].fd != -1 && input.devices[i].rdev == st.st_rdev) {
+            return;
+        }
+    }
+
+    for (i = 0; i < INPUT_THREAD_MAX_DEVICES; i++) {
+        if (input.devices[i].fd == -1) {
+            dev = &input.devices[i];
+            break;
+        }
+    }
+
+    if (dev == NULL) {
+        LV_LOG_WARN("Too many input devices, ignoring %s", path);
+        return;
+    }
+
+    memset(dev, 0, sizeof(*dev));
+    memset(rel_bits, 0, sizeof(rel_bits));
+    memset(abs_bits, 0, sizeof(abs_bits));
+
+    dev->rdev = st.st_rdev;
+    dev->fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+    if (dev->fd == -1) {
+        if (errno == EACCES) {
+            LV_LOG_INFO("%s not readable yet, retrying once its permissions change", path);
+        } else {
+            LV_LOG_WARN("Unable to open input device %s: %s", path, strerror(errno));
+        }
+        return;
+    }
+
+    ioctl(dev->fd, EVIOCGBIT(EV_REL, sizeof(rel_bits)), rel_bits);
+    ioctl(dev->fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)), abs_bits);
+
+    if (BIT_IS_SET(abs_bits, ABS_X) && BIT_IS_SET(abs_bits, ABS_Y)) {
+        ioctl(dev->fd, EVIOCGABS(ABS_X), &dev->abs_x);
+        ioctl(dev->fd, EVIOCGABS(ABS_Y), &dev->abs_y);
+        get_abs_mt(dev->fd, abs_bits, &dev->abs_x, &dev->abs_y, &dev->abs_mt_x, &dev->abs_mt_y);
+    } else if (BIT_IS_SET(rel_bits, REL_X) && BIT_IS_SET(rel_bits, REL_Y)) {
+        dev->relative = true;
+    } else {
+        /* Not a pointer device */
+        close(dev->fd);
+        dev->fd = -1;
+        return;
+    }
+
+    if (ioctl(dev->fd, EVIOCSCLOCKID, &clock_id) == -1) {
+        LV_LOG_WARN("Unable to use the monotonic clock for %s", path);
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = dev;
+
+    if (epoll_ctl(input.epoll_fd, EPOLL_CTL_ADD, dev->fd, &ev) == -1) {
+        close(dev->fd);
+        dev->fd = -1;
+        return;
+    }
+
+    if (dev->relative) {
+        __atomic_store_n(&input.has_relative, true, __ATOMIC_RELEASE);
+    }
+
+    record_device(dev->fd, path);
+
+    LV_LOG_USER("input thread: new '%s' device %s", dev->relative ? "REL" : "ABS", path);
+}
+
+/*
+ * Read the events of a device
+ *
+ * @param dev the device
+ */
+static void input_thread_read_device(input_device_t *dev)
+{
+    int i;
+    ssize_t n;
+    struct input_event in[64];
+
+    while ((n = read(dev->fd, in, sizeof(in))) > 0) {
+
+        record_events(dev->fd, in, n / sizeof(struct input_event));
+
+        for (i = 0; i < n / (ssize_t)sizeof(struct input_event); i++) {
+            if (decode_event(dev, &in[i])) {
+                input_thread_push(dev, &in[i]);
+            }
+        }
+    }
+
+    if (n == -1 && errno != EAGAIN) {
+        /* The device was removed, closing the fd removes it from the epoll set */
+        record_remove_device(dev->fd);
+        close(dev->fd);
+        dev->fd = -1;
+    }
+}
+
+/*
+ * Decode an event of a pointer device
+ *
+ * @description updates the state of the device, the position of the
+ * mouse pointer is shared by all the relative devices
+ * @param dev the device that reported
+ * @param ev the event
+ * @return true on a SYN_REPORT after a change of the state
+ */
+static bool decode_event(input_device_t *dev, const struct input_event *ev)
+{
+    switch (ev->type) {
+    case EV_REL:
+        if (ev->code == REL_X) {
+            input.rel_x = LV_CLAMP(0, input.rel_x + ev->value, input.width - 1);
+            dev->dirty = true;
+        } else if (ev->code == REL_Y) {
+            input.rel_y = LV_CLAMP(0, input.rel_y + ev->value, input.height - 1);
+            dev->dirty = true;
+        }
+        break;
+    case EV_ABS:
+        if (ev->code == ABS_X) {
+            dev->x = scale_abs(&dev->abs_x, ev->value, input.width);
+            dev->dirty = true;
+        } else if (ev->code == ABS_Y) {
+            dev->y = scale_abs(&dev->abs_y, ev->value, input.height);
+            dev->dirty = true;
+        } else if (ev->code == ABS_MT_POSITION_X) {
+            dev->x = scale_abs(&dev->abs_mt_x, ev->value, input.width);
+            dev->dirty = true;
+        } else if (ev->code == ABS_MT_POSITION_Y) {
+            dev->y = scale_abs(&dev->abs_mt_y, ev->value, input.height);
+            dev->dirty = true;
+        }
+        break;
+    case EV_KEY:
+        if (ev->code == BTN_LEFT || ev->code == BTN_TOUCH) {
+            dev->pressed = ev->value != 0;
+            dev->dirty = true;
+        }
+        break;
+    case EV_SYN:
+        if (ev->code == SYN_REPORT && dev->dirty) {
+            dev->dirty = false;
+            return true;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return false;
+}
+
+/*
+ * Build the sample of a report
+ *
+ * @param dev the device that reported
+ * @param timestamp_us the timestamp of the report
+ * @param sample set to the state of the device
+ */
+static void make_sample(input_device_t *dev, uint64_t timestamp_us, input_sample_t *sample)
+{
+    sample->timestamp_us = timestamp_us;
+    sample->pressed = dev->pressed;
+
+    if (dev->relative) {
+        sample->x = input.rel_x;
+        sample->y = input.rel_y;
+    } else {
+        sample->x = dev->x;
+        sample->y = dev->y;
+    }
+}
+
+/*
+ * Queue a sample for LVGL
+ *
+ * @description the sample is dropped if LVGL lags too much behind
+ * @param dev the device that reported
+ * @param ev the SYN_REPORT event
+ */
+static void input_thread_push(input_device_t *dev, const struct input_event *ev)
+{
+    uint64_t one = 1;
+    input_sample_t *sample;
+    uint32_t tail = __atomic_load_n(&input.tail, __ATOMIC_ACQUIRE);
+
+    if (input.head - tail == INPUT_RING_SIZE) {
+        __atomic_store_n(&input.dropped, input.dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    sample = &input.ring[input.head & (INPUT_RING_SIZE - 1)];
+    make_sample(dev, (uint64_t)ev->input_event_sec * 1000000 + ev->input_event_usec, sample);
+
+    __atomic_store_n(&input.head, input.head + 1, __ATOMIC_RELEASE);
+
+    if (write(input.wake_fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+        LV_LOG_WARN("Failed to wake up the run loop: %s", strerror(errno));
+    }
+}
+
+/*
+ * Scale an absolute coordinate to the resolution of the display
+ *
+ * @param abs the range of the axis
+ * @param value the coordinate
+ * @param res the resolution of the display on this axis
+ * @return the coordinate on the display
+ */
+static int32_t scale_abs(const struct input_absinfo *abs, int32_t value, int32_t res)
+{
+    if (abs->maximum <= abs->minimum) {
+        return value;
+    }
+
+    return (int64_t)(value - abs->minimum) * res / (abs->maximum - abs->minimum + 1);
+}
+
+/*
+ * Get the range of the multitouch axes of an absolute device
+ *
+ * @description the multitouch axes can have another range than
+ * ABS_X and ABS_Y, the range of those is used if the device has none
+ * @param fd the device
+ * @param abs_bits the absolute axes of the device
+ * @param abs_x the range of ABS_X
+ * @param abs_y the range of ABS_Y
+ * @param abs_mt_x set to the range of ABS_MT_POSITION_X
+ * @param abs_mt_y set to the range of ABS_MT_POSITION_Y
+ */
+static void get_abs_mt(int fd, const unsigned long *abs_bits,
+                       const struct input_absinfo *abs_x, const struct input_absinfo *abs_y,
+                       struct input_absinfo *abs_mt_x, struct input_absinfo *abs_mt_y)
+{
+    *abs_mt_x = *abs_x;
+    *abs_mt_y = *abs_y;
+
+    if (BIT_IS_SET(abs_bits, ABS_MT_POSITION_X) && BIT_IS_SET(abs_bits, ABS_MT_POSITION_Y)) {
+        ioctl(fd, EVIOCGABS(ABS_MT_POSITION_X), abs_mt_x);
+        ioctl(fd, EVIOCGABS(ABS_MT_POSITION_Y), abs_mt_y);
+    }
+}
+
+/*
+ * The input thread
+ *
+ * @description only uses the log functions of LVGL, which are thread
+ * safe with LV_USE_OS, it communicates with the LVGL thread through the
+ * ring and the eventfd
+ */
+static void *input_thread(void *arg)
+{
+    int i;
+    int n;
+    ssize_t len;
+    char *p;
+    char path[PATH_MAX];
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *iev;
+    struct epoll_event events[INPUT_THREAD_MAX_DEVICES];
+
+    LV_UNUSED(arg);
+
+    while (1) {
+        n = epoll_wait(input.epoll_fd, events, INPUT_THREAD_MAX_DEVICES, -1);
+
+        if (n == -1 && errno != EINTR) {
+            LV_LOG_ERROR("Input thread epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+
+        for (i = 0; i < n; i++) {
+
+            if (events[i].data.ptr != NULL) {
+                input_thread_read_device(events[i].data.ptr);
+                continue;
+            }
+
+            while ((len = read(input.inotify_fd, buf, sizeof(buf))) > 0) {
+                for (p = buf; p < buf + len; p += sizeof(struct inotify_event) + iev->len) {
+                    iev = (const struct inotify_event *)p;
+
+                    if (iev->len > 0 && strncmp(iev->name, "event", 5) == 0) {
+                        snprintf(path, sizeof(path), "%s/%s", EVDEV_INPUT_DIR, iev->name);
+                        input_thread_add_device(path);
+                    }
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Drain the samples queued by the input thread
+ *
+ * @description every sample is handed to LVGL, continue_reading makes
+ * LVGL process the next one in the same read. The samples dropped since
+ * the last read are reported
+ * @note called by LVGL from the read timer of the indev
+ */
+static void input_thread_read_cb(lv_indev_t *indev, lv_indev_data_t *data)
+{
+    uint32_t head = __atomic_load_n(&input.head, __ATOMIC_ACQUIRE);
+    uint32_t dropped = __atomic_load_n(&input.dropped, __ATOMIC_RELAXED);
+
+    LV_UNUSED(indev);
+
+    if (dropped != input.dropped_reported) {
+        LV_LOG_WARN("%" PRIu32 " input samples dropped, %" PRIu32 " in total",
+                    dropped - input.dropped_reported, dropped);
+        input.dropped_reported = dropped;
+    }
+
+    if (input.tail != head) {
+        input.last = input.ring[input.tail & (INPUT_RING_SIZE - 1)];
+        __atomic_store_n(&input.tail, input.tail + 1, __ATOMIC_RELEASE);
+        data->continue_reading = input.tail != head;
+        frame_stats_input(input.display, input.last.timestamp_us);
+    }
+
+    data->point.x = input.last.x;
+    data->point.y = input.last.y;
+    data->state = input.last.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+}
+
+/*
+ * Read the queued samples right away
+ *
+ * @description sets the mouse cursor once a mouse is found
+ * @note called by the run loop when the input thread queued samples
+ */
+static void input_thread_wake_cb(int fd, uint32_t events, void *user_data)
+{
+    uint64_t count;
+
+    LV_UNUSED(events);
+    LV_UNUSED(user_data);
+
+    if (read(fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+        LV_LOG_WARN("Failed to read the input thread eventfd: %s", strerror(errno));
+    }
+
+    if (!input.cursor_set && __atomic_load_n(&input.has_relative, __ATOMIC_ACQUIRE)) {
+        set_mouse_cursor_icon(input.indev, input.display);
+        input.cursor_set = true;
+    }
+
+    adaptive_refresh_wake(input.display);
+    lv_timer_ready(lv_indev_get_read_timer(input.indev));
+}
+/*
+ * Start recording the raw events of the devices
+ *
+ * @description the trace is a text file, a line per device and per
+ * event with the time since the start of the recording
+ * @param path the trace file, NULL to not record
+ */
+static void record_open(const char *path)
+{
+    struct timespec ts;
+
+    if (path == NULL) {
+        return;
+    }
+
+    record.fp = fopen(path, "w");
+
+    if (record.fp == NULL) {
+        LV_LOG_ERROR("Unable to open %s: %s", path, strerror(errno));
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    record.start_us = (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+    fprintf(record.fp, "%s %d\n", INPUT_TRACE_HEADER, INPUT_TRACE_VERSION);
+    fprintf(record.fp, "# D id rel|abs x_min x_max y_min y_max mt_x_min mt_x_max mt_y_min mt_y_max path\n");
+    fprintf(record.fp, "# E id time_us type code value\n");
+
+    atexit(record_close);
+    LV_LOG_USER("Recording the input events to %s", path);
+}
+
+/*
+ * Stop recording
+ *
+ * @note called at exit
+ */
+static void record_close(void)
+{
+    pthread_mutex_lock(&record.lock);
+
+    fclose(record.fp);
+    record.fp = NULL;
+
+    pthread_mutex_unlock(&record.lock);
+}
+
+/*
+ * Record a device
+ *
+ * @description only the pointer devices are recorded, the events of the
+ * keyboards and the other devices can't be replayed and must not end up
+ * in the trace. The device gets a new id, the file descriptor may
+ * have been used by a removed device. The range of the absolute axes is
+ * recorded so that the trace can be replayed on a display of another
+ * resolution
+ * @param fd the file descriptor the events of the device are read from
+ * @param path the path of the device
+ */
+static void record_device(int fd, const char *path)
+{
+    int i;
+    record_device_t *dev;
+    const char *type = NULL;
+    unsigned long rel_bits[REL_CNT / (8 * sizeof(long)) + 1];
+    unsigned long abs_bits[ABS_CNT / (8 * sizeof(long)) + 1];
+    struct input_absinfo abs_x;
+    struct input_absinfo abs_y;
+    struct input_absinfo abs_mt_x;
+    struct input_absinfo abs_mt_y;
+
+    if (record.fp == NULL) {
+        return;
+    }
+
+    memset(rel_bits, 0, sizeof(rel_bits));
+    memset(abs_bits, 0, sizeof(abs_bits));
+    memset(&abs_x, 0, sizeof(abs_x));
+    memset(&abs_y, 0, sizeof(abs_y));
+    memset(&abs_mt_x, 0, sizeof(abs_mt_x));
+    memset(&abs_mt_y, 0, sizeof(abs_mt_y));
+
+    ioctl(fd, EVIOCGBIT(EV_REL, sizeof(rel_bits)), rel_bits);
+    ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)), abs_bits);
+
+    if (BIT_IS_SET(abs_bits, ABS_X) && BIT_IS_SET(abs_bits, ABS_Y)) {
+        ioctl(fd, EVIOCGABS(ABS_X), &abs_x);
+        ioctl(fd, EVIOCGABS(ABS_Y), &abs_y);
+        get_abs_mt(fd, abs_bits, &abs_x, &abs_y, &abs_mt_x, &abs_mt_y);
+        type = "abs";
+    } else if (BIT_IS_SET(rel_bits, REL_X) && BIT_IS_SET(rel_bits, REL_Y)) {
+        type = "rel";
+    }
+
+    record_remove_device(fd);
+
+    if (type == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&record.lock);
+
+    dev = NULL;
+    for (i = 0; dev == NULL && i < INPUT_TRACE_MAX_DEVICES; i++) {
+        if (record.devices[i].id == 0) {
+            dev = &record.devices[i];
+        }
+    }
+
+    if (dev == NULL) {
+        LV_LOG_WARN("Too many recorded input devices, not recording %s", path);
+    } else if (record.fp != NULL) {
+        dev->fd = fd;
+        dev->id = ++record.last_id;
+        fprintf(record.fp, "D %d %s %d %d %d %d %d %d %d %d %s\n", dev->id, type,
+                abs_x.minimum, abs_x.maximum, abs_y.minimum, abs_y.maximum,
+                abs_mt_x.minimum, abs_mt_x.maximum, abs_mt_y.minimum, abs_mt_y.maximum, path);
+    }
+
+    pthread_mutex_unlock(&record.lock);
+}
+
+/*
+ * Stop recording a device
+ *
+ * @param fd the file descriptor the events of the device were read from
+ */
+static void record_remove_device(int fd)
+{
+    record_device_t *dev;
+
+    if (record.fp == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&record.lock);
+
+    dev = record_find_device(fd);
+    if (dev != NULL) {
+        dev->id = 0;
+    }
+
+    pthread_mutex_unlock(&record.lock);
+}
+
+/*
+ * Find a recorded device
+ *
+ * @note the lock of the recording must be held
+ * @param fd the file descriptor the events of the device are read from
+ * @return the device, NULL if the device isn't recorded
+ */
+static record_device_t *record_find_device(int fd)
+{
+    int i;
+
+    for (i = 0; i < INPUT_TRACE_MAX_DEVICES; i++) {
+        if (record.devices[i].id != 0 && record.devices[i].fd == fd) {
+            return &record.devices[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Record the events read from a device
+ *
+ * @description the events of the devices that aren't recorded are
+ * ignored, as well as the keyboard keys of a pointer device
+ * @param fd the file descriptor the events were read from
+ * @param ev the events
+ * @param count the number of events
+ */
+static void record_events(int fd, const struct input_event *ev, int count)
+{
+    int i;
+    uint64_t time_us;
+    record_device_t *dev;
+
+    if (record.fp == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&record.lock);
+
+    dev = record_find_device(fd);
+
+    for (i = 0; dev != NULL && i < count && record.fp != NULL; i++) {
+
+        if (ev[i].type == EV_KEY && ev[i].code < BTN_MISC) {
+            continue;
+        }
+
+        time_us = (uint64_t)ev[i].input_event_sec * 1000000 + ev[i].input_event_usec;
+
+        /* Queued before the start of the recording */
+        time_us = time_us > record.start_us ? time_us - record.start_us : 0;
+
+        fprintf(record.fp, "E %d %llu %u %u %d\n", dev->id, (unsigned long long)time_us,
+                ev[i].type, ev[i].code, ev[i].value);
+    }
+
+    pthread_mutex_unlock(&record.lock);
+}
+
+/*
+ * Replay a trace through a virtual input device
+ *
+ * @description the events are decoded like the ones of the input thread,
+ * on the LVGL thread and at the time given by lv_tick_get(), so that a
+ * replay on the headless backend with LV_SIM_HEADLESS_TICK is
+ * deterministic. LV_LINUX_EVDEV_REPLAY_SPEED scales the original timing,
+ * 0 delivers one sample per frame as fast as the display refreshes.
+ * With LV_LINUX_EVDEV_REPLAY_LOOP the trace restarts once finished
+ *
+ * @param display the LVGL display
+ * @param path the trace file
+ * @return the input device, NULL on error
+ */
+static lv_indev_t *init_replay(lv_display_t *display, const char *path)
+{
+    int i;
+
+    replay.speed = atof(getenv_default("LV_LINUX_EVDEV_REPLAY_SPEED", "1"));
+    replay.loop = atoi(getenv_default("LV_LINUX_EVDEV_REPLAY_LOOP", "0")) != 0;
+
+    if (replay.speed < 0) {
+        LV_LOG_ERROR("Invalid replay speed: %f", replay.speed);
+        return NULL;
+    }
+
+    if (replay_load(path) == -1) {
+        return NULL;
+    }
+
+    input.display = display;
+    input.width = lv_display_get_horizontal_resolution(display);
+    input.height = lv_display_get_vertical_resolution(display);
+
+    input.indev = lv_indev_create();
+    lv_indev_set_type(input.indev, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_read_cb(input.indev, replay_read_cb);
+    lv_indev_set_display(input.indev, display);
+
+    replay.read_timer = lv_indev_get_read_timer(input.indev);
+
+    if (replay.speed == 0) {
+        lv_display_add_event_cb(display, replay_refr_ready_cb, LV_EVENT_REFR_READY, NULL);
+    }
+
+    for (i = 0; i < (int)replay.count; i++) {
+        if (replay.entries[i].is_device && replay.entries[i].relative) {
+            set_mouse_cursor_icon(input.indev, display);
+            break;
+        }
+    }
+
+    replay_restart();
+
+    LV_LOG_USER("Replaying %u input events from %s", replay.count, path);
+    return input.indev;
+}
+
+/*
+ * Load a trace
+ *
+ * @param path the trace file
+ * @return 0 on success, -1 on error
+ */
+static int replay_load(const char *path)
+{
+    FILE *fp;
+    int version;
+    int line_no = 0;
+    int ret = 0;
+    char line[PATH_MAX + 128];
+    char type[8];
+    unsigned int ev_type;
+    unsigned int ev_code;
+    unsigned long long time_us;
+    uint32_t size = 0;
+    replay_entry_t *entry;
+
+    fp = fopen(path, "r");
+
+    if (fp == NULL) {
+        LV_LOG_ERROR("Unable to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    if (fgets(line, sizeof(line), fp) == NULL ||
+        strncmp(line, INPUT_TRACE_HEADER, strlen(INPUT_TRACE_HEADER)) != 0) {
+        LV_LOG_ERROR("%s is not an input trace", path);
+        fclose(fp);
+        return -1;
+    }
+
+    if (sscanf(line + strlen(INPUT_TRACE_HEADER), "%d", &version) != 1 ||
+        version != INPUT_TRACE_VERSION) {
+        LV_LOG_ERROR("%s: unsupported trace version, expected %d", path, INPUT_TRACE_VERSION);
+        fclose(fp);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+
+        line_no++;
+
+        /* Comments */
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        if (line[0] != 'D' && line[0] != 'E') {
+            ret = -1;
+            break;
+        }
+
+        if (replay.count == size) {
+            size = size == 0 ? 1024 : size * 2;
+            replay.entries = realloc(replay.entries, size * sizeof(replay_entry_t));
+            LV_ASSERT_NULL(replay.entries);
+        }
+
+        entry = &replay.entries[replay.count];
+        memset(entry, 0, sizeof(*entry));
+
+        if (line[0] == 'D') {
+            entry->is_device = true;
+
+            if (sscanf(line, "D %d %7s %d %d %d %d %d %d %d %d", &entry->id, type,
+                       &entry->abs_x.minimum, &entry->abs_x.maximum,
+                       &entry->abs_y.minimum, &entry->abs_y.maximum,
+                       &entry->abs_mt_x.minimum, &entry->abs_mt_x.maximum,
+                       &entry->abs_mt_y.minimum, &entry->abs_mt_y.maximum) != 10 ||
+                (strcmp(type, "rel") != 0 && strcmp(type, "abs") != 0)) {
+                ret = -1;
+                break;
+            }
+
+            entry->relative = strcmp(type, "rel") == 0;
+        } else {
+            if (sscanf(line, "E %d %llu %u %u %d", &entry->id, &time_us,
+                       &ev_type, &ev_code, &entry->ev.value) != 5) {
+                ret = -1;
+                break;
+            }
+
+            entry->time_us = time_us;
+            entry->ev.type = ev_type;
+            entry->ev.code = ev_code;
+        }
+
+        replay.count++;
+    }
+
+    fclose(fp);
+
+    if (ret == -1) {
+        LV_LOG_ERROR("%s:%d: invalid line", path, line_no + 1);
+    }
+
+    return ret;
+}
+
+/*
+ * Replay the trace from the start
+ */
+static void replay_restart(void)
+{
+    int i;
+
+    for (i = 0; i < INPUT_THREAD_MAX_DEVICES; i++) {
+        input.devices[i].fd = -1;
+    }
+
+    input.rel_x = 0;
+    input.rel_y = 0;
+    memset(&input.last, 0, sizeof(input.last));
+
+    replay.next = 0;
+    replay.samples = 0;
+    replay.finished = false;
+    replay.start = lv_tick_get();
+
+    /* As fast as possible, the read timer is made ready after each frame */
+    lv_timer_set_period(replay.read_timer, replay.speed > 0 ? 1 : LV_DEF_REFR_PERIOD);
+    lv_timer_ready(replay.read_timer);
+}
+
+/*
+ * Find a device of the trace
+ *
+ * @param id the id of the device in the trace
+ * @return the device, NULL if it wasn't recorded as a pointer device
+ */
+static input_device_t *replay_find_device(int id)
+{
+    int i;
+
+    for (i = 0; i < INPUT_THREAD_MAX_DEVICES; i++) {
+        if (input.devices[i].fd == id) {
+            return &input.devices[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Add a device of the trace
+ *
+ * @description the ids are unique in a trace, the id of the device
+ * takes the place of the file descriptor
+ * @param entry the device entry of the trace
+ */
+static void replay_add_device(const replay_entry_t *entry)
+{
+    int i;
+    input_device_t *dev = NULL;
+
+    for (i = 0; dev == NULL && i < INPUT_THREAD_MAX_DEVICES; i++) {
+        if (input.devices[i].fd == -1) {
+            dev = &input.devices[i];
+        }
+    }
+
+    if (dev == NULL) {
+        LV_LOG_WARN("Too many input devices in the trace, ignoring device %d", entry->id);
+        return;
+    }
+
+    memset(dev, 0, sizeof(*dev));
+    dev->fd = entry->id;
+    dev->relative = entry->relative;
+    dev->abs_x = entry->abs_x;
+    dev->abs_y = entry->abs_y;
+    dev->abs_mt_x = entry->abs_mt_x;
+    dev->abs_mt_y = entry->abs_mt_y;
+}
+
+/*
+ * Deliver the samples of the trace that are due
+ *
+ * @description with the original timing, all the samples due are handed
+ * to LVGL with continue_reading and the read timer is set to expire
+ * at the time of the next event
+ * @note called by LVGL from the read timer of the indev
+ */
+static void replay_read_cb(lv_indev_t *indev, lv_indev_data_t *data)
+{
+    uint64_t now_us = 0;
+    uint64_t delay_us;
+    replay_entry_t *entry;
+    input_device_t *dev;
+
+    LV_UNUSED(indev);
+
+    if (replay.speed > 0) {
+        now_us = (uint64_t)(lv_tick_elaps(replay.start) * 1000.0 * replay.speed);
+    }
+
+    while (replay.next < replay.count) {
+
+        entry = &replay.entries[replay.next];
+
+        if (replay.speed > 0 && entry->time_us > now_us) {
+            break;
+        }
+
+        replay.next++;
+
+        if (entry->is_device) {
+            replay_add_device(entry);
+            continue;
+        }
+
+        dev = replay_find_device(entry->id);
+
+        if (dev != NULL && decode_event(dev, &entry->ev)) {
+            make_sample(dev, entry->time_us, &input.last);
+            replay.samples++;
+
+            /* One sample per frame when replaying as fast as possible */
+            data->continue_reading = replay.speed > 0;
+            break;
+        }
+    }
+
+    data->point.x = input.last.x;
+    data->point.y = input.last.y;
+    data->state = input.last.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+
+    if (replay.next < replay.count) {
+
+        if (replay.speed > 0 && !data->continue_reading) {
+            delay_us = (replay.entries[replay.next].time_us - now_us) / replay.speed;
+            lv_timer_set_period(replay.read_timer, LV_MAX(1, delay_us / 1000));
+        }
+
+        return;
+    }
+
+    if (!replay.finished && !data->continue_reading) {
+        replay.finished = true;
+        LV_LOG_USER("Input replay finished: %u samples in %u ms",
+                    replay.samples, lv_tick_elaps(replay.start));
+
+        if (replay.loop) {
+            replay_restart();
+        } else {
+            lv_timer_set_period(replay.read_timer, LV_DEF_REFR_PERIOD);
+        }
+    }
+}
+
+/*
+ * Deliver the next sample of the trace
+ *
+ * @description used when replaying as fast as possible
+ * @note called by LVGL once a frame is rendered
+ */
+static void replay_refr_ready_cb(lv_event_t *e)
+{
+    LV_UNUSED(e);
+
+    if (replay.next < replay.count) {
+        lv_timer_ready(replay.read_timer);
+    }
+}
 #endif /*#if LV_USE_EVDEV*/
@@ -0,0 +1,205 @@
+/**
+ * @file mem_heap.c
+ *
+ * Memory mapped heap for the builtin LVGL allocator
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+#include "lvgl/lvgl.h"
+
+#include "simulator_util.h"
+#include "driver_backends.h"
+#include "mem_heap.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* The size of the mapping is rounded to the size of a huge page */
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
+static void *map_region(size_t size, bool hugepages);
+#endif
+static void print_signal_cb(int signum, void *user_data);
+static void print_at_exit(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
+static void *region;
+static size_t region_size;
+#endif
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int mem_heap_init(void)
+{
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
+    const char *env_size = getenv("LV_SIM_HEAP_SIZE");
+    size_t size = env_size != NULL ? (size_t)atoi(env_size) : MEM_HEAP_DEFAULT_SIZE;
+    bool hugepages = atoi(getenv_default("LV_SIM_HEAP_HUGEPAGES", "0"));
+
+    if (size == 0) {
+        return 0;
+    }
+
+    size = (size * 1024 * 1024 + HUGE_PAGE_SIZE - 1) & ~((size_t)HUGE_PAGE_SIZE - 1);
+    region = map_region(size, hugepages);
+
+    if (region == NULL) {
+        return -1;
+    }
+
+    region_size = size;
+
+    if (lv_mem_add_pool(region, region_size) == NULL) {
+        LV_LOG_ERROR("Failed to add the mapped region to the heap");
+        munmap(region, region_size);
+        region = NULL;
+        return -1;
+    }
+
+    LV_LOG_INFO("Heap of %zu MB mapped", region_size / (1024 * 1024));
+    return 0;
+#else
+    if (getenv("LV_SIM_HEAP_SIZE") != NULL) {
+        LV_LOG_WARN("LV_SIM_HEAP_SIZE requires LV_LINUX_HEAP, using the C library heap");
+    }
+
+    return 0;
+#endif
+}
+
+void mem_heap_enable_report(void)
+{
+    static bool enabled;
+
+    if (enabled) {
+        return;
+    }
+
+    driver_backends_watch_signal(SIGUSR2, print_signal_cb, NULL);
+    atexit(print_at_exit);
+    enabled = true;
+}
+
+void mem_heap_print(FILE *fp)
+{
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
+    lv_mem_monitor_t mon;
+
+    lv_mem_monitor(&mon);
+
+    fprintf(fp, "Heap statistics\n");
+    fprintf(fp, "%10s %10s %10s %10s %10s %10s %8s\n",
+            "total_kb", "used_kb", "peak_kb", "free_kb", "biggest_kb", "blocks", "frag_pct");
+    fprintf(fp, "%10zu %10zu %10zu %10zu %10zu %10u %8u\n",
+            mon.total_size / 1024,
+            (mon.total_size - mon.free_size) / 1024,
+            mon.max_used / 1024,
+            mon.free_size / 1024,
+            mon.free_biggest_size / 1024,
+            (unsigned int)mon.used_cnt,
+            (unsigned int)mon.frag_pct);
+#else
+    fprintf(fp, "Heap statistics require LV_LINUX_HEAP\n");
+#endif
+    fflush(fp);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
+/**
+ * Map the region of the heap
+ *
+ * @description with huge pages, explicit huge pages are tried first
+ * (they must be reserved with /proc/sys/vm/nr_hugepages) then
+ * transparent huge pages. Either way the TLB covers the heap with
+ * few entries and the region is faulted in 2 MB at a time
+ *
+ * @param size the size of the region, a multiple of HUGE_PAGE_SIZE
+ * @param hugepages back the region with huge pages
+ * @return the region, NULL on error
+ */
+static void *map_region(size_t size, bool hugepages)
+{
+    void *p = MAP_FAILED;
+
+    if (hugepages) {
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (p == MAP_FAILED) {
+            LV_LOG_WARN("No huge pages reserved - using transparent huge pages");
+        }
+    }
+
+    if (p == MAP_FAILED) {
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (p == MAP_FAILED) {
+            LV_LOG_ERROR("Failed to map the heap: %s", strerror(errno));
+            return NULL;
+        }
+
+        if (hugepages && madvise(p, size, MADV_HUGEPAGE) == -1) {
+            LV_LOG_WARN("Transparent huge pages unavailable: %s", strerror(errno));
+        }
+    }
+
+    return p;
+}
+#endif
+
+/**
+ * Print the usage of the heap on SIGUSR2
+ *
+ * @note called by the run loop
+ */
+static void print_signal_cb(int signum, void *user_data)
+{
+    LV_UNUSED(signum);
+    LV_UNUSED(user_data);
+
+    mem_heap_print(stdout);
+}
+
+/**
+ * Print the usage of the heap when the program exits
+ */
+static void print_at_exit(void)
+{
+    mem_heap_print(stdout);
+}
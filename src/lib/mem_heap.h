@@ -0,0 +1,73 @@
+/**
+ * @file mem_heap.h
+ *
+ * Memory mapped heap for the builtin LVGL allocator
+ *
+ * When LVGL uses its builtin TLSF allocator (LV_LINUX_HEAP), a large
+ * region optionally backed by huge pages is mapped at startup and added
+ * to the heap. This avoids fragmenting the heap of the C library and
+ * gives a fixed ceiling to the memory used by LVGL.
+ * The usage of the heap can be printed when SIGUSR2 is received and at exit
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef MEM_HEAP_H
+#define MEM_HEAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdio.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Size of the mapped region in MB if LV_SIM_HEAP_SIZE is not set */
+#define MEM_HEAP_DEFAULT_SIZE 32
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Map the heap region and add it to the LVGL allocator
+ * @description must be called right after lv_init. Configured with
+ * LV_SIM_HEAP_SIZE (MB) and LV_SIM_HEAP_HUGEPAGES, does nothing if
+ * LVGL doesn't use its builtin allocator
+ *
+ * @return 0 on success, -1 on error
+ */
+int mem_heap_init(void);
+
+/**
+ * @brief Print the usage of the heap on SIGUSR2 and at exit
+ * @description can be called multiple times
+ */
+void mem_heap_enable_report(void);
+
+/**
+ * @brief Print the current and peak usage and the fragmentation of the heap
+ * @param fp the output file
+ */
+void mem_heap_print(FILE *fp);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*MEM_HEAP_H*/
@@ -0,0 +1,389 @@
+/**
+ * @file mmap_fs.c
+ *
+ * Memory mapped file system driver
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lvgl/lvgl.h"
+
+#include "mmap_fs.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* An open file */
+typedef struct {
+    const uint8_t *data;   /* The mapping, NULL for an empty file */
+    size_t size;
+    size_t pos;
+} mmap_file_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static const uint8_t *map_file(const char *path, size_t *size);
+static bool is_compressed(const char *path);
+static void *open_cb(lv_fs_drv_t *drv, const char *path, lv_fs_mode_t mode);
+static lv_fs_res_t close_cb(lv_fs_drv_t *drv, void *file_p);
+static lv_fs_res_t read_cb(lv_fs_drv_t *drv, void *file_p, void *buf, uint32_t btr, uint32_t *br);
+static lv_fs_res_t seek_cb(lv_fs_drv_t *drv, void *file_p, uint32_t pos, lv_fs_whence_t whence);
+static lv_fs_res_t tell_cb(lv_fs_drv_t *drv, void *file_p, uint32_t *pos_p);
+static void *dir_open_cb(lv_fs_drv_t *drv, const char *path);
+static lv_fs_res_t dir_read_cb(lv_fs_drv_t *drv, void *rddir_p, char *fn, uint32_t fn_len);
+static lv_fs_res_t dir_close_cb(lv_fs_drv_t *drv, void *rddir_p);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static lv_fs_drv_t fs_drv;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void mmap_fs_init(void)
+{
+    lv_fs_drv_init(&fs_drv);
+
+    fs_drv.letter = MMAP_FS_LETTER;
+    fs_drv.cache_size = 0;
+    fs_drv.open_cb = open_cb;
+    fs_drv.close_cb = close_cb;
+    fs_drv.read_cb = read_cb;
+    fs_drv.seek_cb = seek_cb;
+    fs_drv.tell_cb = tell_cb;
+    fs_drv.dir_open_cb = dir_open_cb;
+    fs_drv.dir_read_cb = dir_read_cb;
+    fs_drv.dir_close_cb = dir_close_cb;
+
+    lv_fs_drv_register(&fs_drv);
+}
+
+const lv_image_dsc_t *mmap_fs_load_image(const char *path)
+{
+    size_t size;
+    const uint8_t *data;
+    lv_image_header_t header;
+    lv_image_dsc_t *dsc;
+
+    data = map_file(path, &size);
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    if (size < sizeof(header)) {
+        goto err;
+    }
+
+    memcpy(&header, data, sizeof(header));
+
+    if (header.magic != LV_IMAGE_HEADER_MAGIC || (header.flags & LV_IMAGE_FLAGS_COMPRESSED)) {
+        LV_LOG_WARN("%s is not an uncompressed LVGL image", path);
+        goto err;
+    }
+
+    dsc = malloc(sizeof(lv_image_dsc_t));
+    LV_ASSERT_NULL(dsc);
+
+    memset(dsc, 0, sizeof(*dsc));
+    dsc->header = header;
+    dsc->data_size = size - sizeof(header);
+    dsc->data = data + sizeof(header);
+
+    return dsc;
+
+err:
+    munmap((void *)data, size);
+    return NULL;
+}
+
+lv_font_t *mmap_fs_load_ttf(const char *path, int32_t size)
+{
+#if LV_USE_TINY_TTF
+    size_t data_size;
+    lv_font_t *font;
+    const uint8_t *data = map_file(path, &data_size);
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    font = lv_tiny_ttf_create_data_ex(data, data_size, size,
+                                      LV_FONT_KERNING_NORMAL, LV_TINY_TTF_CACHE_GLYPH_CNT);
+
+    if (font == NULL) {
+        munmap((void *)data, data_size);
+    }
+
+    return font;
+#else
+    LV_UNUSED(size);
+    LV_LOG_WARN("Unable to load %s, LV_USE_TINY_TTF is disabled", path);
+    return NULL;
+#endif
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Map a file read-only
+ *
+ * @description the kernel is told how the mapping will be accessed:
+ * compressed images are decoded sequentially, the other files are
+ * accessed randomly but entirely so they are prefetched
+ *
+ * @param path the path of the file
+ * @param size set to the size of the file
+ * @return the mapping, NULL on error or if the file is empty
+ */
+static const uint8_t *map_file(const char *path, size_t *size)
+{
+    int fd;
+    void *data;
+    struct stat st;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1) {
+        LV_LOG_WARN("Unable to open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    /* The mapping stays valid once the file is closed */
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        LV_LOG_WARN("Unable to map %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    madvise(data, st.st_size, is_compressed(path) ? MADV_SEQUENTIAL : MADV_WILLNEED);
+
+    *size = st.st_size;
+    return data;
+}
+
+/**
+ * Check if a file is a compressed image
+ *
+ * @param path the path of the file
+ * @return true for PNG and JPEG files
+ */
+static bool is_compressed(const char *path)
+{
+    const char *ext = strrchr(path, '.');
+
+    return ext != NULL && (strcasecmp(ext, ".png") == 0 || strcasecmp(ext, ".jpg") == 0 ||
+                           strcasecmp(ext, ".jpeg") == 0);
+}
+
+/**
+ * Open a file
+ *
+ * @note called by LVGL
+ * @return the file, NULL on error or if opened for writing
+ */
+static void *open_cb(lv_fs_drv_t *drv, const char *path, lv_fs_mode_t mode)
+{
+    mmap_file_t *file;
+    struct stat st;
+
+    LV_UNUSED(drv);
+
+    if (mode & LV_FS_MODE_WR) {
+        LV_LOG_WARN("%c: is read-only", MMAP_FS_LETTER);
+        return NULL;
+    }
+
+    file = malloc(sizeof(mmap_file_t));
+    LV_ASSERT_NULL(file);
+
+    file->pos = 0;
+    file->size = 0;
+    file->data = map_file(path, &file->size);
+
+    /* An empty file can't be mapped but can be opened */
+    if (file->data == NULL && (stat(path, &st) == -1 || st.st_size != 0)) {
+        free(file);
+        return NULL;
+    }
+
+    return file;
+}
+
+/**
+ * Close a file
+ *
+ * @note called by LVGL
+ */
+static lv_fs_res_t close_cb(lv_fs_drv_t *drv, void *file_p)
+{
+    mmap_file_t *file = file_p;
+
+    LV_UNUSED(drv);
+
+    if (file->data != NULL) {
+        munmap((void *)file->data, file->size);
+    }
+
+    free(file);
+    return LV_FS_RES_OK;
+}
+
+/**
+ * Read from a file
+ *
+ * @description a single copy from the page cache
+ * @note called by LVGL
+ */
+static lv_fs_res_t read_cb(lv_fs_drv_t *drv, void *file_p, void *buf, uint32_t btr, uint32_t *br)
+{
+    mmap_file_t *file = file_p;
+    size_t len = LV_MIN((size_t)btr, file->size - file->pos);
+
+    LV_UNUSED(drv);
+
+    if (len > 0) {
+        memcpy(buf, file->data + file->pos, len);
+        file->pos += len;
+    }
+
+    *br = len;
+    return LV_FS_RES_OK;
+}
+
+/**
+ * Move the read position
+ *
+ * @note called by LVGL
+ */
+static lv_fs_res_t seek_cb(lv_fs_drv_t *drv, void *file_p, uint32_t pos, lv_fs_whence_t whence)
+{
+    mmap_file_t *file = file_p;
+    size_t new_pos;
+
+    LV_UNUSED(drv);
+
+    switch (whence) {
+    case LV_FS_SEEK_SET:
+        new_pos = pos;
+        break;
+    case LV_FS_SEEK_CUR:
+        new_pos = file->pos + pos;
+        break;
+    case LV_FS_SEEK_END:
+        new_pos = file->size + pos;
+        break;
+    default:
+        return LV_FS_RES_INV_PARAM;
+    }
+
+    file->pos = LV_MIN(new_pos, file->size);
+    return LV_FS_RES_OK;
+}
+
+/**
+ * Get the read position
+ *
+ * @note called by LVGL
+ */
+static lv_fs_res_t tell_cb(lv_fs_drv_t *drv, void *file_p, uint32_t *pos_p)
+{
+    mmap_file_t *file = file_p;
+
+    LV_UNUSED(drv);
+
+    *pos_p = file->pos;
+    return LV_FS_RES_OK;
+}
+
+/**
+ * Open a directory
+ *
+ * @note called by LVGL
+ */
+static void *dir_open_cb(lv_fs_drv_t *drv, const char *path)
+{
+    LV_UNUSED(drv);
+
+    return opendir(path);
+}
+
+/**
+ * Read the next entry of a directory
+ *
+ * @description like the other LVGL drivers, the name of the
+ * directories is prefixed with '/', an empty name marks the end
+ * @note called by LVGL
+ */
+static lv_fs_res_t dir_read_cb(lv_fs_drv_t *drv, void *rddir_p, char *fn, uint32_t fn_len)
+{
+    struct dirent *entry;
+
+    LV_UNUSED(drv);
+
+    do {
+        entry = readdir(rddir_p);
+
+        if (entry == NULL) {
+            if (fn_len > 0) {
+                fn[0] = '\0';
+            }
+            return LV_FS_RES_OK;
+        }
+    } while (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0);
+
+    snprintf(fn, fn_len, "%s%s", entry->d_type == DT_DIR ? "/" : "", entry->d_name);
+    return LV_FS_RES_OK;
+}
+
+/**
+ * Close a directory
+ *
+ * @note called by LVGL
+ */
+static lv_fs_res_t dir_close_cb(lv_fs_drv_t *drv, void *rddir_p)
+{
+    LV_UNUSED(drv);
+
+    closedir(rddir_p);
+    return LV_FS_RES_OK;
+}
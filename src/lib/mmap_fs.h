@@ -0,0 +1,81 @@
+/**
+ * @file mmap_fs.h
+ *
+ * Memory mapped file system driver
+ *
+ * Registers an LVGL file system driver that maps the files read-only
+ * instead of reading them through stdio buffers, the page cache is
+ * shared by all the processes using the same assets. Images in the LVGL
+ * binary format and TrueType fonts can be used directly from the
+ * mapping without copying them at all
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef MMAP_FS_H
+#define MMAP_FS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* The drive letter of the driver i.e M:/path/to/image.png */
+#define MMAP_FS_LETTER 'M'
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Register the driver
+ * @description must be called after lv_init
+ */
+void mmap_fs_init(void);
+
+/**
+ * @brief Map an image in the LVGL binary format
+ * @description the pixels are not copied, the returned descriptor
+ * points to the mapping which is kept until the program exits
+ *
+ * @param path the path of the .bin image, without drive letter
+ * @return the image descriptor to pass to lv_image_set_src,
+ * NULL if the file is not an uncompressed LVGL image
+ */
+const lv_image_dsc_t *mmap_fs_load_image(const char *path);
+
+/**
+ * @brief Create a TrueType font from a mapped file
+ * @description the font data is not copied, the mapping
+ * is kept until the program exits
+ *
+ * @param path the path of the .ttf file, without drive letter
+ * @param size the size of the font in px
+ * @return the font, NULL on error
+ */
+lv_font_t *mmap_fs_load_ttf(const char *path, int32_t size);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*MMAP_FS_H*/
@@ -22,6 +22,10 @@ extern "C" {
 /*********************
  *      INCLUDES
  *********************/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lvgl/lvgl.h"
 
 /*********************
  *      DEFINES
@@ -36,6 +40,16 @@ typedef struct {
     uint32_t window_height;
     bool maximize;
     bool fullscreen;
+    bool vsync;
+    bool frame_stats;
+    bool dirty_regions;        /* Log the invalidated areas of each frame */
+    bool dirty_overlay;        /* Tint the redrawn areas on screen */
+    uint32_t idle_timeout;     /* Time without invalidated areas before slowing down the refresh in ms, 0 to disable */
+    uint32_t idle_period;      /* Refresh period of an idle display in ms, 0 to stop the refresh */
+    int render_mode;           /* lv_display_render_mode_t, -1 for the default of the backend */
+    uint32_t buffer_count;     /* Number of draw buffers 1 or 2, 0 for the default */
+    uint32_t buffer_lines;     /* Height of the draw buffers in PARTIAL mode, 0 for the default */
+    lv_color_format_t color_format; /* LV_COLOR_FORMAT_UNKNOWN for the default */
 } simulator_settings_t;
 
 /**********************
@@ -17,6 +17,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
 
 /*********************
  *      DEFINES
@@ -49,6 +51,14 @@ const char *getenv_default(const char *name, const char *default_val)
 }
 
 
+uint64_t get_time_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 void die(const char *msg, ...)
 {
     va_list args;
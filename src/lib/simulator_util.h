@@ -20,6 +20,7 @@ extern "C" {
  *      INCLUDES
  *********************/
 #include <stdarg.h>
+#include <stdint.h>
 
 
 /**********************
@@ -35,6 +36,12 @@ extern "C" {
 const char *getenv_default(const char *name, const char *default_val);
 
 
+/**
+ * @description Read the monotonic clock
+ * @return the time in microseconds
+ */
+uint64_t get_time_us(void);
+
 /**
  * @description Centralized exit point, called due to an error
  * @param msg The message to display on stderr before killing the program
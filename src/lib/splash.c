@@ -0,0 +1,266 @@
+/**
+ * @file splash.c
+ *
+ * Instant-on splash from a cached first frame
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "lvgl/lvgl.h"
+
+#include "simulator_util.h"
+#include "splash.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static int open_frame(lv_image_header_t *header);
+static bool frame_matches(const lv_image_header_t *header, uint32_t width,
+                          uint32_t height, lv_color_format_t cf);
+static void refr_ready_cb(lv_event_t *e);
+static void save_timer_cb(lv_timer_t *timer);
+static int save_frame(const char *path, const lv_draw_buf_t *frame);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+bool splash_available(void)
+{
+    const char *path = getenv("LV_SIM_SPLASH");
+
+    return path != NULL && access(path, R_OK) == 0;
+}
+
+int splash_show(uint8_t *fb, uint32_t width, uint32_t height, uint32_t stride,
+                lv_color_format_t cf)
+{
+    int fd;
+    uint32_t y;
+    uint32_t len;
+    off_t offset;
+    lv_image_header_t header;
+    uint64_t start = get_time_us();
+
+    fd = open_frame(&header);
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    if (!frame_matches(&header, width, height, cf)) {
+        LV_LOG_WARN("The cached frame doesn't match the display");
+        close(fd);
+        return -1;
+    }
+
+    len = width * lv_color_format_get_size(cf);
+    offset = sizeof(header);
+
+    for (y = 0; y < height; y++) {
+        if (pread(fd, fb + y * stride, len, offset) != (ssize_t)len) {
+            LV_LOG_ERROR("Failed to read the cached frame: %s", strerror(errno));
+            close(fd);
+            return -1;
+        }
+        offset += header.stride;
+    }
+
+    close(fd);
+
+    LV_LOG_INFO("Cached frame displayed in %" PRIu64 " us", get_time_us() - start);
+    return 0;
+}
+
+void splash_capture(lv_display_t *disp)
+{
+    int fd;
+    lv_image_header_t header;
+
+    if (getenv("LV_SIM_SPLASH") == NULL) {
+        return;
+    }
+
+    if (!atoi(getenv_default("LV_SIM_SPLASH_UPDATE", "0"))) {
+
+        fd = open_frame(&header);
+
+        if (fd != -1) {
+            close(fd);
+
+            if (frame_matches(&header, lv_display_get_horizontal_resolution(disp),
+                              lv_display_get_vertical_resolution(disp),
+                              lv_display_get_color_format(disp))) {
+                return;
+            }
+        }
+    }
+
+    lv_display_add_event_cb(disp, refr_ready_cb, LV_EVENT_REFR_READY, NULL);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Open the cached frame and read its header
+ *
+ * @param header set to the header of the image
+ * @return the file descriptor, -1 if there is no valid cached frame
+ */
+static int open_frame(lv_image_header_t *header)
+{
+    int fd;
+    const char *path = getenv("LV_SIM_SPLASH");
+
+    if (path == NULL) {
+        return -1;
+    }
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1) {
+        return -1;
+    }
+
+    if (read(fd, header, sizeof(*header)) != sizeof(*header) ||
+        header->magic != LV_IMAGE_HEADER_MAGIC) {
+        LV_LOG_WARN("%s is not a cached frame", path);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * Check if the cached frame can be displayed
+ *
+ * @param header the header of the cached frame
+ * @param width the horizontal resolution of the display
+ * @param height the vertical resolution of the display
+ * @param cf the color format of the display
+ * @return true if the size and the color format match
+ */
+static bool frame_matches(const lv_image_header_t *header, uint32_t width,
+                          uint32_t height, lv_color_format_t cf)
+{
+    return header->w == width && header->h == height && header->cf == cf;
+}
+
+/**
+ * Schedule the capture of the first frame
+ *
+ * @description the screen can't be rendered again while the
+ * display is refreshing, the capture is deferred to a timer
+ * @note called by LVGL once the display is refreshed
+ */
+static void refr_ready_cb(lv_event_t *e)
+{
+    lv_display_t *disp = lv_event_get_target(e);
+    lv_timer_t *timer;
+
+    lv_display_remove_event_cb_with_user_data(disp, refr_ready_cb, NULL);
+
+    timer = lv_timer_create(save_timer_cb, 0, disp);
+    lv_timer_set_repeat_count(timer, 1);
+}
+
+/**
+ * Render the active screen and save it
+ *
+ * @note called by LVGL
+ */
+static void save_timer_cb(lv_timer_t *timer)
+{
+    lv_display_t *disp = lv_timer_get_user_data(timer);
+    lv_draw_buf_t *frame;
+
+    frame = lv_snapshot_take(lv_display_get_screen_active(disp),
+                             lv_display_get_color_format(disp));
+
+    if (frame == NULL) {
+        LV_LOG_ERROR("Failed to capture the first frame");
+        return;
+    }
+
+    save_frame(getenv("LV_SIM_SPLASH"), frame);
+    lv_draw_buf_destroy(frame);
+}
+
+/**
+ * Write a frame in the LVGL binary image format
+ *
+ * @description the frame is written to a temporary file renamed once
+ * complete, a power loss never leaves a truncated frame behind
+ * @param path the path of the file
+ * @param frame the frame
+ * @return 0 on success, -1 on error
+ */
+static int save_frame(const char *path, const lv_draw_buf_t *frame)
+{
+    char tmp_path[PATH_MAX];
+    FILE *f;
+    size_t size = frame->header.stride * frame->header.h;
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    f = fopen(tmp_path, "wb");
+
+    if (f == NULL) {
+        LV_LOG_ERROR("Failed to create %s: %s", tmp_path, strerror(errno));
+        return -1;
+    }
+
+    if (fwrite(&frame->header, sizeof(frame->header), 1, f) != 1 ||
+        fwrite(frame->data, size, 1, f) != 1 ||
+        fflush(f) != 0 || fsync(fileno(f)) != 0) {
+        LV_LOG_ERROR("Failed to write %s: %s", tmp_path, strerror(errno));
+        fclose(f);
+        unlink(tmp_path);
+        return -1;
+    }
+
+    fclose(f);
+
+    if (rename(tmp_path, path) == -1) {
+        LV_LOG_ERROR("Failed to rename %s: %s", tmp_path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+
+    LV_LOG_USER("First frame saved to %s", path);
+    return 0;
+}
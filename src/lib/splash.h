@@ -0,0 +1,80 @@
+/**
+ * @file splash.h
+ *
+ * Instant-on splash from a cached first frame
+ *
+ * The first frame rendered by LVGL is saved to the file set by
+ * LV_SIM_SPLASH, in the LVGL binary image format. On the next start the
+ * fbdev and DRM backends copy it to the screen before the widgets are
+ * created, it stays visible until LVGL flushes its first frame
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef SPLASH_H
+#define SPLASH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lvgl/lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Check if a cached frame can be displayed
+ * @return true if LV_SIM_SPLASH is set and the file exists
+ */
+bool splash_available(void);
+
+/**
+ * @brief Copy the cached frame to a framebuffer
+ * @description the frame is read directly into the framebuffer
+ *
+ * @param fb the first pixel of the visible area of the framebuffer
+ * @param width the width of the framebuffer in px
+ * @param height the height of the framebuffer in px
+ * @param stride the length of a line of the framebuffer in bytes
+ * @param cf the color format of the framebuffer
+ * @return 0 on success, -1 if there is no cached frame matching the framebuffer
+ */
+int splash_show(uint8_t *fb, uint32_t width, uint32_t height, uint32_t stride,
+                lv_color_format_t cf);
+
+/**
+ * @brief Save the first frame rendered on a display
+ * @description the frame is only saved if the cached frame doesn't
+ * match the display, or always if LV_SIM_SPLASH_UPDATE is set to 1.
+ * Does nothing if LV_SIM_SPLASH is not set
+ *
+ * @param disp the display
+ */
+void splash_capture(lv_display_t *disp);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*SPLASH_H*/
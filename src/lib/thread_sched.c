@@ -0,0 +1,386 @@
+/**
+ * @file thread_sched.c
+ *
+ * CPU affinity and scheduling policy of the threads
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+
+/* CPU_SET and pthread_setaffinity_np */
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "lvgl/lvgl.h"
+
+#include "thread_sched.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* The configuration of a role */
+typedef struct {
+    bool set_affinity;
+    cpu_set_t cpus;
+    bool set_policy;
+    int policy;
+    int priority;
+} sched_config_t;
+
+/* The configuration of a thread, saved to be restored */
+typedef struct {
+    bool saved_affinity;
+    cpu_set_t cpus;
+    bool saved_policy;
+    int policy;
+    struct sched_param param;
+} sched_saved_t;
+
+/* A scheduling policy */
+typedef struct {
+    const char *name;
+    int policy;
+} policy_name_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static int parse_cpus(const char *list, cpu_set_t *cpus);
+static int parse_policy(const char *name);
+static void save_process_cpus(void);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static sched_config_t configs[THREAD_SCHED_ROLE_CNT];
+
+/* The affinity of the process before a role was applied */
+static cpu_set_t process_cpus;
+static bool process_cpus_saved;
+static pthread_once_t process_cpus_once = PTHREAD_ONCE_INIT;
+
+/* The configuration of the thread creating the draw units */
+static sched_saved_t draw_creator;
+
+static const char *role_names[THREAD_SCHED_ROLE_CNT] = {
+    "main",
+    "draw",
+    "input"
+};
+
+static const policy_name_t policies[] = {
+    { "other", SCHED_OTHER },
+    { "batch", SCHED_BATCH },
+    { "idle",  SCHED_IDLE },
+    { "fifo",  SCHED_FIFO },
+    { "rr",    SCHED_RR },
+    { NULL,    0 }
+};
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+int thread_sched_configure(thread_sched_role_t role, const char *spec)
+{
+    char *buf;
+    char *rest;
+    char *cpus;
+    char *policy;
+    char *priority;
+    sched_config_t config;
+    int ret = -1;
+
+    memset(&config, 0, sizeof(config));
+
+    buf = strdup(spec);
+    LV_ASSERT_NULL(buf);
+
+    rest = buf;
+    cpus = strsep(&rest, ":");
+    policy = strsep(&rest, ":");
+    priority = rest;
+
+    if (*cpus != '\0') {
+        if (parse_cpus(cpus, &config.cpus) == -1) {
+            goto out;
+        }
+        config.set_affinity = true;
+    }
+
+    if (policy != NULL && *policy != '\0') {
+
+        config.policy = parse_policy(policy);
+
+        if (config.policy == -1) {
+            goto out;
+        }
+
+        config.set_policy = true;
+
+        if (config.policy == SCHED_FIFO || config.policy == SCHED_RR) {
+            config.priority = priority != NULL ? atoi(priority) : 1;
+
+            if (config.priority < sched_get_priority_min(config.policy) ||
+                config.priority > sched_get_priority_max(config.policy)) {
+                goto out;
+            }
+        } else if (priority != NULL) {
+            /* Only the real-time policies have a priority */
+            goto out;
+        }
+    }
+
+    configs[role] = config;
+    ret = 0;
+
+out:
+    free(buf);
+    return ret;
+}
+
+int thread_sched_parse_option(const char *option)
+{
+    int i;
+    size_t len;
+
+    for (i = 0; i < THREAD_SCHED_ROLE_CNT; i++) {
+
+        len = strlen(role_names[i]);
+
+        if (strncmp(option, role_names[i], len) == 0 && option[len] == '=') {
+            return thread_sched_configure(i, option + len + 1);
+        }
+    }
+
+    return -1;
+}
+
+int thread_sched_apply(thread_sched_role_t role, pthread_t thread)
+{
+    int ret;
+    int status = 0;
+    struct sched_param param;
+    sched_config_t *config = &configs[role];
+
+    pthread_once(&process_cpus_once, save_process_cpus);
+
+    if (config->set_affinity) {
+
+        ret = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &config->cpus);
+
+        if (ret != 0) {
+            LV_LOG_WARN("Failed to set the CPU affinity of a %s thread: %s",
+                        role_names[role], strerror(ret));
+            status = -1;
+        }
+    }
+
+    if (config->set_policy) {
+
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = config->priority;
+
+        ret = pthread_setschedparam(thread, config->policy, &param);
+
+        if (ret != 0) {
+            LV_LOG_WARN("Failed to set the scheduling policy of a %s thread: %s",
+                        role_names[role], strerror(ret));
+            status = -1;
+        }
+    }
+
+    return status;
+}
+
+void thread_sched_init_helper_attr(pthread_attr_t *attr)
+{
+    struct sched_param param;
+    cpu_set_t cpus;
+    sched_config_t *main_config = &configs[THREAD_SCHED_MAIN];
+
+    pthread_once(&process_cpus_once, save_process_cpus);
+
+    memset(&param, 0, sizeof(param));
+    pthread_attr_init(attr);
+    pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(attr, SCHED_OTHER);
+    pthread_attr_setschedparam(attr, &param);
+
+    if (!process_cpus_saved) {
+        return;
+    }
+
+    /* Keep the helpers off the CPUs of the UI unless it has them all */
+    cpus = process_cpus;
+
+    if (main_config->set_affinity) {
+        CPU_XOR(&cpus, &process_cpus, &main_config->cpus);
+        CPU_AND(&cpus, &cpus, &process_cpus);
+
+        if (CPU_COUNT(&cpus) == 0) {
+            cpus = process_cpus;
+        }
+    }
+
+    pthread_attr_setaffinity_np(attr, sizeof(cpu_set_t), &cpus);
+}
+
+void thread_sched_draw_units_begin(void)
+{
+    pthread_t self = pthread_self();
+    sched_config_t *config = &configs[THREAD_SCHED_DRAW];
+
+    memset(&draw_creator, 0, sizeof(draw_creator));
+
+    if (config->set_affinity) {
+        draw_creator.saved_affinity =
+            pthread_getaffinity_np(self, sizeof(cpu_set_t), &draw_creator.cpus) == 0;
+    }
+
+    if (config->set_policy) {
+        draw_creator.saved_policy =
+            pthread_getschedparam(self, &draw_creator.policy, &draw_creator.param) == 0;
+    }
+
+    /* The draw units inherit the affinity and the policy of their creator */
+    thread_sched_apply(THREAD_SCHED_DRAW, self);
+}
+
+void thread_sched_draw_units_end(void)
+{
+    int ret;
+    pthread_t self = pthread_self();
+
+    if (draw_creator.saved_affinity) {
+        ret = pthread_setaffinity_np(self, sizeof(cpu_set_t), &draw_creator.cpus);
+
+        if (ret != 0) {
+            LV_LOG_WARN("Failed to restore the CPU affinity: %s", strerror(ret));
+        }
+    }
+
+    if (draw_creator.saved_policy) {
+        ret = pthread_setschedparam(self, draw_creator.policy, &draw_creator.param);
+
+        if (ret != 0) {
+            LV_LOG_WARN("Failed to restore the scheduling policy: %s", strerror(ret));
+        }
+    }
+
+    memset(&draw_creator, 0, sizeof(draw_creator));
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Parse a list of CPUs
+ *
+ * @param list comma separated CPUs and ranges i.e 0,2-3
+ * @param cpus set to the CPUs of the list
+ * @return 0 on success, -1 if the list is invalid
+ */
+static int parse_cpus(const char *list, cpu_set_t *cpus)
+{
+    long first;
+    long last;
+    char *end;
+    const char *p = list;
+
+    CPU_ZERO(cpus);
+
+    while (*p != '\0') {
+
+        first = strtol(p, &end, 10);
+
+        if (end == p || first < 0) {
+            return -1;
+        }
+
+        last = first;
+
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+
+            if (end == p || last < first) {
+                return -1;
+            }
+        }
+
+        if (last >= CPU_SETSIZE) {
+            return -1;
+        }
+
+        for (; first <= last; first++) {
+            CPU_SET(first, cpus);
+        }
+
+        if (*end == ',') {
+            end++;
+        } else if (*end != '\0') {
+            return -1;
+        }
+
+        p = end;
+    }
+
+    return CPU_COUNT(cpus) > 0 ? 0 : -1;
+}
+
+/**
+ * Parse the name of a scheduling policy
+ *
+ * @param name other, batch, idle, fifo or rr
+ * @return the policy, -1 if the name is invalid
+ */
+static int parse_policy(const char *name)
+{
+    int i;
+
+    for (i = 0; policies[i].name != NULL; i++) {
+        if (strcmp(policies[i].name, name) == 0) {
+            return policies[i].policy;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Save the CPU affinity of the process
+ *
+ * @description the main thread is the one with the id of the process,
+ * its affinity is read before any role is applied to it
+ */
+static void save_process_cpus(void)
+{
+    if (sched_getaffinity(getpid(), sizeof(cpu_set_t), &process_cpus) == 0) {
+        process_cpus_saved = true;
+    } else {
+        LV_LOG_WARN("Failed to get the CPU affinity of the process: %s", strerror(errno));
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ * @file thread_sched.h
+ *
+ * CPU affinity and scheduling policy of the threads
+ *
+ * The threads are grouped by role, each role can be pinned to a set of
+ * CPUs and given a scheduling policy and priority, i.e. to keep the UI
+ * away from the cores of a control loop or to run it with SCHED_FIFO
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef THREAD_SCHED_H
+#define THREAD_SCHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <pthread.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* The roles of the threads */
+typedef enum {
+    THREAD_SCHED_MAIN,      /* The run loop, and the render threads of the displays */
+    THREAD_SCHED_DRAW,      /* The software draw units */
+    THREAD_SCHED_INPUT,     /* The evdev input thread */
+    THREAD_SCHED_ROLE_CNT
+} thread_sched_role_t;
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Configure a role
+ * @description the specification is cpus[:policy[:priority]], the cpus
+ * are a list of CPUs and ranges i.e 2,4-5, an empty list keeps the
+ * affinity. The policy is other, batch, idle, fifo or rr, the priority
+ * of fifo and rr is between 1 and 99 (default 1)
+ *
+ * @param role the role
+ * @param spec the specification
+ * @return 0 on success, -1 if the specification is invalid
+ */
+int thread_sched_configure(thread_sched_role_t role, const char *spec);
+
+/**
+ * @brief Configure a role from a command line option
+ * @param option role=spec, the role is main, draw or input
+ * @return 0 on success, -1 if the option is invalid
+ */
+int thread_sched_parse_option(const char *option);
+
+/**
+ * @brief Apply the configuration of a role to a thread
+ * @description a thread of a role that isn't configured keeps the
+ * affinity and policy it was created with.
+ * Failures are logged, i.e the real-time policies require CAP_SYS_NICE
+ *
+ * @param role the role of the thread
+ * @param thread the thread
+ * @return 0 on success or if the role isn't configured, -1 on error
+ */
+int thread_sched_apply(thread_sched_role_t role, pthread_t thread);
+
+/**
+ * @brief Initialize the attributes of a helper thread
+ * @description the threads that don't belong to a role, i.e. the writers
+ * and encoders running in the background, are created with SCHED_OTHER
+ * and the CPUs the process started with, less the ones of the main role
+ * if any remain, instead of inheriting the configuration of the thread
+ * creating them. The attributes must be destroyed with pthread_attr_destroy
+ * @param attr the attributes to initialize
+ */
+void thread_sched_init_helper_attr(pthread_attr_t *attr);
+
+/**
+ * @brief Apply the configuration of the draw role to the calling thread
+ * @description called before lv_init, the threads of the software draw
+ * units created by lv_init inherit the affinity and the policy of the
+ * calling thread, they run with the draw role from their creation.
+ * Its configuration is restored by thread_sched_draw_units_end
+ */
+void thread_sched_draw_units_begin(void);
+
+/**
+ * @brief Restore the configuration of the calling thread
+ * @description called once lv_init has created the draw units, before
+ * the main role is applied
+ */
+void thread_sched_draw_units_end(void);
+
+/**********************
+ *      MACROS
+ **********************/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*THREAD_SCHED_H*/
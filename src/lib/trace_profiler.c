@@ -0,0 +1,276 @@
+/**
+ * @file trace_profiler.c
+ *
+ * Trace-event profiler
+ *
+ * Each thread records its events into its own buffer without locking,
+ * the buffers are only registered under a lock when a thread records its
+ * first event. The trace is written once at exit, the events recorded
+ * concurrently by the other threads are ignored
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+
+#include "lvgl/lvgl.h"
+
+#include "simulator_util.h"
+#include "trace_profiler.h"
+
+#ifdef LV_LINUX_TRACE_PROFILER
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/* A begin or end event */
+typedef struct {
+    uint64_t ts_ns;
+    const char *name;
+    char phase;
+} trace_event_t;
+
+/* The events of a thread */
+typedef struct _trace_buffer {
+    struct _trace_buffer *next;
+    pid_t tid;
+    char thread_name[16];
+    uint32_t capacity;
+    uint32_t count;           /* Published with release semantics */
+    uint32_t dropped;
+    trace_event_t events[];
+} trace_buffer_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static trace_buffer_t *create_buffer(void);
+static void write_trace(void);
+static void write_string(FILE *f, const char *str);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static __thread trace_buffer_t *thread_buffer;
+
+static pthread_mutex_t buffers_lock = PTHREAD_MUTEX_INITIALIZER;
+static trace_buffer_t *buffers;
+
+static uint32_t buffer_events = TRACE_PROFILER_BUF_EVENTS;
+static const char *trace_file;
+static bool recording;
+
+/**********************
+ *      MACROS
+ **********************/
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void trace_profiler_init(void)
+{
+    int events;
+
+    if (recording) {
+        return;
+    }
+
+    events = atoi(getenv_default("LV_SIM_TRACE_EVENTS", "0"));
+
+    if (events > 0) {
+        buffer_events = events;
+    }
+
+    trace_file = getenv_default("LV_SIM_TRACE_FILE", "lvglsim-trace.json");
+    atexit(write_trace);
+
+    __atomic_store_n(&recording, true, __ATOMIC_RELEASE);
+}
+
+void trace_profiler_event(char phase, const char *name)
+{
+    struct timespec ts;
+    trace_buffer_t *buf = thread_buffer;
+    trace_event_t *e;
+
+    if (!__atomic_load_n(&recording, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    if (buf == NULL) {
+        buf = create_buffer();
+
+        if (buf == NULL) {
+            return;
+        }
+    }
+
+    if (buf->count == buf->capacity) {
+        buf->dropped++;
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    e = &buf->events[buf->count];
+    e->ts_ns = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    e->name = name;
+    e->phase = phase;
+
+    /* The event is complete before it is visible to write_trace */
+    __atomic_store_n(&buf->count, buf->count + 1, __ATOMIC_RELEASE);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+/**
+ * Create the buffer of the calling thread
+ *
+ * @return the buffer, NULL on allocation failure
+ */
+static trace_buffer_t *create_buffer(void)
+{
+    trace_buffer_t *buf;
+
+    buf = malloc(sizeof(trace_buffer_t) + (size_t)buffer_events * sizeof(trace_event_t));
+
+    if (buf == NULL) {
+        /* Don't try again on each event */
+        __atomic_store_n(&recording, false, __ATOMIC_RELEASE);
+        fprintf(stderr, "Failed to allocate the trace buffer, the trace is stopped\n");
+        return NULL;
+    }
+
+    memset(buf, 0, sizeof(trace_buffer_t));
+    buf->tid = (pid_t)syscall(SYS_gettid);
+    buf->capacity = buffer_events;
+    prctl(PR_GET_NAME, buf->thread_name, 0, 0, 0);
+
+    pthread_mutex_lock(&buffers_lock);
+    buf->next = buffers;
+    buffers = buf;
+    pthread_mutex_unlock(&buffers_lock);
+
+    thread_buffer = buf;
+    return buf;
+}
+
+/**
+ * Write the trace file
+ *
+ * @description the events are written in the Chrome trace-event format,
+ * the thread names as metadata events
+ */
+static void write_trace(void)
+{
+    FILE *f;
+    uint32_t i;
+    uint32_t count;
+    bool first = true;
+    pid_t pid = getpid();
+    trace_buffer_t *buf;
+    trace_event_t *e;
+
+    __atomic_store_n(&recording, false, __ATOMIC_RELEASE);
+
+    f = fopen(trace_file, "w");
+
+    if (f == NULL) {
+        fprintf(stderr, "Failed to open the trace file %s\n", trace_file);
+        return;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    pthread_mutex_lock(&buffers_lock);
+
+    for (buf = buffers; buf != NULL; buf = buf->next) {
+
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                "\"args\":{\"name\":", first ? "" : ",\n", pid, buf->tid);
+        write_string(f, buf->thread_name);
+        fprintf(f, "}}");
+        first = false;
+
+        count = __atomic_load_n(&buf->count, __ATOMIC_ACQUIRE);
+
+        for (i = 0; i < count; i++) {
+            e = &buf->events[i];
+            fprintf(f, ",\n{\"name\":");
+            write_string(f, e->name);
+            fprintf(f, ",\"ph\":\"%c\",\"ts\":%llu.%03llu,\"pid\":%d,\"tid\":%d}",
+                    e->phase, (unsigned long long)(e->ts_ns / 1000),
+                    (unsigned long long)(e->ts_ns % 1000), pid, buf->tid);
+        }
+
+        if (buf->dropped != 0) {
+            fprintf(stderr, "Trace buffer of thread %d full, %u events dropped\n",
+                    buf->tid, buf->dropped);
+        }
+    }
+
+    pthread_mutex_unlock(&buffers_lock);
+
+    fprintf(f, "\n]}\n");
+    fclose(f);
+
+    fprintf(stderr, "Trace written to %s\n", trace_file);
+}
+
+/**
+ * Write a JSON string
+ *
+ * @param f the trace file
+ * @param str the string to quote and escape
+ */
+static void write_string(FILE *f, const char *str)
+{
+    fputc('"', f);
+
+    for (; *str != '\0'; str++) {
+        if (*str == '"' || *str == '\\') {
+            fputc('\\', f);
+        }
+
+        if ((unsigned char)*str >= 0x20) {
+            fputc(*str, f);
+        }
+    }
+
+    fputc('"', f);
+}
+
+#else
+
+void trace_profiler_init(void)
+{
+}
+
+void trace_profiler_event(char phase, const char *name)
+{
+    LV_UNUSED(phase);
+    LV_UNUSED(name);
+}
+
+#endif /*LV_LINUX_TRACE_PROFILER*/
@@ -0,0 +1,72 @@
+/**
+ * @file trace_profiler.h
+ *
+ * Trace-event profiler
+ *
+ * Backend of the LVGL profiler enabled with the LV_LINUX_PROFILER CMake
+ * option, which sets this file as LV_PROFILER_INCLUDE. The begin and end
+ * events are recorded with their CLOCK_MONOTONIC timestamp into a buffer
+ * per thread, the trace is written in the Chrome JSON format at exit and
+ * can be opened with Perfetto or chrome://tracing
+ *
+ * Copyright (c) 2025 EDGEMTech Ltd.
+ *
+ */
+
+#ifndef TRACE_PROFILER_H
+#define TRACE_PROFILER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+
+/* Included by the LVGL sources, only depends on the C library */
+#include <stdint.h>
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Default number of events recorded per thread */
+#define TRACE_PROFILER_BUF_EVENTS (256 * 1024)
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+
+/**
+ * @brief Start recording the trace
+ * @description the trace is written at exit to the file set by
+ * LV_SIM_TRACE_FILE (default lvglsim-trace.json), LV_SIM_TRACE_EVENTS
+ * sets the number of events recorded per thread, the next ones are
+ * dropped. Does nothing if the profiler is not built
+ */
+void trace_profiler_init(void);
+
+/**
+ * @brief Record an event of the calling thread
+ *
+ * @param phase 'B' for the beginning of a slice, 'E' for its end
+ * @param name the name of the slice, must remain valid until exit
+ */
+void trace_profiler_event(char phase, const char *name);
+
+/**********************
+ *      MACROS
+ **********************/
+
+/* Mapped to the LV_PROFILER_* macros by lv_conf.h */
+#define TRACE_PROFILER_BEGIN            trace_profiler_event('B', __func__)
+#define TRACE_PROFILER_END              trace_profiler_event('E', __func__)
+#define TRACE_PROFILER_BEGIN_TAG(tag)   trace_profiler_event('B', tag)
+#define TRACE_PROFILER_END_TAG(tag)     trace_profiler_event('E', tag)
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*TRACE_PROFILER_H*/
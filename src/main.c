@@ -18,6 +18,7 @@
  *
  ******************************************************************/
 #include <unistd.h>
+#include <getopt.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,16 +30,89 @@
 #include "src/lib/driver_backends.h"
 #include "src/lib/simulator_util.h"
 #include "src/lib/simulator_settings.h"
+#include "src/lib/benchmark.h"
+#include "src/lib/display_buffers.h"
+#include "src/lib/mem_heap.h"
+#include "src/lib/asset_preload.h"
+#include "src/lib/mmap_fs.h"
+#include "src/lib/splash.h"
+#include "src/lib/draw_sw_avx2.h"
+#include "src/lib/trace_profiler.h"
+#include "src/lib/adaptive_refresh.h"
+#include "src/lib/thread_sched.h"
+#include "src/lib/frame_capture.h"
+
+/* Options without a short form */
+enum {
+    OPT_BENCH = 256,
+    OPT_BENCH_TIME,
+    OPT_BENCH_OUTPUT,
+    OPT_FRAME_STATS,
+    OPT_RENDER_MODE,
+    OPT_BUFFER_COUNT,
+    OPT_BUFFER_LINES,
+    OPT_COLOR_FORMAT,
+    OPT_PRELOAD,
+    OPT_DIRTY_REGIONS,
+    OPT_DIRTY_OVERLAY,
+    OPT_IDLE_TIMEOUT,
+    OPT_SCHED,
+    OPT_CAPTURE_DIR,
+    OPT_CAPTURE_INTERVAL,
+    OPT_CAPTURE_FORMAT
+};
 
 /* Internal functions */
 static void configure_simulator(int argc, char **argv);
 static void print_lvgl_version(void);
 static void print_usage(void);
+static void check_backends(const char *list);
+static void init_display_backends(char *list);
+static void set_render_mode(const char *name);
+static void set_buffer_count(const char *count);
+static void set_color_format(const char *name);
+static void set_thread_sched(thread_sched_role_t role, const char *spec);
+static void set_capture_format(const char *name);
 
-/* contains the name of the selected backend if user
- * has specified one on the command line */
+/* contains the comma separated list of the selected display backends
+ * if user has specified them on the command line */
 static char *selected_backend;
 
+/* Benchmark mode - set with the --bench options */
+static bool bench_enabled;
+static char *bench_scenes = BENCHMARK_DEFAULT_SCENES;
+static uint32_t bench_duration = BENCHMARK_DEFAULT_DURATION;
+static char *bench_output;
+
+/* Manifest or directory of the assets to preload - set with --preload */
+static char *preload_path;
+
+/* Frame capture - set with the --capture options */
+static char *capture_dir;
+static uint32_t capture_interval;
+static frame_capture_format_t capture_format = FRAME_CAPTURE_PNG;
+
+static const struct option long_options[] = {
+    { "bench",        optional_argument, NULL, OPT_BENCH },
+    { "bench-time",   required_argument, NULL, OPT_BENCH_TIME },
+    { "bench-output", required_argument, NULL, OPT_BENCH_OUTPUT },
+    { "frame-stats",  no_argument,       NULL, OPT_FRAME_STATS },
+    { "render-mode",  required_argument, NULL, OPT_RENDER_MODE },
+    { "buffer-count", required_argument, NULL, OPT_BUFFER_COUNT },
+    { "buffer-lines", required_argument, NULL, OPT_BUFFER_LINES },
+    { "color-format", required_argument, NULL, OPT_COLOR_FORMAT },
+    { "preload",      required_argument, NULL, OPT_PRELOAD },
+    { "dirty-regions", no_argument,      NULL, OPT_DIRTY_REGIONS },
+    { "dirty-overlay", no_argument,      NULL, OPT_DIRTY_OVERLAY },
+    { "idle-timeout", required_argument, NULL, OPT_IDLE_TIMEOUT },
+    { "sched",        required_argument, NULL, OPT_SCHED },
+    { "capture-dir",  required_argument, NULL, OPT_CAPTURE_DIR },
+    { "capture-interval", required_argument, NULL, OPT_CAPTURE_INTERVAL },
+    { "capture-format", required_argument, NULL, OPT_CAPTURE_FORMAT },
+    { "help",         no_argument,       NULL, 'h' },
+    { NULL,           0,                 NULL, 0 }
+};
+
 /* Global simulator settings, defined in lv_linux_backend.c */
 extern simulator_settings_t settings;
 
@@ -60,9 +134,39 @@ static void print_lvgl_version(void)
  */
 static void print_usage(void)
 {
-    fprintf(stdout, "\nlvglsim [-V] [-B] [-b backend_name] [-W window_width] [-H window_height]\n\n");
+    fprintf(stdout, "\nlvglsim [-V] [-B] [-s] [-b backend_name[:period[:thread]][,...]] "
+            "[-W window_width] [-H window_height]\n\n");
     fprintf(stdout, "-V print LVGL version\n");
     fprintf(stdout, "-B list supported backends\n");
+    fprintf(stdout, "-b comma separated list of display backends, each with an optional\n"
+            "  refresh period in ms, 'thread' refreshes the display from its own thread\n");
+    fprintf(stdout, "-s synchronize rendering with the display refresh (DRM, SDL)\n");
+    fprintf(stdout, "--bench[=scenes] run the comma separated list of demos (default: %s)\n",
+            BENCHMARK_DEFAULT_SCENES);
+    fprintf(stdout, "--bench-time seconds the duration of each scene (default: %d)\n",
+            BENCHMARK_DEFAULT_DURATION);
+    fprintf(stdout, "--bench-output file write the results to a file, CSV if it ends with .csv\n"
+            "  JSON otherwise (default: stdout)\n");
+    fprintf(stdout, "--frame-stats print frame time histograms on SIGUSR1 and at exit\n");
+    fprintf(stdout, "--render-mode mode PARTIAL, DIRECT or FULL (default: backend specific)\n");
+    fprintf(stdout, "--buffer-count count number of draw buffers, 1 or 2\n");
+    fprintf(stdout, "--buffer-lines lines height of the draw buffers in PARTIAL mode\n"
+            "  (default: a tenth of the display)\n");
+    fprintf(stdout, "--color-format format RGB565, RGB888, XRGB8888 or ARGB8888\n"
+            "  the draw buffer options only apply to the FBDEV, HEADLESS and RFB backends\n");
+    fprintf(stdout, "--preload path decode the images and fonts of a manifest or the images\n"
+            "  of a directory before showing the first screen\n");
+    fprintf(stdout, "--dirty-regions log the invalidated areas of each frame and print\n"
+            "  the draw buffer size they require at exit\n");
+    fprintf(stdout, "--dirty-overlay tint the redrawn areas, implies --dirty-regions\n");
+    fprintf(stdout, "--idle-timeout ms slow down the refresh once nothing was invalidated\n"
+            "  for this long, restored on input (default: 0, disabled)\n");
+    fprintf(stdout, "--sched role=cpus[:policy[:priority]] pin the main, draw or input threads\n"
+            "  to CPUs i.e 2-3 and set their policy other, batch, idle, fifo or rr\n");
+    fprintf(stdout, "--capture-dir dir capture a frame to the directory on SIGRTMIN, periodically\n"
+            "  and halfway through each benchmark scene\n");
+    fprintf(stdout, "--capture-interval ms time between two captures (default: 0, on request only)\n");
+    fprintf(stdout, "--capture-format format png or raw, an LVGL binary image (default: png)\n");
 }
 
 /**
@@ -84,9 +188,41 @@ static void configure_simulator(int argc, char **argv)
     /* Default values */
     settings.window_width = atoi(env_w ? env_w : "800");
     settings.window_height = atoi(env_h ? env_h : "480");
+    settings.frame_stats = atoi(getenv_default("LV_SIM_FRAME_STATS", "0"));
+    settings.dirty_regions = atoi(getenv_default("LV_SIM_DIRTY_REGIONS", "0"));
+    settings.dirty_overlay = atoi(getenv_default("LV_SIM_DIRTY_OVERLAY", "0"));
+    settings.idle_timeout = atoi(getenv_default("LV_SIM_IDLE_TIMEOUT", "0"));
+    settings.idle_period = atoi(getenv_default("LV_SIM_IDLE_PERIOD", "0"));
+    settings.render_mode = DISPLAY_BUFFERS_MODE_DEFAULT;
+    settings.buffer_lines = atoi(getenv_default("LV_SIM_BUFFER_LINES", "0"));
+    settings.color_format = LV_COLOR_FORMAT_UNKNOWN;
+    preload_path = getenv("LV_SIM_PRELOAD");
+
+    if (getenv("LV_SIM_RENDER_MODE") != NULL) {
+        set_render_mode(getenv("LV_SIM_RENDER_MODE"));
+    }
+
+    if (getenv("LV_SIM_BUFFER_COUNT") != NULL) {
+        set_buffer_count(getenv("LV_SIM_BUFFER_COUNT"));
+    }
+
+    if (getenv("LV_SIM_COLOR_FORMAT") != NULL) {
+        set_color_format(getenv("LV_SIM_COLOR_FORMAT"));
+    }
+
+    set_thread_sched(THREAD_SCHED_MAIN, getenv("LV_SIM_SCHED_MAIN"));
+    set_thread_sched(THREAD_SCHED_DRAW, getenv("LV_SIM_SCHED_DRAW"));
+    set_thread_sched(THREAD_SCHED_INPUT, getenv("LV_SIM_SCHED_INPUT"));
+
+    capture_dir = getenv("LV_SIM_CAPTURE_DIR");
+    capture_interval = atoi(getenv_default("LV_SIM_CAPTURE_INTERVAL", "0"));
+
+    if (getenv("LV_SIM_CAPTURE_FORMAT") != NULL) {
+        set_capture_format(getenv("LV_SIM_CAPTURE_FORMAT"));
+    }
 
     /* Parse the command-line options. */
-    while ((opt = getopt (argc, argv, "b:fmW:H:BVh")) != -1) {
+    while ((opt = getopt_long(argc, argv, "b:fmsW:H:BVh", long_options, NULL)) != -1) {
         switch (opt) {
         case 'h':
             print_usage();
@@ -101,17 +237,71 @@ static void configure_simulator(int argc, char **argv)
             exit(EXIT_SUCCESS);
             break;
         case 'b':
-            if (driver_backends_is_supported(optarg) == 0) {
-                die("error no such backend: %s\n", optarg);
-            }
+            check_backends(optarg);
             selected_backend = strdup(optarg);
             break;
+        case 's':
+            settings.vsync = true;
+            break;
         case 'W':
             settings.window_width = atoi(optarg);
             break;
         case 'H':
             settings.window_height = atoi(optarg);
             break;
+        case OPT_BENCH:
+            bench_enabled = true;
+            if (optarg != NULL) {
+                bench_scenes = optarg;
+            }
+            break;
+        case OPT_BENCH_TIME:
+            bench_duration = atoi(optarg);
+            break;
+        case OPT_BENCH_OUTPUT:
+            bench_output = optarg;
+            break;
+        case OPT_FRAME_STATS:
+            settings.frame_stats = true;
+            break;
+        case OPT_RENDER_MODE:
+            set_render_mode(optarg);
+            break;
+        case OPT_BUFFER_COUNT:
+            set_buffer_count(optarg);
+            break;
+        case OPT_BUFFER_LINES:
+            settings.buffer_lines = atoi(optarg);
+            break;
+        case OPT_COLOR_FORMAT:
+            set_color_format(optarg);
+            break;
+        case OPT_PRELOAD:
+            preload_path = optarg;
+            break;
+        case OPT_DIRTY_REGIONS:
+            settings.dirty_regions = true;
+            break;
+        case OPT_DIRTY_OVERLAY:
+            settings.dirty_overlay = true;
+            break;
+        case OPT_IDLE_TIMEOUT:
+            settings.idle_timeout = atoi(optarg);
+            break;
+        case OPT_SCHED:
+            if (thread_sched_parse_option(optarg) == -1) {
+                die("Invalid scheduling option: %s\n", optarg);
+            }
+            break;
+        case OPT_CAPTURE_DIR:
+            capture_dir = optarg;
+            break;
+        case OPT_CAPTURE_INTERVAL:
+            capture_interval = atoi(optarg);
+            break;
+        case OPT_CAPTURE_FORMAT:
+            set_capture_format(optarg);
+            break;
         case ':':
             print_usage();
             die("Option -%c requires an argument.\n", optopt);
@@ -123,6 +313,154 @@ static void configure_simulator(int argc, char **argv)
     }
 }
 
+/**
+ * @brief Set the render mode of the displays
+ * @description exits if the mode is invalid
+ * @param name PARTIAL, DIRECT or FULL
+ */
+static void set_render_mode(const char *name)
+{
+    settings.render_mode = display_buffers_parse_render_mode(name);
+
+    if (settings.render_mode == -1) {
+        die("Invalid render mode: %s\n", name);
+    }
+}
+
+/**
+ * @brief Set the number of draw buffers of the displays
+ * @description exits if the count is invalid
+ * @param count 1 or 2
+ */
+static void set_buffer_count(const char *count)
+{
+    settings.buffer_count = atoi(count);
+
+    if (settings.buffer_count != 1 && settings.buffer_count != 2) {
+        die("Invalid buffer count: %s\n", count);
+    }
+}
+
+/**
+ * @brief Set the color format of the displays
+ * @description exits if the color format is not supported
+ * @param name the name of the color format i.e RGB565
+ */
+static void set_color_format(const char *name)
+{
+    settings.color_format = display_buffers_parse_color_format(name);
+
+    if (settings.color_format == LV_COLOR_FORMAT_UNKNOWN) {
+        die("Unsupported color format: %s\n", name);
+    }
+}
+
+/**
+ * @brief Set the CPU affinity and scheduling policy of a role
+ * @description exits if the specification is invalid
+ * @param role the role of the threads
+ * @param spec cpus[:policy[:priority]], NULL to keep the defaults
+ */
+static void set_thread_sched(thread_sched_role_t role, const char *spec)
+{
+    if (spec != NULL && thread_sched_configure(role, spec) == -1) {
+        die("Invalid scheduling specification: %s\n", spec);
+    }
+}
+
+/**
+ * @brief Set the file format of the captured frames
+ * @description exits if the format is invalid
+ * @param name png or raw
+ */
+static void set_capture_format(const char *name)
+{
+    int format = frame_capture_parse_format(name);
+
+    if (format == -1) {
+        die("Invalid capture format: %s\n", name);
+    }
+
+    capture_format = format;
+}
+
+/**
+ * @brief Check the list of backends passed with -b
+ * @description exits if one of the backends is not supported
+ * @param list the list of backends i.e "DRM:16,FBDEV:100:thread"
+ */
+static void check_backends(const char *list)
+{
+    char *copy;
+    char *spec;
+    char *name;
+    char *saveptr;
+
+    copy = strdup(list);
+
+    for (spec = strtok_r(copy, ",", &saveptr); spec != NULL;
+         spec = strtok_r(NULL, ",", &saveptr)) {
+
+        name = strsep(&spec, ":");
+
+        if (driver_backends_is_supported(name) == 0) {
+            die("error no such backend: %s\n", name);
+        }
+    }
+
+    free(copy);
+}
+
+/**
+ * @brief Initialize the selected display backends
+ * @description each backend of the list is initialized in order,
+ * the first one is the display the input devices are bound to
+ * @param list the list of backends - NULL to use the default backend
+ */
+static void init_display_backends(char *list)
+{
+    char *spec;
+    char *name;
+    char *period;
+    char *saveptr;
+    lv_display_t *disp;
+
+    if (list == NULL) {
+        if (driver_backends_init_backend(NULL) == -1) {
+            die("Failed to initialize display backend");
+        }
+        return;
+    }
+
+    for (spec = strtok_r(list, ",", &saveptr); spec != NULL;
+         spec = strtok_r(NULL, ",", &saveptr)) {
+
+        name = strsep(&spec, ":");
+        period = strsep(&spec, ":");
+
+        /* Converts the name to upper case */
+        driver_backends_is_supported(name);
+
+        if (driver_backends_init_backend(name) == -1) {
+            die("Failed to initialize display backend %s", name);
+        }
+
+        disp = driver_backends_get_display(name);
+
+        if (disp == NULL || period == NULL || *period == '\0') {
+            continue;
+        }
+
+        if (spec != NULL && strcmp(spec, "thread") == 0) {
+            if (driver_backends_start_render_thread(disp, atoi(period)) == -1) {
+                die("Failed to start the render thread of %s", name);
+            }
+        } else {
+            driver_backends_set_refr_period(disp, atoi(period));
+        }
+    }
+}
+
 /**
  * @brief entry point
  * @description start a demo
@@ -131,15 +469,58 @@ static void configure_simulator(int argc, char **argv)
  */
 int main(int argc, char **argv)
 {
+    lv_display_t *disp;
+    uint32_t refr_period;
 
     configure_simulator(argc, argv);
 
-    /* Initialize LVGL. */
+    /* Record the trace from the initialization of LVGL */
+    trace_profiler_init();
+
+    /* Initialize LVGL, the draw units are created with the draw role */
+    thread_sched_draw_units_begin();
     lv_init();
+    thread_sched_draw_units_end();
+
+    /* Serve the allocations of LVGL from the mapped heap */
+    if (mem_heap_init() == -1) {
+        die("Failed to initialize the heap\n");
+    }
+
+    if (atoi(getenv_default("LV_SIM_HEAP_STATS", "0"))) {
+        mem_heap_enable_report();
+    }
+
+    /* Register the M: drive serving the assets from mapped files */
+    mmap_fs_init();
+
+    /* Select the SIMD draw kernels supported by the CPU */
+    draw_sw_avx2_init();
+
+    /* The render threads apply the main role themselves, the helper threads
+     * created from now on run with the initial affinity and SCHED_OTHER */
+    thread_sched_apply(THREAD_SCHED_MAIN, pthread_self());
 
-    /* Initialize the configured backend */
-    if (driver_backends_init_backend(selected_backend) == -1) {
-        die("Failed to initialize display backend");
+    /* Initialize the configured backends */
+    init_display_backends(selected_backend);
+
+    /* Save the first frame to display it on the next start */
+    splash_capture(lv_display_get_default());
+
+    /* Write the requested frames from a background thread */
+    if (capture_dir != NULL &&
+        frame_capture_init(lv_display_get_default(), capture_dir,
+                           capture_format, capture_interval) == -1) {
+        die("Failed to capture the frames to %s\n", capture_dir);
+    }
+
+    /* Lower the refresh rate while the displays are static */
+    adaptive_refresh_init(settings.idle_timeout, settings.idle_period);
+
+    for (disp = lv_display_get_next(NULL); disp != NULL; disp = lv_display_get_next(disp)) {
+        if (driver_backends_get_refr_period(disp, &refr_period)) {
+            adaptive_refresh_add_display(disp, refr_period);
+        }
     }
 
     /* Enable for EVDEV support */
@@ -149,9 +530,26 @@ int main(int argc, char **argv)
     }
 #endif
 
-    /*Create a Demo*/
-    lv_demo_widgets();
-    lv_demo_widgets_start_slideshow();
+    /* Warm up the caches before the first screen is created */
+    asset_preload_configure_caches();
+
+    if (preload_path != NULL &&
+        asset_preload_start(preload_path,
+                            atoi(getenv_default("LV_SIM_PRELOAD_THREAD", "0"))) == -1) {
+        die("Failed to preload the assets of %s\n", preload_path);
+    }
+
+    if (bench_enabled) {
+        /* Run the benchmark scenes, exits once done */
+        if (benchmark_start(bench_scenes, bench_duration, bench_output,
+                            driver_backends_get_display_name()) == -1) {
+            die("Failed to start the benchmark\n");
+        }
+    } else {
+        /*Create a Demo*/
+        lv_demo_widgets();
+        lv_demo_widgets_start_slideshow();
+    }
 
     /* Enter the run loop of the selected backend */
     driver_backends_run_loop();
@@ -13,3 +13,15 @@ set(CMAKE_CXX_COMPILER ${tools}/bin/arm-openwrt-linux-gnueabi-g++)
 # if not work, please try(in shell command): export STAGING_DIR=/home/ubuntu/Your_SDK/out/xxx/openwrt/staging_dir/target
 #set(ENV{STAGING_DIR} "/home/ubuntu/Your_SDK/out/xxx/openwrt/staging_dir/target")
 
+
+# LTO (LV_LINUX_LTO and the lto-cross/pgo-*-cross presets) archives the static
+# libraries with the wrappers loading the LTO plugin
+set(CMAKE_C_COMPILER_AR ${tools}/bin/arm-openwrt-linux-gnueabi-gcc-ar)
+set(CMAKE_C_COMPILER_RANLIB ${tools}/bin/arm-openwrt-linux-gnueabi-gcc-ranlib)
+set(CMAKE_CXX_COMPILER_AR ${CMAKE_C_COMPILER_AR})
+set(CMAKE_CXX_COMPILER_RANLIB ${CMAKE_C_COMPILER_RANLIB})
+
+# PGO - the instrumented lvglsim of the pgo-generate-cross preset writes its
+# profile to the build directory path, on the target run it with
+# GCOV_PREFIX=/tmp/pgo GCOV_PREFIX_STRIP=0 and copy /tmp/pgo/<build path>/profile
+# back to build/pgo-cross/profile before building the pgo-use-cross preset